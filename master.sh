@@ -14,6 +14,25 @@ fi
 
 util/sync.sh
 
+# the converters' --scan mode checks a log without converting it, and
+# writes a JSON summary of its timing and integrity; this warns about a
+# log whose summary ($2) shows frames missing or failing their checksum
+report_scan()
+{
+    dropped=$(grep -o '"dropped_frames": [0-9]*' $2 2>/dev/null | \
+        grep -o '[0-9]*$')
+    failed=$(grep -o '"checksum_failures": [0-9]*' $2 2>/dev/null | \
+        grep -o '[0-9]*$')
+    if [[ -z $dropped || -z $failed ]]
+    then
+        printf "$yellow%-${SP}s%s$end\n" "$1" "Warning: failed to scan log"
+    elif [[ $dropped -gt 0 || $failed -gt 0 ]]
+    then
+        printf "$yellow%-${SP}s%s$end\n" "$1" \
+            "Warning: $dropped dropped frames, $failed checksum failures"
+    fi
+}
+
 # this disables quitting the program using ctrl-C, because it must
 # be allowed to clean up after itself; to quit the program normally,
 # press Q/q when prompted.
@@ -106,6 +125,15 @@ then
             app/str2str -in serial://$portname:$baudrate \
                 -out file://./$folder/$filename \
                 -c cmd/${CMD_COM2[0]} 2>/dev/null &
+
+            # convert the SPAN log while it's being written; see the
+            # SPAN conversion step at the end of the test
+            for (( t=0; t<10 && ! -f $folder/$filename; ++t ))
+            do
+                sleep 0.5
+            done
+            app/nconv $folder/$filename --follow >/dev/null 2>/dev/null &
+            NCONV_PID=$!
         fi
     fi
     if [[ ${BPS_COM3[0]} -gt 0 ]]
@@ -282,12 +310,16 @@ INS_TEXT_FILES=() # array of S/N of successfully converted text files
 # reference position, and renaming/reorganizing
 for (( i=1; i<$NUMBER_OF_NODES; ++i ))
 do
-    # kill str2str
+    # kill str2str; the INS log follower started by slave.sh sees the log
+    # being closed and exits once it has converted the last frames
     ssh $UNAME@${LOGIN[$i]} "killall str2str" >/dev/null 2>/dev/null
     if [[ ${ENABLE[$i]} -eq 0 || ${success[$i]} -eq 0 ]]
     then
         continue
     fi
+    ssh $UNAME@${LOGIN[$i]} "for (( t=0; t<50; ++t )); do \
+        pgrep -f 'ilconv.*--follow' >/dev/null || break; sleep 0.2; done; \
+        pkill -f 'ilconv.*--follow'" >/dev/null 2>/dev/null
 
     # it is determined that the device collected data successfully, so the
     # master will now pull the INS data from the slave
@@ -308,7 +340,9 @@ do
         # iff data is collected successfully, the INS log needs to be
         # converted to text and offset to the SPAN position (this is
         # done with app/ilconv, the source for which is found in
-        # src/ilconv.cpp)
+        # src/ilconv.cpp). the slave has already converted the log
+        # during the test, so --follow --idle 0 only resumes from its
+        # checkpoint and converts whatever is left, if anything.
 
         PVX=$(echo "${LX[$i]} - ${LX[0]}" | bc)
         PVY=$(echo "${LY[$i]} - ${LY[0]}" | bc)
@@ -317,7 +351,7 @@ do
             "Converting INS data w/ PV offset [$PVX, $PVY, $PVZ]"
         serialno=$(cat data/${COLORS[$i]}-$TIMESTAMP/.serial)
         app/ilconv data/${COLORS[$i]}-$TIMESTAMP/$serialno-$TIMESTAMP.bin \
-            --pvoff $PVX $PVY $PVZ >/dev/null 2>/dev/null
+            --pvoff $PVX $PVY $PVZ --follow --idle 0 >/dev/null 2>/dev/null
         if [[ $? -ne 0 ]]
         then
             # throw an error if conversion fails
@@ -325,6 +359,15 @@ do
                 "Error: failed to convert INS log file to text"
             ((error_flag++))
         fi
+        rm -f data/${COLORS[$i]}-$TIMESTAMP/*.ckpt* 2>/dev/null
+
+        # flag a node that lost data as soon as it's collected; the
+        # summary and a time index are kept with the log
+        app/ilconv data/${COLORS[$i]}-$TIMESTAMP/$serialno-$TIMESTAMP.bin \
+            --scan --index > data/${COLORS[$i]}-$TIMESTAMP/$serialno-$TIMESTAMP.scan.json \
+            2>/dev/null
+        report_scan "[${COLORS[$i]}]" \
+            data/${COLORS[$i]}-$TIMESTAMP/$serialno-$TIMESTAMP.scan.json
 
         # move data around, rename folders, add to array of files
         if [[ -f data/${COLORS[$i]}-$TIMESTAMP/.serial ]]
@@ -343,8 +386,23 @@ done
 # if the SPAN is enabled, convert the data to INSPVAA log
 if [[ ${ENABLE[0]} -gt 0 && ${success[0]} -gt 0 ]]
 then
+    # stop logging so the SPAN follower sees the log closed and finishes;
+    # the final call then only resumes from the follower's checkpoint
     printf "%-${SP}s%s\n" "[${COLORS[0]}]" "Converting SPAN data"
-    app/nconv data/${COLORS[0]}-$TIMESTAMP/SPAN*.bin >/dev/null 2>/dev/null
+    killall str2str >/dev/null 2>/dev/null
+    if [[ -n $NCONV_PID ]]
+    then
+        for (( t=0; t<50; ++t ))
+        do
+            kill -0 $NCONV_PID 2>/dev/null || break
+            sleep 0.2
+        done
+        # a follower that is still running is told to checkpoint and quit
+        kill $NCONV_PID 2>/dev/null
+        wait $NCONV_PID 2>/dev/null
+    fi
+    app/nconv data/${COLORS[0]}-$TIMESTAMP/SPAN*.bin \
+        --follow --idle 0 >/dev/null 2>/dev/null
     if [[ $? -ne 0 ]]
     then
         # throw an error if conversion fails
@@ -354,6 +412,13 @@ then
         ((error_flag++))
     fi
 
+    rm -f data/${COLORS[0]}-$TIMESTAMP/*.ckpt* 2>/dev/null
+
+    app/nconv data/${COLORS[0]}-$TIMESTAMP/SPAN*.bin --scan --index \
+        > data/${COLORS[0]}-$TIMESTAMP/SPAN-$TIMESTAMP.scan.json 2>/dev/null
+    report_scan "[${COLORS[0]}]" \
+        data/${COLORS[0]}-$TIMESTAMP/SPAN-$TIMESTAMP.scan.json
+
     # restructure LOG folder
     mv data/${COLORS[0]}-$TIMESTAMP data/SPAN-$TIMESTAMP
 else
@@ -433,13 +498,14 @@ else
 fi
 
 # for every INS text file added during second node loop,
-# run passfail.m with the test file and INSPVAA log as arguments
+# run app/accuracy (src/accuracy.cpp, which replaces passfail.m)
+# with the test file and INSPVAA log as arguments
 printf "%-${SP}s%s\n" "[${COLORS[0]}]" "Generating reports..."
 for sn in "${INS_TEXT_FILES[@]}"
 do
     printf "%-${SP}s%s%s\n" "[${COLORS[0]}]" "Writing to " \
         "data/LOG-$TIMESTAMP/$sn-$TIMESTAMP/$sn-Accuracy-Report.csv"
-    octave-cli passfail.m \
+    app/accuracy \
         data/LOG-$TIMESTAMP/$sn-$TIMESTAMP/$sn-$TIMESTAMP.txt \
         data/LOG-$TIMESTAMP/SPAN-$TIMESTAMP/SPAN-$TIMESTAMP.ins \
         data/LOG-$TIMESTAMP/$sn-$TIMESTAMP/$sn-Accuracy-Report.csv
@@ -92,6 +92,17 @@ then
         -out file://./$folder/$filename \
         -c cmd/${CMD_COM1[$1]} 2>/dev/null &
     sleep 1
+
+    # convert the INS log to text while it is being written, so that the
+    # master only has to finish off the tail once the test is over; the
+    # follower exits by itself when str2str is killed and closes the log,
+    # leaving a checkpoint the master's final app/ilconv call resumes from
+    PVX=$(echo "${LX[$1]} - ${LX[0]}" | bc)
+    PVY=$(echo "${LY[$1]} - ${LY[0]}" | bc)
+    PVZ=$(echo "${LZ[$1]} - ${LZ[0]}" | bc)
+    for (( t=0; t<10 && ! -f $folder/$filename; ++t )); do sleep 0.5; done
+    nohup app/ilconv $folder/$filename --follow \
+        --pvoff $PVX $PVY $PVZ >/dev/null 2>/dev/null &
 fi
 
 # similarly for COM2; port is defined in config/*.local, baudrate in global.conf;
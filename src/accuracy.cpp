@@ -0,0 +1,481 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <Eigen/Geometry>
+
+#include "mapfile.h"
+#include "outbuf.h"
+
+// accuracy compares an INS text log (ilconv output) against the SPAN
+// INSPVAA log recorded alongside it and writes the accuracy report
+// that passfail.m used to produce: one CSV row per INS epoch compared,
+// with both solutions and the position and attitude errors between
+// them. both logs are mapped and read a row at a time, in step, so
+// memory use doesn't depend on the length of the test.
+//
+// by default only epochs present in both logs are compared, as
+// passfail.m did; with --interp, the SPAN trajectory is interpolated
+// at every INS epoch instead.
+
+// one timestamped solution from either log
+struct sample
+{
+    // milliseconds of the GPS week
+    long long time;
+    double heading, pitch, roll, lat, lon, alt;
+};
+
+// longest line either log can hold; longer lines are not data rows
+const unsigned long line_max = 4096;
+
+// parses up to max fields of a line into values. fields are separated
+// by delim, or by runs of blanks if delim is 0; like Octave's dlmread,
+// a field that isn't a number reads as 0. returns the number of fields
+// in the line, and sets *numeric if the first field is a number.
+unsigned parse_fields(char *line, char delim, double *values, unsigned max,
+                      int *numeric)
+{
+    unsigned n = 0;
+    char *p = line;
+    *numeric = 0;
+    while (1)
+    {
+        if (!delim) while (*p == ' ' || *p == '\t') ++p;
+        if (!delim && !*p) break;
+
+        char *end;
+        double v = strtod(p, &end);
+        if (end == p) v = 0;
+        else if (n == 0) *numeric = 1;
+        if (n < max) values[n] = v;
+        ++n;
+
+        // on to the next separator
+        p = end;
+        if (delim) while (*p && *p != delim) ++p;
+        else while (*p && *p != ' ' && *p != '\t') ++p;
+        if (!*p) break;
+        if (delim) ++p;
+    }
+    return n;
+}
+
+// ilconv text columns used by the report (0-based): heading, pitch,
+// roll, latitude, longitude, altitude and ms_gps
+enum { INS_HEADING = 0, INS_PITCH = 1, INS_ROLL = 2, INS_LAT = 15,
+       INS_LON = 16, INS_ALT = 17, INS_MS_GPS = 27, INS_FIELDS = 28 };
+
+// a data row of the INS log is any line starting with a number; the
+// PV offset line, the alignment block (short or extended) and the
+// column names are not. returns 1 for a data row.
+int parse_ins(char *line, struct sample *smp)
+{
+    double v[INS_FIELDS];
+    int numeric;
+    if (parse_fields(line, 0, v, INS_FIELDS, &numeric) < INS_FIELDS ||
+        !numeric)
+    {
+        return 0;
+    }
+
+    smp->time = llround(v[INS_MS_GPS]);
+    smp->heading = v[INS_HEADING];
+    smp->pitch = v[INS_PITCH];
+    smp->roll = v[INS_ROLL];
+    smp->lat = v[INS_LAT];
+    smp->lon = v[INS_LON];
+    smp->alt = v[INS_ALT];
+    return 1;
+}
+
+// INSPVAA fields used by the report (0-based, counting the header
+// fields before the ';' as one run of comma separated fields)
+enum { SPAN_SECONDS = 10, SPAN_LAT = 11, SPAN_LON = 12, SPAN_ALT = 13,
+       SPAN_ROLL = 17, SPAN_PITCH = 18, SPAN_AZIMUTH = 19,
+       SPAN_FIELDS = 20 };
+
+int parse_span(char *line, struct sample *smp)
+{
+    double v[SPAN_FIELDS];
+    int numeric;
+    if (parse_fields(line, ',', v, SPAN_FIELDS, &numeric) < SPAN_FIELDS)
+        return 0;
+
+    smp->time = llround(v[SPAN_SECONDS]*1000);
+    smp->heading = v[SPAN_AZIMUTH];
+    smp->pitch = v[SPAN_PITCH];
+    smp->roll = v[SPAN_ROLL];
+    smp->lat = v[SPAN_LAT];
+    smp->lon = v[SPAN_LON];
+    smp->alt = v[SPAN_ALT];
+    return 1;
+}
+
+// reads the data rows of a mapped text log in order, one sample of
+// lookahead at a time
+struct log_reader
+{
+    struct mapped_file mf;
+    unsigned long long pos;
+    int (*parse)(char *line, struct sample *smp);
+    char *line;
+
+    // the next sample, if have is set
+    struct sample next;
+    int have;
+
+    // rows dropped because their time went backwards
+    unsigned long long rows, skipped;
+};
+
+// fills in r->next from the following data row; returns 0 at the end
+// of the log
+int reader_fill(struct log_reader *r)
+{
+    const char *data = (const char*) r->mf.data;
+    while (!r->have && r->pos < r->mf.len)
+    {
+        const char *p = data + r->pos;
+        const char *nl = (const char*) memchr(p, '\n', r->mf.len - r->pos);
+        unsigned long long len = nl ? nl - p : r->mf.len - r->pos;
+        r->pos += len + 1;
+        if (len && p[len-1] == '\r') --len;
+        if (len > line_max) continue;
+
+        memcpy(r->line, p, len);
+        r->line[len] = 0;
+        struct sample smp;
+        if (!r->parse(r->line, &smp)) continue;
+
+        // both logs are written in time order; a row whose clock stepped
+        // back can't be joined without sorting, and is dropped
+        if (r->rows && smp.time < r->next.time)
+        {
+            ++r->skipped;
+            continue;
+        }
+        r->next = smp;
+        r->have = 1;
+        ++r->rows;
+    }
+    return r->have;
+}
+
+// the next sample without consuming it, or 0 at the end of the log
+const struct sample* reader_peek(struct log_reader *r)
+{
+    return reader_fill(r) ? &r->next : 0;
+}
+
+void reader_pop(struct log_reader *r)
+{
+    r->have = 0;
+}
+
+int reader_open(struct log_reader *r, const char *filename,
+                int (*parse)(char *line, struct sample *smp))
+{
+    memset(r, 0, sizeof(*r));
+    r->parse = parse;
+    r->line = (char*) malloc(line_max + 1);
+    if (!r->line) return 1;
+    if (map_file(&r->mf, filename))
+    {
+        free(r->line);
+        return 1;
+    }
+    return 0;
+}
+
+void reader_close(struct log_reader *r)
+{
+    unmap_file(&r->mf);
+    free(r->line);
+}
+
+const double radius_earth = 6371000;
+
+const char* report_header =
+    "Time,Minutes,INS_Lat,INS_Lon,INS_alt,"
+    "SPAN_lat,SPAN_long,SPAN_alt,Err_lat,Err_lon,Err_alt,"
+    "INS_heading,INS_pitch,INS_roll,SPAN_heading,SPAN_pitch,SPAN_roll,"
+    "Err_heading,Err_pitch,Err_roll\n";
+
+// writes one report row comparing an INS sample to the SPAN solution
+// at the same epoch; t0 is the time of the report's first row
+void print_row(struct outbuf *out, long long time, long long t0,
+               const struct sample *ins, const struct sample *span)
+{
+    double err_lat = radius_earth*sin(M_PI/180*(ins->lat - span->lat));
+    double err_lon = radius_earth*sin(M_PI/180*(ins->lon - span->lon))*
+        cos(M_PI/180*(ins->lat - span->lat));
+    double err_alt = ins->alt - span->alt;
+
+    // attitude differences wrapped into [-90, 90] degrees
+    double err_heading =
+        180/M_PI*asin(sin(M_PI/180*(span->heading - ins->heading)));
+    double err_pitch =
+        180/M_PI*asin(sin(M_PI/180*(span->pitch - ins->pitch)));
+    double err_roll =
+        180/M_PI*asin(sin(M_PI/180*(span->roll - ins->roll)));
+
+    outbuf_printf(out, "%lld,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,"
+        "%f,%f,%f,%f,%f,%f,%f,%f,%f\n",
+        time, (time - t0)/60000.0,
+        ins->lat, ins->lon, ins->alt,
+        span->lat, span->lon, span->alt,
+        err_lat, err_lon, err_alt,
+        ins->heading, ins->pitch, ins->roll,
+        span->heading, span->pitch, span->roll,
+        err_heading, err_pitch, err_roll);
+}
+
+// INS epochs are matched to SPAN epochs to the nearest 5 ms
+long long join_key(const struct sample *ins)
+{
+    return llround(ins->time/5.0)*5;
+}
+
+// merge-joins the two logs and writes a row for every epoch in both;
+// an epoch repeated in either log is taken from its last sample, as
+// Octave's intersect did. rows before the SPAN has a position fix
+// (latitude still 0) are left out, and the report is timed from the
+// first row kept. returns the number of rows written.
+unsigned long long join_exact(struct outbuf *out,
+    struct log_reader *ins, struct log_reader *span)
+{
+    unsigned long long rows = 0;
+    struct sample last_ins, last_span;
+    int have_last = 0;
+    long long t0 = 0;
+    const struct sample *a, *b;
+    while ((a = reader_peek(ins)) && (b = reader_peek(span)))
+    {
+        long long t = join_key(a);
+        if (t < b->time) reader_pop(ins);
+        else if (t > b->time) reader_pop(span);
+        else
+        {
+            struct sample x = *a, y = *b;
+            reader_pop(ins);
+            while ((a = reader_peek(ins)) && join_key(a) == t)
+            {
+                x = *a;
+                reader_pop(ins);
+            }
+            reader_pop(span);
+            while ((b = reader_peek(span)) && b->time == t)
+            {
+                y = *b;
+                reader_pop(span);
+            }
+
+            if (!rows && y.lat == 0)
+            {
+                // no fix yet; remembered in case one never comes
+                last_ins = x;
+                last_span = y;
+                have_last = 1;
+                continue;
+            }
+            if (!rows) t0 = y.time;
+            print_row(out, y.time, t0, &x, &y);
+            ++rows;
+        }
+    }
+
+    // as passfail.m did, a SPAN log that never got a fix still reports
+    // its last row
+    if (!rows && have_last)
+    {
+        print_row(out, last_span.time, last_span.time,
+            &last_ins, &last_span);
+        ++rows;
+    }
+    return rows;
+}
+
+// SPAN attitude as a rotation: heading about Z (counterclockwise, so
+// the negated azimuth), then pitch about X', then roll about Y''; the
+// same Z-X'-Y'' convention as ilconv's PV offset
+Eigen::Quaterniond attitude(const struct sample *s)
+{
+    const double rad = M_PI/180;
+    return Eigen::AngleAxisd(-s->heading*rad, Eigen::Vector3d::UnitZ()) *
+           Eigen::AngleAxisd(s->pitch*rad, Eigen::Vector3d::UnitX()) *
+           Eigen::AngleAxisd(s->roll*rad, Eigen::Vector3d::UnitY());
+}
+
+// inverse of attitude(): azimuth in [0, 360), pitch and roll in degrees
+void set_attitude(struct sample *s, const Eigen::Quaterniond &q)
+{
+    const Eigen::Matrix3d R = q.toRotationMatrix();
+    const double deg = 180/M_PI;
+    double pitch = asin(R(2,1) > 1 ? 1 : R(2,1) < -1 ? -1 : R(2,1));
+    s->pitch = deg*pitch;
+    s->roll = deg*atan2(-R(2,0), R(2,2));
+    double azimuth = -deg*atan2(-R(0,1), R(1,1));
+    if (azimuth < 0) azimuth += 360;
+    if (azimuth >= 360) azimuth -= 360;
+    s->heading = azimuth;
+}
+
+// for every INS epoch within the SPAN log, interpolates the SPAN
+// solution between the SPAN epochs either side of it and writes a row:
+// position linearly, attitude by spherical linear interpolation of the
+// two orientations, so heading wraps through north correctly. INS
+// epochs in a SPAN gap longer than max_gap ms, or next to a SPAN epoch
+// without a position fix, are left out. both logs are swept once, in
+// step. returns the number of rows written.
+unsigned long long join_interp(struct outbuf *out,
+    struct log_reader *ins, struct log_reader *span, long long max_gap)
+{
+    unsigned long long rows = 0;
+    long long t0 = 0;
+
+    // the SPAN epochs either side of the current INS epoch, and their
+    // orientations
+    struct sample s0, s1;
+    Eigen::Quaterniond q0, q1;
+    int have0 = 0, have1 = 0;
+
+    const struct sample *a;
+    for (; (a = reader_peek(ins)); reader_pop(ins))
+    {
+        long long t = a->time;
+        const struct sample *b;
+        while ((b = reader_peek(span)) && (!have1 || s1.time <= t))
+        {
+            s0 = s1;
+            q0 = q1;
+            have0 = have1;
+            s1 = *b;
+            q1 = attitude(&s1);
+            have1 = 1;
+            reader_pop(span);
+        }
+
+        // the bracket is s0 <= t < s1, or t == s1 at the end of the log
+        struct sample ref;
+        if (have0 && s0.time == t) ref = s0;
+        else if (have1 && s1.time == t) ref = s1;
+        else if (have0 && have1 && s0.time < t && t < s1.time)
+        {
+            if (s0.lat == 0 || s1.lat == 0) continue;
+            if (s1.time - s0.time > max_gap) continue;
+
+            double f = (double) (t - s0.time)/(s1.time - s0.time);
+            ref.time = t;
+            ref.lat = s0.lat + f*(s1.lat - s0.lat);
+            ref.lon = s0.lon + f*(s1.lon - s0.lon);
+            ref.alt = s0.alt + f*(s1.alt - s0.alt);
+            set_attitude(&ref, q0.slerp(f, q1));
+        }
+        else continue; // outside the SPAN log
+        if (ref.lat == 0) continue;
+
+        if (!rows) t0 = t;
+        print_row(out, t, t0, a, &ref);
+        ++rows;
+    }
+    return rows;
+}
+
+const char* argument_error =
+    "%s: invalid option -- '%s'\n"
+    "type '%s --usage' for more info\n";
+
+const char* usage_help =
+    "usage: %s insfile spanfile outfile [--interp [--max-gap ms]]\n"
+    "  insfile: INS text log written by ilconv\n"
+    "  spanfile: INSPVAA text log written by nconv (.ins)\n"
+    "  outfile: CSV accuracy report to write\n"
+    "  [--interp]: compare every INS epoch against the SPAN solution\n"
+    "    interpolated to it, rather than only epochs in both logs\n"
+    "  [--max-gap ms]: with --interp, don't interpolate across SPAN\n"
+    "    gaps longer than ms milliseconds (default 100)\n";
+
+int main(int argc, char** argv)
+{
+    if (argc == 2 && strcmp(argv[1], "--usage") == 0)
+    {
+        printf(usage_help, argv[0]);
+        return 0;
+    }
+    if (argc < 4)
+    {
+        fprintf(stderr, usage_help, argv[0]);
+        return 1;
+    }
+
+    unsigned char interp_flag = 0;
+    long long max_gap = 100;
+    for (int i = 4; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--interp"))
+        {
+            interp_flag = 1;
+        }
+        else if (!strcmp(argv[i], "--max-gap"))
+        {
+            if (argc < i + 2)
+            {
+                fprintf(stderr, usage_help, argv[0]);
+                return 1;
+            }
+            max_gap = atoll(argv[++i]);
+        }
+        else // if any argument is unexpected, throw argument error
+        {
+            fprintf(stderr, argument_error, argv[0], argv[i], argv[0]);
+            return 1;
+        }
+    }
+
+    struct log_reader ins, span;
+    if (reader_open(&ins, argv[1], parse_ins))
+    {
+        fprintf(stderr, "%s: failed to open '%s'\n", argv[0], argv[1]);
+        return 1;
+    }
+    if (reader_open(&span, argv[2], parse_span))
+    {
+        fprintf(stderr, "%s: failed to open '%s'\n", argv[0], argv[2]);
+        return 1;
+    }
+
+    struct outbuf out;
+    int outfd = open(argv[3], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (outfd == -1 || outbuf_open(&out, outfd, OUTBUF_DEFAULT_CAP))
+    {
+        fprintf(stderr, "%s: failed to open '%s'\n", argv[0], argv[3]);
+        return 1;
+    }
+
+    outbuf_printf(&out, "%s", report_header);
+    unsigned long long rows = interp_flag ?
+        join_interp(&out, &ins, &span, max_gap) :
+        join_exact(&out, &ins, &span);
+
+    // count whatever rows the join didn't need to read
+    while (reader_peek(&ins)) reader_pop(&ins);
+    while (reader_peek(&span)) reader_pop(&span);
+    fprintf(stderr, "%s: compared %llu of %llu INS epochs against %llu "
+        "SPAN epochs\n", argv[0], rows, ins.rows, span.rows);
+    if (ins.skipped || span.skipped)
+    {
+        fprintf(stderr, "%s: dropped %llu INS and %llu SPAN rows going "
+            "back in time\n", argv[0], ins.skipped, span.skipped);
+    }
+    reader_close(&ins);
+    reader_close(&span);
+
+    int error = outbuf_close(&out);
+    if (close(outfd)) error = 1;
+    if (error) fprintf(stderr, "%s: error writing output\n", argv[0]);
+    return error;
+}
@@ -0,0 +1,235 @@
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "colfile.h"
+
+static const char colfile_magic[8] = "INSCOL1";
+
+static unsigned char col_size(enum col_type type)
+{
+    switch (type)
+    {
+        case COL_I8: case COL_U8: return 1;
+        case COL_I16: case COL_U16: return 2;
+        case COL_I32: case COL_U32: case COL_F32: return 4;
+        case COL_I64: case COL_U64: case COL_F64: return 8;
+    }
+    return 0;
+}
+
+// stores the low size bytes of value at dst, least significant first
+static void put_le(unsigned char *dst, unsigned long long value, int size)
+{
+    for (int i = 0; i < size; ++i)
+    {
+        dst[i] = value & 0xFF;
+        value >>= 8;
+    }
+}
+
+static int write_all(int fd, const void *data, unsigned long len)
+{
+    const unsigned char *p = (const unsigned char*) data;
+    while (len > 0)
+    {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int pread_all(int fd, void *data, unsigned long len,
+                     unsigned long long offset)
+{
+    unsigned char *p = (unsigned char*) data;
+    while (len > 0)
+    {
+        ssize_t n = pread(fd, p, len, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 1;
+        p += n;
+        len -= n;
+        offset += n;
+    }
+    return 0;
+}
+
+int colfile_open(struct colfile *cf, int fd, const char *scratch_fn,
+                 const struct col_desc *cols, unsigned ncols)
+{
+    if (!cf || fd < 0 || !scratch_fn || !cols || ncols == 0) return 1;
+
+    memset(cf, 0, sizeof(*cf));
+    cf->fd = fd;
+    cf->cols = cols;
+    cf->ncols = ncols;
+    cf->scratch = -1;
+    cf->size = (unsigned char*) malloc(ncols);
+    cf->chunk_off = (unsigned long*) malloc(ncols*sizeof(unsigned long));
+    cf->scratch_fn = (char*) malloc(strlen(scratch_fn) + 1);
+    if (!cf->size || !cf->chunk_off || !cf->scratch_fn)
+    {
+        free(cf->size);
+        free(cf->chunk_off);
+        free(cf->scratch_fn);
+        return 1;
+    }
+    strcpy(cf->scratch_fn, scratch_fn);
+
+    for (unsigned c = 0; c < ncols; ++c)
+    {
+        cf->size[c] = col_size(cols[c].type);
+        cf->chunk_off[c] = cf->row_size*COLFILE_CHUNK_ROWS;
+        cf->row_size += cf->size[c];
+    }
+
+    cf->chunk = (unsigned char*) malloc(cf->row_size*COLFILE_CHUNK_ROWS);
+    if (!cf->chunk)
+    {
+        free(cf->size);
+        free(cf->chunk_off);
+        free(cf->scratch_fn);
+        return 1;
+    }
+    return 0;
+}
+
+void colfile_put_int(struct colfile *cf, long long value)
+{
+    if (cf->col >= cf->ncols) return;
+
+    enum col_type type = cf->cols[cf->col].type;
+    if (type == COL_F32 || type == COL_F64)
+    {
+        colfile_put_real(cf, (double) value);
+        return;
+    }
+    unsigned c = cf->col++;
+    put_le(cf->chunk + cf->chunk_off[c] + cf->rows*cf->size[c],
+        (unsigned long long) value, cf->size[c]);
+}
+
+void colfile_put_real(struct colfile *cf, double value)
+{
+    if (cf->col >= cf->ncols) return;
+
+    unsigned c = cf->col++;
+    unsigned char *dst = cf->chunk + cf->chunk_off[c] + cf->rows*cf->size[c];
+    if (cf->cols[c].type == COL_F32)
+    {
+        float f = (float) value;
+        unsigned int bits;
+        memcpy(&bits, &f, 4);
+        put_le(dst, bits, 4);
+    }
+    else if (cf->cols[c].type == COL_F64)
+    {
+        unsigned long long bits;
+        memcpy(&bits, &value, 8);
+        put_le(dst, bits, 8);
+    }
+    else put_le(dst, (unsigned long long) (long long) value, cf->size[c]);
+}
+
+// moves the full chunk in memory to the end of the scratch file
+static void colfile_spill(struct colfile *cf)
+{
+    if (cf->scratch == -1)
+    {
+        cf->scratch = open(cf->scratch_fn, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (cf->scratch == -1)
+        {
+            cf->error = 1;
+            return;
+        }
+        unlink(cf->scratch_fn);
+    }
+    if (write_all(cf->scratch, cf->chunk, cf->row_size*COLFILE_CHUNK_ROWS))
+        cf->error = 1;
+    ++cf->spilled;
+}
+
+void colfile_end_row(struct colfile *cf)
+{
+    if (cf->col != cf->ncols) cf->error = 1; // a short row is a bug
+    cf->col = 0;
+    ++cf->nrows;
+    if (++cf->rows == COLFILE_CHUNK_ROWS)
+    {
+        if (!cf->error) colfile_spill(cf);
+        cf->rows = 0;
+    }
+}
+
+int colfile_close(struct colfile *cf)
+{
+    unsigned long hdr_len = 24 + 64*cf->ncols;
+    unsigned char *hdr = (unsigned char*) calloc(hdr_len, 1);
+    unsigned long slab_max = 8*COLFILE_CHUNK_ROWS;
+    unsigned char *slab = (unsigned char*) malloc(slab_max);
+    int error = cf->error || !hdr || !slab;
+
+    // lay the columns out back to back after the header
+    unsigned long long offset = (hdr_len + 7) & ~7ULL;
+    if (!error)
+    {
+        memcpy(hdr, colfile_magic, 8);
+        put_le(hdr + 8, cf->ncols, 4);
+        put_le(hdr + 16, cf->nrows, 8);
+        for (unsigned c = 0; c < cf->ncols; ++c)
+        {
+            unsigned char *d = hdr + 24 + 64*c;
+            strncpy((char*) d, cf->cols[c].name, 39);
+            d[40] = cf->cols[c].type;
+            d[41] = cf->size[c];
+            unsigned long long bits;
+            memcpy(&bits, &cf->cols[c].scale, 8);
+            put_le(d + 48, bits, 8);
+            put_le(d + 56, offset, 8);
+            offset += (cf->nrows*cf->size[c] + 7) & ~7ULL;
+        }
+        error = write_all(cf->fd, hdr, hdr_len);
+    }
+
+    static const unsigned char zeros[8] = {0};
+    unsigned long long written = hdr_len;
+    for (unsigned c = 0; c < cf->ncols && !error; ++c)
+    {
+        if (written & 7) error |= write_all(cf->fd, zeros, 8 - (written & 7));
+        written = (written + 7) & ~7ULL;
+
+        // this column's slab of each spilled chunk, then the chunk
+        // still in memory
+        unsigned long slab_len = cf->size[c]*COLFILE_CHUNK_ROWS;
+        for (unsigned long long k = 0; k < cf->spilled && !error; ++k)
+        {
+            error |= pread_all(cf->scratch, slab, slab_len,
+                k*cf->row_size*COLFILE_CHUNK_ROWS + cf->chunk_off[c]);
+            if (!error) error |= write_all(cf->fd, slab, slab_len);
+        }
+        if (!error) error |= write_all(cf->fd,
+            cf->chunk + cf->chunk_off[c], cf->rows*cf->size[c]);
+        written += cf->nrows*cf->size[c];
+    }
+
+    if (cf->scratch != -1) close(cf->scratch);
+    free(hdr);
+    free(slab);
+    free(cf->chunk);
+    free(cf->size);
+    free(cf->chunk_off);
+    free(cf->scratch_fn);
+    cf->chunk = 0;
+    cf->size = 0;
+    cf->chunk_off = 0;
+    cf->scratch_fn = 0;
+    return error;
+}
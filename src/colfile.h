@@ -0,0 +1,88 @@
+#ifndef COLFILE_H
+#define COLFILE_H
+
+// columnar output, written by the converters with --format columnar.
+// every field of a log is stored as one contiguous array of its raw
+// binary value, so that analysis tools can map a column and use it
+// directly instead of parsing text. the file is self-describing:
+//
+//   offset  size  field (all integers little-endian)
+//        0     8  magic, "INSCOL1\0"
+//        8     4  number of columns
+//       12     4  reserved, zero
+//       16     8  number of rows
+//       24  64*n  one descriptor per column:
+//                   40  name, null-padded
+//                    1  type, enum col_type
+//                    1  bytes per value
+//                    6  reserved, zero
+//                    8  scale, an IEEE double: the physical value
+//                       is the stored value times scale
+//                    8  file offset of the column's first value
+//
+// the columns follow the descriptors, each starting on an 8-byte
+// boundary and holding one value per row.
+
+enum col_type
+{
+    COL_I8 = 1, COL_U8, COL_I16, COL_U16, COL_I32, COL_U32,
+    COL_I64, COL_U64, COL_F32, COL_F64
+};
+
+struct col_desc
+{
+    const char *name;
+    enum col_type type;
+    double scale;
+};
+
+// rows are collected in memory this many at a time; full chunks are
+// moved to a scratch file, and the columns are assembled from those
+// when the file is closed, so memory use stays bounded
+#define COLFILE_CHUNK_ROWS 8192
+
+struct colfile
+{
+    int fd;
+    const struct col_desc *cols;
+    unsigned ncols;
+
+    // bytes per value of each column, where its values start within a
+    // chunk, and the number of bytes in one row
+    unsigned char *size;
+    unsigned long *chunk_off;
+    unsigned long row_size;
+
+    // the chunk being filled, column by column, its number of
+    // complete rows, and the column the next value goes to
+    unsigned char *chunk;
+    unsigned long rows;
+    unsigned col;
+
+    // scratch file holding full chunks; only created once the first
+    // chunk fills up, and unlinked as soon as it's created
+    char *scratch_fn;
+    int scratch;
+    unsigned long long spilled, nrows;
+    int error;
+};
+
+// prepares to write a columnar file with the given columns to fd.
+// scratch_fn names the scratch file to use if the data outgrows one
+// chunk. returns 0 on success.
+int colfile_open(struct colfile *cf, int fd, const char *scratch_fn,
+                 const struct col_desc *cols, unsigned ncols);
+
+// append a value to the next column of the current row; integers are
+// narrowed to the column's type, reals are stored as f32 or f64
+void colfile_put_int(struct colfile *cf, long long value);
+void colfile_put_real(struct colfile *cf, double value);
+
+// completes the current row; every column must have been given a value
+void colfile_end_row(struct colfile *cf);
+
+// writes the header and all columns to the file and frees everything;
+// the file descriptor is left open. returns nonzero if writing failed.
+int colfile_close(struct colfile *cf);
+
+#endif // COLFILE_H
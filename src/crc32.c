@@ -0,0 +1,55 @@
+#include <pthread.h>
+
+#include "crc32.h"
+
+// crc_table[0] is the classic byte-at-a-time table; crc_table[k][b]
+// is the CRC of byte b followed by k zero bytes, which lets eight
+// input bytes be folded in with eight independent lookups
+static uint32_t crc_table[8][256];
+static pthread_once_t crc_table_once = PTHREAD_ONCE_INIT;
+
+static void crc32_init(void)
+{
+    for (unsigned b = 0; b < 256; ++b)
+    {
+        uint32_t crc = b;
+        for (int i = 0; i < 8; ++i)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        crc_table[0][b] = crc;
+    }
+    for (unsigned b = 0; b < 256; ++b)
+    {
+        uint32_t crc = crc_table[0][b];
+        for (int k = 1; k < 8; ++k)
+        {
+            crc = (crc >> 8) ^ crc_table[0][crc & 0xFF];
+            crc_table[k][b] = crc;
+        }
+    }
+}
+
+uint32_t crc32_update(uint32_t crc, const unsigned char *data,
+                      unsigned long long len)
+{
+    // logs may be checked on several threads at once
+    pthread_once(&crc_table_once, crc32_init);
+
+    while (len >= 8)
+    {
+        crc ^= (uint32_t) data[0] | ((uint32_t) data[1] << 8) |
+               ((uint32_t) data[2] << 16) | ((uint32_t) data[3] << 24);
+        crc = crc_table[7][crc & 0xFF] ^
+              crc_table[6][(crc >> 8) & 0xFF] ^
+              crc_table[5][(crc >> 16) & 0xFF] ^
+              crc_table[4][crc >> 24] ^
+              crc_table[3][data[4]] ^
+              crc_table[2][data[5]] ^
+              crc_table[1][data[6]] ^
+              crc_table[0][data[7]];
+        data += 8;
+        len -= 8;
+    }
+    while (len--)
+        crc = (crc >> 8) ^ crc_table[0][(crc ^ *data++) & 0xFF];
+    return crc;
+}
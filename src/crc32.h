@@ -0,0 +1,18 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+
+// the 32-bit CRC NovAtel OEM7 appends to every binary log: reflected
+// polynomial 0xEDB88320, initial value 0 and no final inversion.
+// https://docs.novatel.com/OEM7/Content/Messages/32_Bit_CRC.htm
+//
+// computed eight bytes at a time with the slicing-by-8 method, so that
+// checking every log costs little next to decoding it.
+
+// returns the CRC of len bytes at data, continuing from crc (pass 0 to
+// start a new one)
+uint32_t crc32_update(uint32_t crc, const unsigned char *data,
+                      unsigned long long len);
+
+#endif // CRC32_H
@@ -0,0 +1,621 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "mapfile.h"
+#include "outbuf.h"
+#include "colfile.h"
+#include "syncscan.h"
+#include "crc32.h"
+#include "ilmsg.h"
+#include "oem7msg.h"
+#include "pvoffset.h"
+
+// benchmark for the pieces the converters are built from: the
+// decoders, the checksums, the PV offset and the text and columnar row
+// emitters. every message that checks out in each log given is sorted
+// by kind into a buffer of its own, and random messages of every kind
+// are made up as well, so that kinds missing from the logs get timed
+// too. each routine is then run over every message of its kind, a few
+// times to warm up and then repeatedly, timing every pass. one line of
+// tab-separated values is printed per routine and input, so that runs
+// on two commits can be compared line by line.
+
+enum { ALIGN, EXT_ALIGN, OPVT2AHR, OPVT, INSPVA, POS, NUM_KINDS };
+
+const char *kind_name[NUM_KINDS] =
+    {"align", "ext_align", "opvt2ahr", "opvt", "inspva", "pos"};
+const unsigned long kind_size[NUM_KINDS] =
+{
+    sizeof(struct short_align_block), sizeof(struct ext_align_block),
+    sizeof(struct opvt2ahr_t), sizeof(struct opvt_t),
+    sizeof(struct inspva_t), sizeof(struct pos_t)
+};
+
+// the messages of one kind from one input, back to back, and each of
+// them decoded
+struct frame_set
+{
+    const char *input;
+    unsigned kind;
+    unsigned char *data;
+    unsigned long long bytes, cap;
+
+    // where each message starts in data, and where the last one ends
+    unsigned long long *offset;
+    unsigned long n, offset_cap;
+    void *decoded;
+};
+
+// results are added up here so that no routine can be optimised away
+volatile unsigned long long sink;
+
+// every text row goes to /dev/null through this, as it would to a file
+struct outbuf null_out;
+int null_fd;
+const char *scratch_fn = "/tmp/decbench.col.part";
+
+// appends a message of len bytes to set; returns nonzero if memory ran
+// out
+int add_frame(struct frame_set *set, const unsigned char *msg,
+    unsigned long len)
+{
+    if (set->bytes + len > set->cap)
+    {
+        unsigned long long cap = 2*set->cap + len;
+        unsigned char *data = (unsigned char*) realloc(set->data, cap);
+        if (!data) return 1;
+        set->data = data;
+        set->cap = cap;
+    }
+    if (set->n + 2 > set->offset_cap)
+    {
+        unsigned long cap = 2*set->offset_cap + 2;
+        unsigned long long *offset = (unsigned long long*)
+            realloc(set->offset, cap*sizeof(*offset));
+        if (!offset) return 1;
+        set->offset = offset;
+        set->offset_cap = cap;
+    }
+    memcpy(set->data + set->bytes, msg, len);
+    set->offset[set->n++] = set->bytes;
+    set->bytes += len;
+    set->offset[set->n] = set->bytes;
+    return 0;
+}
+
+// the routines timed: each makes one pass over every message in a set
+
+void run_payload2header(struct frame_set *set)
+{
+    struct short_align_block *frames =
+        (struct short_align_block*) set->decoded;
+    for (unsigned long i = 0; i < set->n; ++i)
+        sink += payload2header(&frames[i], set->data + set->offset[i]);
+}
+
+void run_payload2extheader(struct frame_set *set)
+{
+    struct ext_align_block *frames = (struct ext_align_block*) set->decoded;
+    for (unsigned long i = 0; i < set->n; ++i)
+        sink += payload2extheader(&frames[i], set->data + set->offset[i]);
+}
+
+void run_payload2opvt2ahr(struct frame_set *set)
+{
+    struct opvt2ahr_t *frames = (struct opvt2ahr_t*) set->decoded;
+    for (unsigned long i = 0; i < set->n; ++i)
+        sink += payload2opvt2ahr(&frames[i], set->data + set->offset[i]);
+}
+
+void run_payload2opvt(struct frame_set *set)
+{
+    struct opvt_t *frames = (struct opvt_t*) set->decoded;
+    for (unsigned long i = 0; i < set->n; ++i)
+        sink += payload2opvt(&frames[i], set->data + set->offset[i]);
+}
+
+void run_payload2inspva(struct frame_set *set)
+{
+    struct inspva_t *frames = (struct inspva_t*) set->decoded;
+    for (unsigned long i = 0; i < set->n; ++i)
+        sink += payload2inspva(&frames[i], set->data + set->offset[i]);
+}
+
+void run_payload2pos(struct frame_set *set)
+{
+    struct pos_t *frames = (struct pos_t*) set->decoded;
+    for (unsigned long i = 0; i < set->n; ++i)
+    {
+        unsigned char *log = set->data + set->offset[i];
+        enum pos_flag_t ID = (enum pos_flag_t) (log[4] | (log[5] << 8));
+        sink += payload2pos(&frames[i], log, ID);
+    }
+}
+
+void run_il_checksum_ok(struct frame_set *set)
+{
+    for (unsigned long i = 0; i < set->n; ++i)
+    {
+        sink += il_checksum_ok(set->data + set->offset[i],
+            set->offset[i+1] - set->offset[i]);
+    }
+}
+
+void run_oem7_crc_ok(struct frame_set *set)
+{
+    for (unsigned long i = 0; i < set->n; ++i)
+    {
+        sink += oem7_crc_ok(set->data + set->offset[i],
+            set->offset[i+1] - set->offset[i]);
+    }
+}
+
+// offsets the decoded frames in blocks, the way ilconv --pvoff does;
+// the offset piles up from pass to pass, which doesn't change the work
+void run_apply_PV_offset(struct frame_set *set)
+{
+    static const double pvoff[3] = {1, 2, 3};
+    struct opvt2ahr_t *frames = (struct opvt2ahr_t*) set->decoded;
+    for (unsigned long i = 0; i < set->n; i += PV_BLOCK_LEN)
+    {
+        unsigned long n = set->n - i;
+        if (n > PV_BLOCK_LEN) n = PV_BLOCK_LEN;
+        apply_PV_offset(frames + i, n, pvoff);
+    }
+    sink += frames[0].latitude;
+}
+
+void run_print_header(struct frame_set *set)
+{
+    struct short_align_block *frames =
+        (struct short_align_block*) set->decoded;
+    for (unsigned long i = 0; i < set->n; ++i)
+        print_header(&null_out, &frames[i]);
+    outbuf_flush(&null_out);
+}
+
+void run_print_extheader(struct frame_set *set)
+{
+    struct ext_align_block *frames = (struct ext_align_block*) set->decoded;
+    for (unsigned long i = 0; i < set->n; ++i)
+        print_extheader(&null_out, &frames[i]);
+    outbuf_flush(&null_out);
+}
+
+void run_println_opvt2ahr(struct frame_set *set)
+{
+    struct opvt2ahr_t *frames = (struct opvt2ahr_t*) set->decoded;
+    for (unsigned long i = 0; i < set->n; ++i)
+        println_opvt2ahr(&null_out, &frames[i]);
+    outbuf_flush(&null_out);
+}
+
+// the columns passfail.m reads, as ilconv --fields would write them
+void run_println_projected(struct frame_set *set)
+{
+    struct il_projection proj;
+    const char *bad;
+    if (opvt2ahr_projection(&proj,
+        "ms_gps,heading,pitch,roll,latitude,longitude,altitude", &bad))
+        return;
+    struct opvt2ahr_t *frames = (struct opvt2ahr_t*) set->decoded;
+    for (unsigned long i = 0; i < set->n; ++i)
+        println_projected(&null_out, &proj, &frames[i]);
+    outbuf_flush(&null_out);
+}
+
+void run_println_opvt(struct frame_set *set)
+{
+    struct opvt_t *frames = (struct opvt_t*) set->decoded;
+    for (unsigned long i = 0; i < set->n; ++i)
+        println_opvt(&null_out, &frames[i]);
+    outbuf_flush(&null_out);
+}
+
+void run_println_inspva(struct frame_set *set)
+{
+    struct inspva_t *frames = (struct inspva_t*) set->decoded;
+    for (unsigned long i = 0; i < set->n; ++i)
+        println_inspva(&null_out, &frames[i]);
+    outbuf_flush(&null_out);
+}
+
+void run_println_pos(struct frame_set *set)
+{
+    struct pos_t *frames = (struct pos_t*) set->decoded;
+    for (unsigned long i = 0; i < set->n; ++i)
+    {
+        println_pos(&null_out, &frames[i],
+            (enum pos_flag_t) frames[i].header.msg_ID);
+    }
+    outbuf_flush(&null_out);
+}
+
+// the columnar emitters are timed with the file they fill, which is
+// assembled and written out when it's closed, as it is by --format
+// columnar
+void run_colrow_opvt2ahr(struct frame_set *set)
+{
+    struct opvt2ahr_t *frames = (struct opvt2ahr_t*) set->decoded;
+    struct colfile col;
+    if (colfile_open(&col, null_fd, scratch_fn,
+        opvt2ahr_cols, opvt2ahr_ncols)) return;
+    for (unsigned long i = 0; i < set->n; ++i)
+        colrow_opvt2ahr(&col, &frames[i]);
+    sink += colfile_close(&col);
+}
+
+void run_colrow_opvt(struct frame_set *set)
+{
+    struct opvt_t *frames = (struct opvt_t*) set->decoded;
+    struct colfile col;
+    if (colfile_open(&col, null_fd, scratch_fn, opvt_cols, opvt_ncols))
+        return;
+    for (unsigned long i = 0; i < set->n; ++i)
+        colrow_opvt(&col, &frames[i]);
+    sink += colfile_close(&col);
+}
+
+void run_colrow_inspva(struct frame_set *set)
+{
+    struct inspva_t *frames = (struct inspva_t*) set->decoded;
+    struct colfile col;
+    if (colfile_open(&col, null_fd, scratch_fn, inspva_cols, inspva_ncols))
+        return;
+    for (unsigned long i = 0; i < set->n; ++i)
+        colrow_inspva(&col, &frames[i]);
+    sink += colfile_close(&col);
+}
+
+void run_colrow_pos(struct frame_set *set)
+{
+    struct pos_t *frames = (struct pos_t*) set->decoded;
+    struct colfile col;
+    if (colfile_open(&col, null_fd, scratch_fn, pos_cols, pos_ncols))
+        return;
+    for (unsigned long i = 0; i < set->n; ++i)
+    {
+        colrow_pos(&col, &frames[i],
+            (enum pos_flag_t) frames[i].header.msg_ID);
+    }
+    sink += colfile_close(&col);
+}
+
+// every routine timed, in the order they're run on a set; the decoder
+// of each kind comes first, as it also fills in the decoded frames the
+// rest of them use
+struct bench
+{
+    unsigned kind;
+    const char *function;
+    void (*run)(struct frame_set *set);
+};
+
+const struct bench benches[] =
+{
+    {ALIGN, "payload2header", run_payload2header},
+    {ALIGN, "il_checksum_ok", run_il_checksum_ok},
+    {ALIGN, "print_header", run_print_header},
+    {EXT_ALIGN, "payload2extheader", run_payload2extheader},
+    {EXT_ALIGN, "il_checksum_ok", run_il_checksum_ok},
+    {EXT_ALIGN, "print_extheader", run_print_extheader},
+    {OPVT2AHR, "payload2opvt2ahr", run_payload2opvt2ahr},
+    {OPVT2AHR, "il_checksum_ok", run_il_checksum_ok},
+    {OPVT2AHR, "println_opvt2ahr", run_println_opvt2ahr},
+    {OPVT2AHR, "println_projected", run_println_projected},
+    {OPVT2AHR, "colrow_opvt2ahr", run_colrow_opvt2ahr},
+    {OPVT2AHR, "apply_PV_offset", run_apply_PV_offset},
+    {OPVT, "payload2opvt", run_payload2opvt},
+    {OPVT, "il_checksum_ok", run_il_checksum_ok},
+    {OPVT, "println_opvt", run_println_opvt},
+    {OPVT, "colrow_opvt", run_colrow_opvt},
+    {INSPVA, "payload2inspva", run_payload2inspva},
+    {INSPVA, "oem7_crc_ok", run_oem7_crc_ok},
+    {INSPVA, "println_inspva", run_println_inspva},
+    {INSPVA, "colrow_inspva", run_colrow_inspva},
+    {POS, "payload2pos", run_payload2pos},
+    {POS, "oem7_crc_ok", run_oem7_crc_ok},
+    {POS, "println_pos", run_println_pos},
+    {POS, "colrow_pos", run_colrow_pos}
+};
+const unsigned num_benches = sizeof(benches)/sizeof(benches[0]);
+
+// sorts the message at buf into sets if it is whole in the len bytes
+// there and checks out, and returns its length, or 0 if it isn't one
+unsigned long sort_message(struct frame_set *sets, unsigned char *buf,
+    unsigned long long len, int *error)
+{
+    unsigned kind;
+    unsigned long msg_len;
+    if (buf[1] == il_sync[1] && buf[2] == il_sync[2])
+    {
+        msg_len = (buf[4] | (buf[5] << 8)) + 2UL;
+        if (msg_len > len) return 0;
+        if (msg_len == IL_ALIGN_LEN) kind = ALIGN;
+        else if (msg_len == IL_EXT_ALIGN_LEN) kind = EXT_ALIGN;
+        else if (msg_len == IL_OPVT2AHR_LEN && buf[3] == IL_OPVT2AHR_TYPE)
+            kind = OPVT2AHR;
+        else if (msg_len == IL_OPVT_LEN && buf[3] == IL_OPVT_TYPE)
+            kind = OPVT;
+        else return 0;
+        if (!il_checksum_ok(buf, msg_len)) return 0;
+    }
+    else if (buf[1] == oem7_sync[1] && buf[2] == oem7_sync[2])
+    {
+        msg_len = oem7_log_len(buf);
+        if (!msg_len || msg_len > len || !oem7_crc_ok(buf, msg_len))
+            return 0;
+        unsigned short msg_ID = buf[4] | (buf[5] << 8);
+        const struct oem7_handler *handler = oem7_find_handler(msg_ID);
+        if (!handler || (buf[8] | (buf[9] << 8)) != handler->msg_len)
+            return msg_len;
+        kind = msg_ID == INSPVA_ID ? INSPVA : POS;
+    }
+    else return 0;
+
+    if (add_frame(&sets[kind], buf, msg_len)) *error = 1;
+    return msg_len;
+}
+
+// xorshift64, so that the made up messages are the same from run to run
+static unsigned long long rng_state = 88172645463325252ULL;
+static unsigned long long rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// random message bytes are kept below mask where a message holds
+// floating point fields, so that none of them is too large to print as
+// quickly as a real one would be; random bit patterns would make
+// exponents in the hundreds
+
+// fills buf with an Inertial Labs message of the given type and total
+// length, random but for its header and checksum
+void make_il(unsigned char *buf, unsigned char type, unsigned long len,
+    unsigned char mask)
+{
+    buf[0] = 0xAA;
+    buf[1] = 0x55;
+    buf[2] = 0x01;
+    buf[3] = type;
+    buf[4] = (len - 2) & 0xFF;
+    buf[5] = (len - 2) >> 8;
+    for (unsigned long i = IL_HEADER_LEN; i < len - 2; ++i)
+        buf[i] = rng() & mask;
+    unsigned short checksum = 0;
+    for (unsigned long i = 2; i < len - 2; ++i) checksum += buf[i];
+    buf[len-2] = checksum & 0xFF;
+    buf[len-1] = checksum >> 8;
+}
+
+// fills buf with an OEM7 log with the given ID and message length,
+// random but for its header and CRC; returns its total length
+unsigned long make_oem7(unsigned char *buf, unsigned short msg_ID,
+    unsigned short msg_len)
+{
+    unsigned long len = OEM7_MIN_HEADER_LEN + msg_len + 4;
+    for (unsigned long i = 0; i < len - 4; ++i) buf[i] = rng() & 0x3F;
+    buf[0] = 0xAA;
+    buf[1] = 0x44;
+    buf[2] = 0x12;
+    buf[3] = OEM7_MIN_HEADER_LEN;
+    buf[4] = msg_ID & 0xFF;
+    buf[5] = msg_ID >> 8;
+    buf[6] = 0;
+    buf[8] = msg_len & 0xFF;
+    buf[9] = msg_len >> 8;
+    uint32_t crc = crc32_update(0, buf, len - 4);
+    for (int i = 0; i < 4; ++i) buf[len-4+i] = crc >> 8*i;
+    return len;
+}
+
+// fills sets with n made up messages of every kind; returns nonzero if
+// memory ran out
+int make_synthetic(struct frame_set *sets, unsigned long n)
+{
+    static const unsigned short pos_IDs[] = {BESTPOS, BESTGNSSPOS, RTKPOS};
+    unsigned char buf[OEM7_MIN_HEADER_LEN + 256];
+    int error = 0;
+    for (unsigned long i = 0; i < n; ++i)
+    {
+        make_il(buf, IL_ALIGN_TYPE, IL_ALIGN_LEN, 0x3F);
+        error |= add_frame(&sets[ALIGN], buf, IL_ALIGN_LEN);
+        make_il(buf, IL_ALIGN_TYPE, IL_EXT_ALIGN_LEN, 0x3F);
+        error |= add_frame(&sets[EXT_ALIGN], buf, IL_EXT_ALIGN_LEN);
+        make_il(buf, IL_OPVT2AHR_TYPE, IL_OPVT2AHR_LEN, 0xFF);
+        error |= add_frame(&sets[OPVT2AHR], buf, IL_OPVT2AHR_LEN);
+        make_il(buf, IL_OPVT_TYPE, IL_OPVT_LEN, 0xFF);
+        error |= add_frame(&sets[OPVT], buf, IL_OPVT_LEN);
+
+        const struct oem7_handler *handler = oem7_find_handler(INSPVA_ID);
+        unsigned long len = make_oem7(buf, INSPVA_ID, handler->msg_len);
+        error |= add_frame(&sets[INSPVA], buf, len);
+        unsigned short ID = pos_IDs[i % 3];
+        len = make_oem7(buf, ID, oem7_find_handler(ID)->msg_len);
+        error |= add_frame(&sets[POS], buf, len);
+    }
+    return error;
+}
+
+double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec/1.0E9;
+}
+
+// times b on set and prints its line: the mean, standard deviation and
+// minimum time per message over the timed passes, and the rates at
+// the mean. the rate in MB/s counts the bytes of the messages in the
+// log, whatever the routine reads or writes.
+void time_bench(const char *label, const struct bench *b,
+    struct frame_set *set, int warmup, int runs, double *ns)
+{
+    for (int r = 0; r < warmup; ++r) b->run(set);
+    double mean = 0, var = 0, min = 0;
+    for (int r = 0; r < runs; ++r)
+    {
+        double start = now();
+        b->run(set);
+        ns[r] = (now() - start)*1.0E9/set->n;
+        mean += ns[r]/runs;
+        if (r == 0 || ns[r] < min) min = ns[r];
+    }
+    for (int r = 0; r < runs; ++r) var += (ns[r] - mean)*(ns[r] - mean);
+    double sd = runs > 1 ? sqrt(var/(runs - 1)) : 0;
+    printf("%s\t%s\t%s\t%s\t%lu\t%llu\t%d\t%.2f\t%.2f\t%.2f\t%.0f\t%.2f\n",
+        label, set->input, kind_name[set->kind], b->function, set->n,
+        set->bytes, runs, mean, sd, min, 1.0E9/mean,
+        set->bytes*1.0E3/(mean*set->n));
+}
+
+// decodes every message in set, then times each routine on it
+int run_set(const char *label, struct frame_set *set, int warmup,
+    int runs, double *ns)
+{
+    if (!set->n) return 0;
+    set->decoded = calloc(set->n, kind_size[set->kind]);
+    if (!set->decoded) return 1;
+    for (unsigned i = 0; i < num_benches; ++i)
+    {
+        if (benches[i].kind != set->kind) continue;
+        if (!strncmp(benches[i].function, "payload2", 8))
+            benches[i].run(set);
+        time_bench(label, &benches[i], set, warmup, runs, ns);
+    }
+    fflush(stdout);
+    free(set->decoded);
+    free(set->data);
+    free(set->offset);
+    return 0;
+}
+
+const char* argument_error =
+    "%s: invalid option -- '%s'\n"
+    "type '%s --usage' for more info\n";
+
+const char* usage_help =
+    "usage: %s [infile...] [-w warmup] [-r runs] [-n count] [-l label]\n"
+    "  infile: INS or SPAN log whose messages are timed, sorted by kind\n"
+    "  warmup: untimed passes over the messages first; 2 by default\n"
+    "  runs: timed passes, averaged; 10 by default\n"
+    "  count: random messages of each kind to time as well; 20000 by\n"
+    "    default, none for 0\n"
+    "  label: first field of every line, e.g. the commit; '-'\n"
+    "prints a line of tab-separated values per routine and input:\n"
+    "  label input kind function frames bytes runs ns_per_frame\n"
+    "  ns_stddev ns_min frames_per_s MB_per_s\n";
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && strcmp(argv[1], "--usage") == 0)
+    {
+        printf(usage_help, argv[0]);
+        return 0;
+    }
+
+    int warmup = 2, runs = 10;
+    long count = 20000;
+    const char *label = "-";
+    for (int i = 1; i < argc; ++i)
+    {
+        if (argv[i][0] != '-') continue; // an infile
+        if (i + 1 >= argc)
+        {
+            fprintf(stderr, usage_help, argv[0]);
+            return 1;
+        }
+        if (!strcmp(argv[i], "-w")) warmup = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-r")) runs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-n")) count = atol(argv[++i]);
+        else if (!strcmp(argv[i], "-l")) label = argv[++i];
+        else
+        {
+            fprintf(stderr, argument_error, argv[0], argv[i], argv[0]);
+            return 1;
+        }
+        argv[i-1] = argv[i] = 0; // so the infiles are all that's left
+    }
+    if (warmup < 0) warmup = 0;
+    if (runs < 1) runs = 1;
+    if (count < 0) count = 0;
+
+    null_fd = open("/dev/null", O_WRONLY);
+    double *ns = (double*) malloc(runs*sizeof(double));
+    if (null_fd == -1 || !ns ||
+        outbuf_open(&null_out, null_fd, OUTBUF_DEFAULT_CAP))
+    {
+        fprintf(stderr, "%s: failed to set up\n", argv[0]);
+        return 1;
+    }
+
+    printf("# decbench: %d warmup and %d timed passes, sync_scan uses %s\n",
+        warmup, runs, sync_scan_impl());
+    printf("label\tinput\tkind\tfunction\tframes\tbytes\truns\t"
+        "ns_per_frame\tns_stddev\tns_min\tframes_per_s\tMB_per_s\n");
+
+    int error = 0;
+    for (int i = 1; i < argc && !error; ++i)
+    {
+        if (!argv[i]) continue;
+        struct mapped_file mf;
+        if (map_file(&mf, argv[i]))
+        {
+            fprintf(stderr, "%s: failed to open '%s'\n", argv[0], argv[i]);
+            return 1;
+        }
+        const char *input = strrchr(argv[i], '/');
+        input = input ? input + 1 : argv[i];
+
+        struct frame_set sets[NUM_KINDS];
+        memset(sets, 0, sizeof(sets));
+        static const unsigned char sync = 0xAA;
+        unsigned long long pos = 0;
+        while (!error && pos + 10 <= mf.len)
+        {
+            pos += sync_scan(mf.data + pos, mf.len - pos, &sync, 1);
+            if (pos + 10 > mf.len) break;
+            unsigned long used =
+                sort_message(sets, mf.data + pos, mf.len - pos, &error);
+            pos += used ? used : 1;
+        }
+        unmap_file(&mf);
+        for (unsigned k = 0; k < NUM_KINDS; ++k)
+        {
+            sets[k].input = input;
+            sets[k].kind = k;
+            error |= run_set(label, &sets[k], warmup, runs, ns);
+        }
+    }
+
+    if (!error && count)
+    {
+        struct frame_set sets[NUM_KINDS];
+        memset(sets, 0, sizeof(sets));
+        error = make_synthetic(sets, count);
+        for (unsigned k = 0; k < NUM_KINDS && !error; ++k)
+        {
+            sets[k].input = "synthetic";
+            sets[k].kind = k;
+            error |= run_set(label, &sets[k], warmup, runs, ns);
+        }
+    }
+
+    outbuf_close(&null_out);
+    close(null_fd);
+    free(ns);
+    if (error)
+    {
+        fprintf(stderr, "%s: memory allocation error\n", argv[0]);
+        return 1;
+    }
+    return 0;
+}
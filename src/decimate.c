@@ -0,0 +1,71 @@
+#include <string.h>
+
+#include "decimate.h"
+
+void decim_init(struct decimator *d, double rate_hz, unsigned nchannels)
+{
+    memset(d, 0, sizeof(*d));
+    d->period_ms = 1000/rate_hz;
+    d->nchannels = nchannels;
+}
+
+int decim_keep(struct decimator *d, unsigned long ms)
+{
+    // a week rollover or a time going backwards starts a new cell too
+    unsigned long cell = ms/d->period_ms;
+    if (d->started && cell == d->cell) return 0;
+    d->started = 1;
+    d->cell = cell;
+    return 1;
+}
+
+void decim_add(struct decimator *d, const double *channels)
+{
+    for (unsigned i = 0; i < d->nchannels; ++i) d->sums[i] += channels[i];
+    ++d->n;
+}
+
+void decim_mean(struct decimator *d, double *channels)
+{
+    if (d->n)
+    {
+        for (unsigned i = 0; i < d->nchannels; ++i)
+            channels[i] = d->sums[i]/d->n;
+    }
+    memset(d->sums, 0, sizeof(d->sums));
+    d->n = 0;
+}
+
+long decim_round(double x)
+{
+    return x < 0 ? (long) (x - 0.5) : (long) (x + 0.5);
+}
+
+int decim_frame(struct decimator *d, unsigned long ms, double *channels)
+{
+    int keep = decim_keep(d, ms);
+    if (!d->nchannels) return keep;
+    decim_add(d, channels);
+    if (keep) decim_mean(d, channels);
+    return keep;
+}
+
+void decim_grids_init(struct decim_grids *g, double rate_hz)
+{
+    memset(g, 0, sizeof(*g));
+    g->rate_hz = rate_hz;
+}
+
+int decim_keep_kind(struct decim_grids *g, unsigned kind, unsigned long ms)
+{
+    unsigned i = 0;
+    while (i < g->n && g->kind[i] != kind) ++i;
+    if (i == DECIM_MAX_KINDS) return 1;
+    if (i == g->n)
+    {
+        g->kind[i] = kind;
+        decim_init(&g->grid[i], g->rate_hz, 0);
+        ++g->n;
+    }
+    return decim_keep(&g->grid[i], ms);
+}
@@ -0,0 +1,99 @@
+#ifndef DECIMATE_H
+#define DECIMATE_H
+
+// the converters' --decimate option: cuts GPS time into cells of a
+// grid, one cell per output period, and keeps only the first frame to
+// arrive in each cell. a frame that isn't kept is never formatted. with
+// --average, the IMU channels of a kept frame are replaced by their
+// mean over every frame since the last kept one (a boxcar filter), so
+// that the vibration between rows isn't aliased into them.
+
+// channels a decimator averages at most: the three gyros and the three
+// accelerometers
+#define DECIM_MAX_CHANNELS 6
+
+struct decimator
+{
+    // width of a cell, and the cell of the last frame kept
+    double period_ms;
+    unsigned long cell;
+    int started;
+
+    // channels averaged, none without --average, and their sums over
+    // the frames since the last kept one
+    unsigned nchannels;
+    double sums[DECIM_MAX_CHANNELS];
+    unsigned long n;
+};
+
+// prepares d to keep rate_hz frames a second, averaging nchannels
+// channels of them
+void decim_init(struct decimator *d, double rate_hz, unsigned nchannels);
+
+// nonzero if the frame stamped ms GPS milliseconds into the week is
+// the first in its cell, and is to be written out. must see every
+// frame, in order.
+int decim_keep(struct decimator *d, unsigned long ms);
+
+// adds a frame's channels to the running sums
+void decim_add(struct decimator *d, const double *channels);
+
+// replaces channels with their means over the frames added since the
+// last call, and starts the sums over
+void decim_mean(struct decimator *d, double *channels);
+
+// x rounded to the nearest integer, for storing a mean back into the
+// integer field it came from
+long decim_round(double x);
+
+// decim_keep, and with channels being averaged, decim_add and, for a
+// frame that is kept, decim_mean: whether the frame stamped ms is
+// written out, with channels replaced by their means if it is
+int decim_frame(struct decimator *d, unsigned long ms, double *channels);
+
+// defines int name(struct decimator *d, frame_type *frame), which
+// decimates an Inertial Labs frame: whether frame is written out, and
+// with --average, its gyros and accelerometers replaced by their means
+// since the last frame written. frame_type is any frame with ms_gps
+// and the integer fields gyro_x, gyro_y, gyro_z, acc_x, acc_y, acc_z.
+#define DECIM_IMU_FRAME(name, frame_type) \
+int name(struct decimator *d, frame_type *frame) \
+{ \
+    double imu[6] = {(double) frame->gyro_x, (double) frame->gyro_y, \
+        (double) frame->gyro_z, (double) frame->acc_x, \
+        (double) frame->acc_y, (double) frame->acc_z}; \
+    int keep = decim_frame(d, frame->ms_gps, imu); \
+    if (keep && d->nchannels) \
+    { \
+        frame->gyro_x = decim_round(imu[0]); \
+        frame->gyro_y = decim_round(imu[1]); \
+        frame->gyro_z = decim_round(imu[2]); \
+        frame->acc_x = decim_round(imu[3]); \
+        frame->acc_y = decim_round(imu[4]); \
+        frame->acc_z = decim_round(imu[5]); \
+    } \
+    return keep; \
+}
+
+// kinds of message kept apart, each on a grid of its own, by a
+// converter writing several kinds (nconv's logs); at least as many as
+// there are kinds converted
+#define DECIM_MAX_KINDS 8
+
+struct decim_grids
+{
+    double rate_hz;
+    unsigned n;
+    unsigned kind[DECIM_MAX_KINDS];
+    struct decimator grid[DECIM_MAX_KINDS];
+};
+
+// prepares g to keep rate_hz messages of each kind a second
+void decim_grids_init(struct decim_grids *g, double rate_hz);
+
+// decim_keep on the grid of the given kind, started the first time
+// the kind turns up. past DECIM_MAX_KINDS kinds, every message of a
+// new kind is kept.
+int decim_keep_kind(struct decim_grids *g, unsigned kind, unsigned long ms);
+
+#endif // DECIMATE_H
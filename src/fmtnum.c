@@ -0,0 +1,118 @@
+#include <string.h>
+
+#include "fmtnum.h"
+
+// two-digit pairs "00" through "99", so that the digit loops below
+// do one division for every two digits
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// writes the decimal digits of value backwards, ending just before
+// end, and returns a pointer to the first one. at least min_digits
+// digits are written, padding with leading zeros.
+static char* put_digits(char *end, unsigned long long value, int min_digits)
+{
+    char *p = end;
+    while (value >= 100)
+    {
+        unsigned idx = (unsigned) (value % 100) * 2;
+        value /= 100;
+        p -= 2;
+        p[0] = digit_pairs[idx];
+        p[1] = digit_pairs[idx + 1];
+    }
+    if (value >= 10)
+    {
+        unsigned idx = (unsigned) value * 2;
+        p -= 2;
+        p[0] = digit_pairs[idx];
+        p[1] = digit_pairs[idx + 1];
+    }
+    else *--p = (char) ('0' + value);
+
+    while (end - p < min_digits) *--p = '0';
+    return p;
+}
+
+// right-justifies the n characters at src in a field of width
+static char* put_field(char *dst, int width, const char *src, int n)
+{
+    if (width > n)
+    {
+        memset(dst, ' ', width - n);
+        dst += width - n;
+    }
+    memcpy(dst, src, n);
+    return dst + n;
+}
+
+char* fmt_fixed(char *dst, int width, long long value, int decimals)
+{
+    // largest field is a sign, twenty digits and a decimal point
+    char tmp[24];
+    char *end = tmp + sizeof(tmp);
+    unsigned long long mag = value < 0 ?
+        0ULL - (unsigned long long) value : (unsigned long long) value;
+
+    char *p;
+    if (decimals > 0)
+    {
+        // the whole and fractional parts are written as one run of
+        // digits, then the fraction is shifted over for the point
+        p = put_digits(end, mag, decimals + 1);
+        memmove(p - 1, p, end - p - decimals);
+        end[-decimals - 1] = '.';
+        --p;
+    }
+    else p = put_digits(end, mag, 1);
+
+    if (value < 0) *--p = '-';
+    return put_field(dst, width, p, (int) (end - p));
+}
+
+char* fmt_uint(char *dst, int width, unsigned long long value)
+{
+    char tmp[24];
+    char *end = tmp + sizeof(tmp);
+    char *p = put_digits(end, value, 1);
+    return put_field(dst, width, p, (int) (end - p));
+}
+
+char* fmt_hex(char *dst, int width, unsigned long long value)
+{
+    static const char hex[] = "0123456789abcdef";
+    char tmp[16];
+    char *end = tmp + sizeof(tmp);
+    char *p = end;
+    do
+    {
+        *--p = hex[value & 0xF];
+        value >>= 4;
+    }
+    while (value);
+
+    int n = (int) (end - p);
+    if (width > n)
+    {
+        memset(dst, '0', width - n);
+        dst += width - n;
+    }
+    memcpy(dst, p, n);
+    return dst + n;
+}
+
+char* fmt_str(char *dst, const char *s)
+{
+    unsigned long n = strlen(s);
+    memcpy(dst, s, n);
+    return dst + n;
+}
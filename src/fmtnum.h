@@ -0,0 +1,32 @@
+#ifndef FMTNUM_H
+#define FMTNUM_H
+
+// fixed-width number formatting for the row emitters. every field
+// the converters print is a scaled integer straight out of a binary
+// log, so rather than dividing it into a double and handing that to
+// printf, these write the integer's digits directly, putting the
+// decimal point where the scale says it belongs. the text produced
+// is identical to the printf conversion noted on each function.
+
+// each of these writes one field starting at dst and returns a
+// pointer just past its last character. no terminating null is
+// written. like printf, a field wider than width is not truncated.
+
+// value/10^decimals, right-justified in width characters, with
+// exactly that many decimals: the same text as "%*.*f" applied to
+// value/1.0E<decimals>. a field printed with more decimals than its
+// scale is padded by scaling value up first, e.g. altitude/1.0E3
+// printed "%15.7f" is fmt_fixed(dst, 15, altitude*10000LL, 7).
+// decimals may be at most 19.
+char* fmt_fixed(char *dst, int width, long long value, int decimals);
+
+// unsigned integer, right-justified in width characters, as "%*llu"
+char* fmt_uint(char *dst, int width, unsigned long long value);
+
+// lowercase hexadecimal, zero-padded to width digits, as "%0*llx"
+char* fmt_hex(char *dst, int width, unsigned long long value);
+
+// copies a null-terminated string, as "%s"
+char* fmt_str(char *dst, const char *s);
+
+#endif // FMTNUM_H
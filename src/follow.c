@@ -0,0 +1,183 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include "follow.h"
+
+static volatile sig_atomic_t follow_interrupted = 0;
+
+static void follow_on_signal(int sig)
+{
+    (void) sig;
+    follow_interrupted = 1;
+}
+
+// milliseconds on the monotonic clock
+static long long follow_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1000LL + ts.tv_nsec/1000000;
+}
+
+int follow_file(const char *filename, unsigned long long offset,
+    long idle_ms, follow_decoder decode, follow_sync sync, void *ctx)
+{
+    const unsigned long buffer_len = 64*1024;
+    const long sync_interval_ms = 1000;
+
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) return 1;
+
+    // the watch is added before the first read, so no append or close
+    // can slip in between reaching end of file and waiting for events
+    int ifd = inotify_init();
+    if (ifd == -1 ||
+        inotify_add_watch(ifd, filename, IN_MODIFY | IN_CLOSE_WRITE) == -1)
+    {
+        if (ifd != -1) close(ifd);
+        close(fd);
+        return 1;
+    }
+
+    unsigned char *buf = (unsigned char*) malloc(buffer_len);
+    if (!buf || lseek(fd, offset, SEEK_SET) == -1)
+    {
+        free(buf);
+        close(ifd);
+        close(fd);
+        return 1;
+    }
+
+    // no SA_RESTART, so a signal wakes up a blocking poll(); the
+    // caller's handlers are put back before returning
+    struct sigaction sa, old_int, old_term;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = follow_on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, &old_int);
+    sigaction(SIGTERM, &sa, &old_term);
+
+    unsigned long long have = 0;
+    unsigned char closed = 0, dirty = 0;
+    int error = 0;
+    long long last_growth = follow_now_ms(), last_sync = last_growth;
+
+    while (!follow_interrupted)
+    {
+        ssize_t n = read(fd, buf + have, buffer_len - have);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) break;
+
+        long long now = follow_now_ms();
+        if (n > 0)
+        {
+            have += n;
+            unsigned long long used = decode(ctx, buf, have);
+            if (used == 0 && have == buffer_len)
+            {
+                // the decoder broke its contract; skipping a byte to
+                // make room would quietly corrupt the output
+                error = 1;
+                break;
+            }
+            memmove(buf, buf + used, have - used);
+            have -= used;
+            offset += used;
+            last_growth = now;
+            dirty = 1;
+            if (now - last_sync >= sync_interval_ms)
+            {
+                sync(ctx, offset);
+                last_sync = now;
+                dirty = 0;
+            }
+            continue;
+        }
+
+        // at end of file: either the writer is done, or wait for more
+        if (closed) break;
+        if (idle_ms >= 0 && now - last_growth >= idle_ms)
+        {
+            closed = 1;
+            continue;
+        }
+        if (dirty)
+        {
+            sync(ctx, offset);
+            last_sync = now;
+            dirty = 0;
+        }
+
+        long timeout = sync_interval_ms;
+        if (idle_ms >= 0 && idle_ms - (now - last_growth) < timeout)
+            timeout = idle_ms - (now - last_growth);
+
+        struct pollfd pfd = {ifd, POLLIN, 0};
+        if (poll(&pfd, 1, timeout) > 0)
+        {
+            char events[4096];
+            ssize_t len = read(ifd, events, sizeof(events));
+            for (ssize_t i = 0; i < len; )
+            {
+                struct inotify_event *ev = (struct inotify_event*) (events + i);
+                if (ev->mask & IN_CLOSE_WRITE) closed = 1;
+                i += sizeof(struct inotify_event) + ev->len;
+            }
+        }
+    }
+
+    sync(ctx, offset);
+    sigaction(SIGINT, &old_int, 0);
+    sigaction(SIGTERM, &old_term, 0);
+    free(buf);
+    close(ifd);
+    close(fd);
+    return error;
+}
+
+int checkpoint_load(const char *filename, struct checkpoint *cp)
+{
+    if (!filename || !cp) return 1;
+
+    FILE *f = fopen(filename, "r");
+    if (!f) return 1;
+
+    int n = fscanf(f, "%llu %llu %llu %lu", &cp->in_offset,
+        &cp->out_offset[0], &cp->out_offset[1], &cp->flags);
+    fclose(f);
+    return n != 4;
+}
+
+int checkpoint_save(const char *filename, const struct checkpoint *cp)
+{
+    if (!filename || !cp) return 1;
+
+    // write to a temporary file and rename it over the old checkpoint,
+    // so an interrupted save never leaves a torn checkpoint behind
+    char *tmpfn = (char*) malloc(strlen(filename) + 5);
+    if (!tmpfn) return 1;
+    strcpy(tmpfn, filename);
+    strcat(tmpfn, ".tmp");
+
+    FILE *f = fopen(tmpfn, "w");
+    if (!f)
+    {
+        free(tmpfn);
+        return 1;
+    }
+    fprintf(f, "%llu %llu %llu %lu\n", cp->in_offset,
+        cp->out_offset[0], cp->out_offset[1], cp->flags);
+    int error = fclose(f) != 0 || rename(tmpfn, filename) != 0;
+    free(tmpfn);
+    return error;
+}
@@ -0,0 +1,48 @@
+#ifndef FOLLOW_H
+#define FOLLOW_H
+
+// decodes complete messages from the front of buf and returns the
+// number of bytes consumed; an incomplete message at the end of the
+// buffer must be left unconsumed. buf holds 64 KiB, so a decoder must
+// only ever wait for messages shorter than that, and skip anything
+// else.
+typedef unsigned long long (*follow_decoder)(void *ctx,
+    unsigned char *buf, unsigned long long len);
+
+// called periodically and before follow_file returns, with the offset
+// into the input of the first byte not yet consumed by the decoder;
+// this is where a converter flushes its output and saves a checkpoint
+typedef void (*follow_sync)(void *ctx, unsigned long long offset);
+
+// decodes a log which is still being written, starting at the given
+// byte offset. new data is waited for with inotify; the function
+// returns once the writer closes the file, once idle_ms milliseconds
+// pass without the file growing (never, if idle_ms is negative), or
+// when the process receives SIGINT or SIGTERM. a partial message at
+// the end of the file is never consumed, so the final sync offset is
+// always a safe point to resume from. the handlers for SIGINT and
+// SIGTERM are restored before returning. returns 0 on success, or 1 if
+// the file could not be opened or watched, or if the decoder left a
+// full buffer unconsumed, in which case the final sync offset is where
+// it got stuck.
+int follow_file(const char *filename, unsigned long long offset,
+    long idle_ms, follow_decoder decode, follow_sync sync, void *ctx);
+
+// resumable progress of a conversion: how far into the input it got,
+// how long each output file was at that point, and a converter
+// specific flags word
+struct checkpoint
+{
+    unsigned long long in_offset;
+    unsigned long long out_offset[2];
+    unsigned long flags;
+};
+
+// reads a checkpoint file; returns 0 on success, 1 if there is no
+// usable checkpoint
+int checkpoint_load(const char *filename, struct checkpoint *cp);
+
+// atomically replaces a checkpoint file; returns 0 on success
+int checkpoint_save(const char *filename, const struct checkpoint *cp);
+
+#endif // FOLLOW_H
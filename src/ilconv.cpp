@@ -3,481 +3,312 @@
 #include <inttypes.h>
 #include <string.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include <Eigen/Geometry>
 
-// INS short initial alignment data block
-struct short_align_block
+#include "mapfile.h"
+#include "follow.h"
+#include "outbuf.h"
+#include "colfile.h"
+#include "syncscan.h"
+#include "parconv.h"
+#include "scanstat.h"
+#include "ilscan.h"
+#include "timeidx.h"
+#include "decimate.h"
+#include "report.h"
+#include "ilmsg.h"
+#include "pvoffset.h"
+
+// decoded frames waiting to be offset and written out together
+struct frame_block
 {
-    // only kept for backwards compatibility
-
-    float gyro_bias[3], avg_accel[3], avg_mag[3],
-          init_hdg, init_roll, init_pitch;
-    unsigned short USW;
+    struct opvt2ahr_t frames[PV_BLOCK_LEN];
+    unsigned n;
 };
 
-// INS extended initial alignment data block
-struct ext_align_block
+// prints a row of frame, or the column titles if frame is null: every
+// column, or with --fields, only those in proj
+void println_frame(struct outbuf *out, const struct il_projection *proj,
+    struct opvt2ahr_t *frame)
 {
-    float gyro_bias[3], avg_accel[3], avg_mag[3],
-          init_hdg, init_roll, init_pitch;
-    unsigned short USW;
-    signed long UT_sr, UP_sr;
-    signed short t_gyro[3], t_acc[3], t_mag[3];
-    double latitude, longitude, altitude;
-    float v_east, v_north, v_up;
-    double g_true;
-    float reserved1, reserved2;
-};
-
-// INS OPVT2AHR data structure
-struct opvt2ahr_t
-{
-    unsigned short heading;
-    signed short pitch, roll;
-    signed long gyro_x, gyro_y, gyro_z;
-    signed long acc_x, acc_y, acc_z;
-    signed short mag_x, mag_y, mag_z;
-    unsigned short USW;
-    unsigned short vinp;
-    signed short temp;
-    signed long long latitude, longitude;
-    signed long altitude, v_east, v_north, v_up;
-    signed long long lat_GNSS, lon_GNSS;
-    signed long alt_GNSS, vh_GNSS;
-    signed short track_grnd;
-    signed long vup_GNSS;
-    unsigned long ms_gps;
-    unsigned char GNSS_info1, GNSS_info2, solnSVs;
-    unsigned short v_latency;
-    unsigned char angle_pos_type;
-    unsigned short hdg_GNSS;
-    signed short latency_ms_hdg, latency_ms_pos, latency_ms_vel;
-    unsigned short p_bar;
-    unsigned long h_bar;
-    unsigned char new_gps;
-};
+    if (proj) println_projected(out, proj, frame);
+    else println_opvt2ahr(out, frame);
+}
 
-// takes a pointer to a short_align_block struct, and a pointer to
-// an unsigned char array. the unsigned char pointer MUST point
-// to the first sync byte of the message, i.e. 0xAA. the sync bytes
-// defined by the INS ICD are 0xAA, 0x55. if the payload pointer does
-// not point at the sync bytes of the binary message, the function
-// will return an error code and the resulting short_align_block
-// is invalid. upon success, the function will return 0.
-int payload2header(struct short_align_block *frame,
-                        unsigned char *payload)
+// offsets the frames in block if pvoff_input isn't null, writes them
+// out as rows of whichever of out and col is set, and empties the block
+void flush_frames(struct frame_block *block, const double *pvoff_input,
+    struct outbuf *out, struct colfile *col, const struct il_projection *proj)
 {
-    // returns 0 if everything goes ok
-
-    if (!frame || !payload) return 1;
-
-    if ((payload[0] != 0xAA) || (payload[1] != 0x55) || (payload[2] != 0x01))
-    {
-        return 1;
-    }
-    if ((payload[4] | (payload[5] << 8)) != 0x38)
+    if (pvoff_input) apply_PV_offset(block->frames, block->n, pvoff_input);
+    for (unsigned i = 0; i < block->n; ++i)
     {
-        return 1;
+        if (col && proj) colrow_projected(col, proj, &block->frames[i]);
+        else if (col) colrow_opvt2ahr(col, &block->frames[i]);
+        else println_frame(out, proj, &block->frames[i]);
     }
+    block->n = 0;
+}
 
-    const unsigned char N = 6; // header length
+// with --decimate, whether frame is written out; see decimate.h
+DECIM_IMU_FRAME(decimate_frame, struct opvt2ahr_t)
 
-    memcpy(&frame->gyro_bias, payload+N, 12);
-    memcpy(&frame->avg_accel, payload+N+12, 12);
-    memcpy(&frame->avg_mag, payload+N+24, 12);
-    memcpy(&frame->init_hdg, payload+N+36, 4);
-    memcpy(&frame->init_roll, payload+N+40, 4);
-    memcpy(&frame->init_pitch, payload+N+44, 4);
-    frame->USW = payload[N+48] | (payload[N+49] << 8);
+// state carried from one read to the next when converting a stream
+struct stream_state
+{
+    // exactly one of these is set, depending on --format
+    struct outbuf *out;
+    struct colfile *col;
+    unsigned char pvoff_flag;
+    double *pvoff_input;
+    unsigned char header_printed;
+    unsigned long long frames;
+
+    // the grid of --decimate and the columns of --fields, if they
+    // were given
+    struct decimator *decim;
+    const struct il_projection *proj;
+};
 
-    unsigned short checksum = 0;
-    for (unsigned long i = 2; i < 56; ++i)
-    {
-        checksum += payload[i];
-    }
-    if (checksum != (payload[56] | (payload[57] << 8)))
+// size of the fixed input buffer used when converting a stream; only
+// the tail of a partially received message is ever carried over
+// between reads, so this bounds the memory used by streaming mode
+const unsigned long stream_buffer_len = 64*1024;
+
+// decodes as many complete Inertial Labs messages as possible from the
+// front of buf and returns the number of bytes consumed. unlike the
+// file converter, no assumptions are made about where the ACK and the
+// alignment block sit; every message is recognized by its length.
+// unless final is nonzero, a message cut off at the end of the buffer
+// is left unconsumed so that it can be completed by the next read.
+unsigned long long convert_stream_block(struct stream_state *st,
+    unsigned char *buf, unsigned long long len, int final)
+{
+    const double *pvoff = st->pvoff_flag ? st->pvoff_input : 0;
+    struct frame_block block;
+    block.n = 0;
+    unsigned long long rptr = 0;
+    while (rptr + 6 <= len)
     {
-        return 1;
-    }
+        // skip straight to the next place a message could start
+        rptr += sync_scan(buf + rptr, len - rptr, il_sync, 3);
+        if (rptr + 6 > len) break;
+
+        // every Inertial Labs message is 2 sync bytes plus msg_len
+        unsigned short msg_len = buf[rptr+4] | (buf[rptr+5] << 8);
+        if (msg_len != 0x08 && msg_len != 0x38 &&
+            msg_len != 0x86 && msg_len != 0x87)
+        {
+            ++rptr;
+            continue;
+        }
+        if (rptr + msg_len + 2 > len)
+        {
+            if (final) break;
+            // wait for the rest of this message
+            flush_frames(&block, pvoff, st->out, st->col, st->proj);
+            return rptr;
+        }
 
-    return 0;
+        if (msg_len == 0x08) // ACK
+        {
+            rptr += 10;
+        }
+        else if (msg_len == 0x38 || msg_len == 0x86) // alignment block
+        {
+            // rows decoded so far go out before the header
+            flush_frames(&block, pvoff, st->out, st->col, st->proj);
+            int error;
+            if (msg_len == 0x38)
+            {
+                struct short_align_block header;
+                if (!(error = payload2header(&header, buf + rptr)))
+                    print_header(st->out, &header);
+            }
+            else
+            {
+                struct ext_align_block header;
+                if (!(error = payload2extheader(&header, buf + rptr)))
+                    print_extheader(st->out, &header);
+            }
+            if (error)
+            {
+                ++rptr;
+                continue;
+            }
+            if (st->out) outbuf_printf(st->out, "\n");
+            println_frame(st->out, st->proj, 0);
+            st->header_printed = 1;
+            rptr += msg_len + 2;
+        }
+        else // OPVT2AHR
+        {
+            if (payload2opvt2ahr(&block.frames[block.n], buf + rptr))
+            {
+                ++rptr;
+                continue;
+            }
+            // joined without an alignment block
+            if (!st->header_printed && st->out)
+            {
+                outbuf_printf(st->out, "\n");
+                println_frame(st->out, st->proj, 0);
+                st->header_printed = 1;
+            }
+            rptr += 137;
+            if (st->decim &&
+                !decimate_frame(st->decim, &block.frames[block.n]))
+                continue;
+            if (++block.n == PV_BLOCK_LEN)
+                flush_frames(&block, pvoff, st->out, st->col, st->proj);
+            ++st->frames;
+        }
+    }
+    flush_frames(&block, pvoff, st->out, st->col, st->proj);
+    // nothing left in the buffer can start a message
+    return final ? len : rptr;
 }
 
-// takes a ext_align_block pointer and a pointer to the beginning
-// of an extended alignment block binary message; behavior is
-// principally identical to that of the above function
-// int payload2header(struct short_align_block*, unsigned char*)
-int payload2extheader(struct ext_align_block *frame,
-                        unsigned char *payload)
+// reads OPVT2AHR traffic from fd (stdin, a FIFO, a serial device...)
+// through a fixed size buffer until end of file, writing out each row
+// as soon as its frame has been received and validated. returns 0 on
+// success, or 1 if the descriptor could not be read.
+int convert_stream(int fd, struct stream_state *st)
 {
-    // returns 0 if everything goes ok
+    unsigned char *buf = (unsigned char*) malloc(stream_buffer_len);
+    if (!buf) return 1;
 
-    if (!frame || !payload) return 1;
-
-    if ((payload[0] != 0xAA) || (payload[1] != 0x55) || (payload[2] != 0x01))
+    unsigned long long have = 0;
+    while (1)
     {
-        return 1;
-    }
-    if ((payload[4] | (payload[5] << 8)) != 0x86)
-    {
-        return 1;
-    }
-
-    const unsigned char N = 6; // header length
-
-    memcpy(&frame->gyro_bias, payload+N, 12);
-    memcpy(&frame->avg_accel, payload+N+12, 12);
-    memcpy(&frame->avg_mag, payload+N+24, 12);
-    memcpy(&frame->init_hdg, payload+N+36, 4);
-    memcpy(&frame->init_roll, payload+N+40, 4);
-    memcpy(&frame->init_pitch, payload+N+44, 4);
-    frame->USW = payload[N+48] | (payload[N+49] << 8);
-
-    frame->UT_sr = payload[N+50] | (payload[N+51] << 8) |
-                   (payload[N+52] << 16) | (payload[N+53] << 24);
-    frame->UP_sr = payload[N+54] | (payload[N+55] << 8) |
-                   (payload[N+56] << 16) | (payload[N+57] << 24);
-
-    frame->t_gyro[0] = payload[N+58] | (payload[N+59] << 8);
-    frame->t_gyro[1] = payload[N+60] | (payload[N+61] << 8);
-    frame->t_gyro[2] = payload[N+62] | (payload[N+63] << 8);
-
-    frame->t_acc[0] = payload[N+64] | (payload[N+65] << 8);
-    frame->t_acc[1] = payload[N+66] | (payload[N+67] << 8);
-    frame->t_acc[2] = payload[N+68] | (payload[N+69] << 8);
-
-    frame->t_mag[0] = payload[N+70] | (payload[N+71] << 8);
-    frame->t_mag[1] = payload[N+72] | (payload[N+73] << 8);
-    frame->t_mag[2] = payload[N+74] | (payload[N+75] << 8);
+        ssize_t n = read(fd, buf + have, stream_buffer_len - have);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0)
+        {
+            free(buf);
+            return 1;
+        }
 
-    memcpy(&frame->latitude, payload + N+76, 8);
-    memcpy(&frame->longitude, payload + N+84, 8);
-    memcpy(&frame->altitude, payload + N+92, 8);
-    memcpy(&frame->v_east, payload + N+100, 4);
-    memcpy(&frame->v_north, payload + N+104, 4);
-    memcpy(&frame->v_up, payload + N+108, 4);
-    memcpy(&frame->g_true, payload + N+112, 8);
-    memcpy(&frame->reserved1, payload + N+120, 4);
-    memcpy(&frame->reserved2, payload + N+124, 4);
+        have += n;
+        unsigned long long used =
+            convert_stream_block(st, buf, have, n == 0);
+        memmove(buf, buf + used, have - used);
+        have -= used;
+        // rows go out as soon as they're decoded
+        if (st->out) outbuf_flush(st->out);
 
-    unsigned short checksum = 0;
-    for (unsigned long i = 2; i < 134; ++i)
-    {
-        checksum += payload[i];
-    }
-    if (checksum != (payload[134] | (payload[135] << 8)))
-    {
-        return 1;
+        if (n == 0) break;
     }
 
+    free(buf);
     return 0;
 }
 
-// takes a opvt2ahr_t pointer and a pointer to the beginning of an
-// OPVT2AHR binary message; behavior is principally identical to
-// that of the above function
-// int payload2header(struct short_align_block*, unsigned char*)
-int payload2opvt2ahr(struct opvt2ahr_t *frame, unsigned char *payload)
+// context for following a growing log with --follow
+struct follow_state
 {
-    if (!frame || !payload) return 1;
+    struct stream_state st;
+    const char *ckpt_fn;
+};
 
-    if ((payload[0] != 0xAA) || (payload[1] != 0x55) ||
-        (payload[2] != 0x01) || (payload[3] != 0x58))
-    {
-        return 1;
-    }
+unsigned long long follow_decode(void *ctx,
+    unsigned char *buf, unsigned long long len)
+{
+    return convert_stream_block(&((struct follow_state*) ctx)->st,
+        buf, len, 0);
+}
 
-    const unsigned char N = 6; // header length
-
-    frame->heading = payload[N] | (payload[N+1] << 8);
-    frame->pitch = payload[N+2] | (payload[N+3] << 8);
-    frame->roll = payload[N+4] | (payload[N+5] << 8);
-
-    frame->gyro_x = payload[N+6] | (payload[N+7] << 8) |
-        (payload[N+8] << 16) | (payload[N+9] << 24);
-    frame->gyro_y = payload[N+10] | (payload[N+11] << 8) |
-        (payload[N+12] << 16) | (payload[N+13] << 24);
-    frame->gyro_z = payload[N+14] | (payload[N+15] << 8) |
-        (payload[N+16] << 16) | (payload[N+17] << 24);
-
-    frame->acc_x = payload[N+18] | (payload[N+19] << 8) |
-        (payload[N+20] << 16) | (payload[N+21] << 24);
-    frame->acc_y = payload[N+22] | payload[N+23] << 8 |
-        (payload[N+24] << 16) | (payload[N+25] << 24);
-    frame->acc_z = payload[N+26] | (payload[N+27] << 8) |
-        (payload[N+28] << 16) | (payload[N+29] << 24);
-
-    frame->mag_x = payload[N+30] | (payload[N+31] << 8);
-    frame->mag_y = payload[N+32] | (payload[N+33] << 8);
-    frame->mag_z = payload[N+34] | (payload[N+35] << 8);
-
-    frame->USW = payload[N+36] | (payload[N+37] << 8);
-    frame->vinp = payload[N+38] | (payload[N+39] << 8);
-    frame->temp = payload[N+40] | (payload[N+41] << 8);
-
-    frame->latitude = (long long) payload[N+42] |
-        ((long long) payload[N+43] << 8) |
-        ((long long) payload[N+44] << 16) |
-        ((long long) payload[N+45] << 24) |
-        ((long long) payload[N+46] << 32) |
-        ((long long) payload[N+47] << 40) |
-        ((long long) payload[N+48] << 48) |
-        ((long long) payload[N+49] << 56);
-    frame->longitude = (long long) payload[N+50] |
-        ((long long) payload[N+51] << 8) |
-        ((long long) payload[N+52] << 16) |
-        ((long long) payload[N+53] << 24) |
-        ((long long) payload[N+54] << 32) |
-        ((long long) payload[N+55] << 40) |
-        ((long long) payload[N+56] << 48) |
-        ((long long) payload[N+57] << 56);
-    frame->altitude = payload[N+58] | (payload[N+59] << 8) |
-        (payload[N+60] << 16) | (payload[N+61]) << 24;
-
-    frame->v_east = payload[N+62] | (payload[N+63] << 8) |
-        (payload[N+64] << 16) | (payload[N+65] << 24);
-    frame->v_north = payload[N+66] | (payload[N+67] << 8) |
-        (payload[N+68] << 16) | (payload[N+69] << 24);
-    frame->v_up = payload[N+70] | (payload[N+71] << 8) |
-        (payload[N+72] << 16) | (payload[N+73] << 24);
-
-    frame->lat_GNSS = (long long) payload[N+74] |
-        ((long long) payload[N+75] << 8) |
-        ((long long) payload[N+76] << 16) |
-        ((long long) payload[N+77] << 24) |
-        ((long long) payload[N+78] << 32) |
-        ((long long) payload[N+79] << 40) |
-        ((long long) payload[N+80] << 48) |
-        ((long long) payload[N+81] << 56);
-    frame->lon_GNSS = (long long) payload[82] |
-        ((long long) payload[N+83] << 8) |
-        ((long long) payload[N+84] << 16) |
-        ((long long) payload[N+85] << 24) |
-        ((long long) payload[N+86] << 32) |
-        ((long long) payload[N+87] << 40) |
-        ((long long) payload[N+88] << 48) |
-        ((long long) payload[N+89] << 56);
-    frame->alt_GNSS = payload[N+90] | (payload[N+91] << 8) |
-        (payload[N+92] << 16) | (payload[N+93] << 24);
-
-    frame->vh_GNSS = payload[N+94] | (payload[N+95] << 8) |
-        (payload[N+96] << 16) | (payload[N+97] << 24);
-    frame->track_grnd = payload[N+98] | (payload[N+99] << 8);
-    frame->vup_GNSS = payload[N+100] | (payload[N+101] << 8) |
-        (payload[N+102] << 16) | (payload[N+103] << 24);
-
-    frame->ms_gps = payload[N+104] | (payload[N+105] << 8) |
-        (payload[N+106] << 16) | (payload[N+107] << 24);
-    frame->GNSS_info1 = payload[N+108];
-    frame->GNSS_info2 = payload[N+109];
-    frame->solnSVs = payload[N+110];
-    frame->v_latency = payload[N+111] | (payload[N+112] << 8);
-    frame->angle_pos_type = payload[N+113];
-    frame->hdg_GNSS = payload[N+114] | (payload[N+115] << 8);
-
-    frame->latency_ms_hdg = payload[N+116] | (payload[N+117] << 8);
-    frame->latency_ms_pos = payload[N+118] | (payload[N+119] << 8);
-    frame->latency_ms_vel = payload[N+120] | (payload[N+121] << 8);
-
-    frame->p_bar = payload[N+122] | (payload[N+123] << 8);
-    frame->h_bar = payload[N+124] | (payload[N+125] << 8) |
-        (payload[N+126] << 16) | (payload[N+127] << 24);
-    frame->new_gps = payload[N+128];
-
-    unsigned short checksum = 0;
-    for (unsigned long i = 2; i < 135; ++i)
-    {
-        checksum += payload[i];
-    }
-    if (checksum != (payload[135] | (payload[136] << 8)))
-    {
-        return 1;
-    }
+// flushes the converted text and records how far the conversion got,
+// so that a restarted conversion can pick up from here
+void follow_checkpoint(void *ctx, unsigned long long offset)
+{
+    struct follow_state *fs = (struct follow_state*) ctx;
+    outbuf_flush(fs->st.out);
 
-    return 0;
+    struct checkpoint cp = {offset, {0, 0}, fs->st.header_printed};
+    cp.out_offset[0] = outbuf_tell(fs->st.out);
+    checkpoint_save(fs->ckpt_fn, &cp);
 }
 
-// prints a short alignment data block to the provided FILE*
-void print_header(FILE* out, struct short_align_block *frame)
+// what the -j callbacks need to know about the conversion
+struct chunk_job
 {
-    if (!out || !frame) return;
-
-    fprintf(out, "gyroscope bias: %.5f %.5f %.5f\n",
-        frame->gyro_bias[0], frame->gyro_bias[1], frame->gyro_bias[2]);
-    fprintf(out, "mean acceleration: %.5f %.5f %.5f\n",
-        frame->avg_accel[0], frame->avg_accel[1], frame->avg_accel[2]);
-    fprintf(out, "mean magnetic field: %.5f %.5f %.5f\n",
-        frame->avg_mag[0], frame->avg_mag[1], frame->avg_mag[2]);
-    fprintf(out, "initial orientation: %.3f %.3f %.3f\n",
-        frame->init_hdg, frame->init_pitch, frame->init_roll);
-    fprintf(out, "unit status word: 0x%04x\n", frame->USW);
-}
+    unsigned char pvoff_flag;
+    double *pvoff_input;
+    const struct il_projection *proj;
+};
 
-// prints an extended alignment data block to the provided FILE*
-void print_extheader(FILE *out, struct ext_align_block *frame)
+// the first OPVT2AHR frame at or after pos that decodes; -j chunks
+// start only there
+unsigned long long align_frame(void *ctx,
+    unsigned char *data, unsigned long long len, unsigned long long pos)
 {
-    if (!out || !frame) return;
-
-    fprintf(out, "gyroscope bias: %.5f %.5f %.5f\n",
-        frame->gyro_bias[0], frame->gyro_bias[1], frame->gyro_bias[2]);
-    fprintf(out, "mean acceleration: %.5f %.5f %.5f\n",
-        frame->avg_accel[0], frame->avg_accel[1], frame->avg_accel[2]);
-    fprintf(out, "mean magnetic field: %.5f %.5f %.5f\n",
-        frame->avg_mag[0], frame->avg_mag[1], frame->avg_mag[2]);
-    fprintf(out, "initial orientation: %.3f %.3f %.3f\n",
-        frame->init_hdg, frame->init_pitch, frame->init_roll);
-    fprintf(out, "unit status word: 0x%04x\n", frame->USW);
-    fprintf(out, "UT_sr: %ld; UP_sr: %ld\n",
-        frame->UT_sr, frame->UP_sr);
-    fprintf(out, "temp in gyro: %hd %hd %hd; acc: %hd %hd %hd; "
-                 "mag: %hd %hd %hd\n",
-        frame->t_gyro[0], frame->t_gyro[1], frame->t_gyro[2],
-        frame->t_acc[0], frame->t_acc[1], frame->t_acc[2],
-        frame->t_mag[0], frame->t_mag[1], frame->t_mag[2]);
-    fprintf(out, "coordinates: %.9f %.9f %.3f\n",
-        frame->latitude, frame->longitude, frame->altitude);
-    fprintf(out, "velocity: %.3f %.3f %.3f\n",
-        frame->v_east, frame->v_north, frame->v_up);
-    fprintf(out, "gravity: %.5f\n", frame->g_true);
-    fprintf(out, "reserved: %.6f %.6f\n",
-        frame->reserved1, frame->reserved2);
+    (void) ctx;
+    while (pos + 137 <= len)
+    {
+        struct opvt2ahr_t frame;
+        if (payload2opvt2ahr(&frame, data + pos) == 0) return pos;
+        ++pos;
+        pos += sync_scan(data + pos, len - pos, opvt2ahr_sync, 4);
+    }
+    return len;
 }
 
-// prints one line of OPVT2AHR data format to the provided FILE*,
-// imitating the INS Demo Report of Experiment format
-void println_opvt2ahr(FILE *out, struct opvt2ahr_t *frame)
+// the first OPVT2AHR frame at or after pos in the mapped log ctx, and
+// its ms_gps; --from bisects a log that has no index with this
+unsigned long long probe_frame(void *ctx, unsigned long long pos,
+    unsigned long *ms)
 {
-    if (!out) return;
-    if (!frame)
-    {
-        fprintf(out,
-               "        Heading"
-               "          Pitch"
-               "           Roll"
-               "         Gyro_X"
-               "         Gyro_Y"
-               "         Gyro_Z"
-               "          Acc_X"
-               "          Acc_Y"
-               "          Acc_Z"
-               "         Magn_X"
-               "         Magn_Y"
-               "         Magn_Z"
-               "    Temperature"
-               "            Vdd"
-               "            USW"
-               "       Latitude"
-               "      Longitude"
-               "       Altitude"
-               "         V_East"
-               "        V_North"
-               "           V_Up"
-               "       Lat_GNSS"
-               "      Long_GNSS"
-               "    Height_GNSS"
-               "        Hor_spd"
-               "        Trk_gnd"
-               "        Ver_spd"
-               "         ms_gps"
-               "    GNSS_info_1"
-               "    GNSS_info_2"
-               "       #solnSVs"
-               "        latency"
-               "  anglesPosType"
-               "   Heading_GNSS"
-               "    Latency_ms_head"
-               "     Latency_ms_pos"
-               "     Latency_ms_vel"
-               "          P_Bar"
-               "          H_Bar"
-               "        New_GPS\n");
-        return;
-    }
-
-    fprintf(out, "%15.2f%15.2f%15.2f",
-        frame->heading/100.0, frame->pitch/100.0, frame->roll/100.0);
-    fprintf(out, "%15.5f%15.5f%15.5f",
-        frame->gyro_x/1.0E5, frame->gyro_y/1.0E5, frame->gyro_z/1.0E5);
-    fprintf(out, "%15.6f%15.6f%15.6f",
-        frame->acc_x/1.0E6, frame->acc_y/1.0E6, frame->acc_z/1.0E6);
-    fprintf(out, "%15.1f%15.1f%15.1f",
-        frame->mag_x*10.0, frame->mag_y*10.0, frame->mag_z*10.0);
-    fprintf(out, "%15.1f%15.2f%15hu",
-        frame->temp/10.0, frame->vinp/100.0, frame->USW);
-    fprintf(out, "%15.9f%15.9f%15.7f",
-        frame->latitude/1.0E9, frame->longitude/1.0E9, frame->altitude/1.0E3);
-    fprintf(out, "%15.2f%15.2f%15.2f",
-        frame->v_east/100.0, frame->v_north/100.0, frame->v_up/100.0);
-    fprintf(out, "%15.9f%15.9f%15.7f",
-        frame->lat_GNSS/1.0E9, frame->lon_GNSS/1.0E9, frame->alt_GNSS/1.0E3);
-    fprintf(out, "%15.2f%15.2f%15.2f",
-        frame->vh_GNSS/100.0, frame->track_grnd/100.0, frame->vup_GNSS/100.0);
-    fprintf(out, "%15lu", frame->ms_gps);
-    fprintf(out, "%15hhu%15hhu",
-        frame->GNSS_info1, frame->GNSS_info2);
-    fprintf(out, "%15hhu%15hu%15hhu",
-        frame->solnSVs, frame->v_latency, frame->angle_pos_type);
-    fprintf(out, "%15.2f%19hhd%19hhd%19hhd",
-        frame->hdg_GNSS/100.0, frame->latency_ms_hdg,
-        frame->latency_ms_pos, frame->latency_ms_vel);
-    fprintf(out, "%15lu%15.2f%15hhu\n",
-        ((unsigned long) frame->p_bar)*2, frame->h_bar/100.0, frame->new_gps);
+    struct mapped_file *log = (struct mapped_file*) ctx;
+    pos = align_frame(0, log->data, log->len, pos);
+    struct opvt2ahr_t frame;
+    if (pos < log->len && !payload2opvt2ahr(&frame, log->data + pos))
+        *ms = frame.ms_gps;
+    return pos;
 }
 
-template <typename T>
-void apply_PV_offset(T &frame, double pvoff_input[3])
+// converts the frames of one -j chunk the way the file loop in main
+// does; a resync never looks further than the sync sequence that can
+// start the next chunk
+unsigned long long decode_chunk(void *ctx, unsigned char *data,
+    unsigned long long len, unsigned long long start,
+    unsigned long long stop, struct outbuf *outs, unsigned long long *tally)
 {
-    // rotations to radians; heading sign convention
-    // is inverted to follow the right-hand rule
-    double heading = (M_PI/180)*(360 - frame.heading/100.0),
-           pitch = (M_PI/180)*(frame.pitch/100.0),
-           roll = (M_PI/180)*(frame.roll/100.0);
-
-    // calculate rotation quaternion
-    // rotation convention is Z-X'-Y''
-    const Eigen::Vector3d const_offset =
-        {pvoff_input[0], pvoff_input[1], pvoff_input[2]};
-    auto qz = Eigen::AngleAxisd(heading, Eigen::Vector3d::UnitZ());
-    auto Xp = qz * Eigen::Vector3d::UnitX(),
-         Yp = qz * Eigen::Vector3d::UnitY();
-    auto qx = Eigen::AngleAxisd(pitch, Xp);
-    auto Ypp = qx * Yp;
-    auto qy = Eigen::AngleAxisd(roll, Ypp);
-    Eigen::Quaterniond qw = qz * qx * qy;
-    auto p_offset = qw * const_offset;
-    const unsigned long long R_EARTH = 6371000;
-
-    // add offset to opvt2ahr data frame before printing
-    frame.latitude += (180E9*p_offset.y())/(R_EARTH*M_PI);
-    double lat_rad = (M_PI/180)*(frame.latitude/1.0E9);
-    frame.longitude += (180E9*p_offset.x())/(R_EARTH*M_PI*cos(lat_rad));
-    frame.altitude += 1E3*p_offset.z();
-
-    // turn rate in radians per second
-    auto turn_rate = Eigen::Vector3d(
-        frame.gyro_x/1.0E5, frame.gyro_y/1.0E5, frame.gyro_z/1.0E5);
-    turn_rate = M_PI/180.0 * turn_rate;
-    auto v_offset = (qw * turn_rate).cross(qw * const_offset);
-    frame.v_east += v_offset.x();
-    frame.v_north += v_offset.y();
-    frame.v_up += v_offset.z();
+    struct chunk_job *job = (struct chunk_job*) ctx;
+    unsigned long long scan_len = stop + 3 < len ? stop + 3 : len;
+    const double *pvoff = job->pvoff_flag ? job->pvoff_input : 0;
+    struct frame_block block;
+    block.n = 0;
+    unsigned long long rptr = start;
+    (void) tally;
+    while (rptr < stop && rptr + 137 <= len)
+    {
+        if (payload2opvt2ahr(&block.frames[block.n], data + rptr))
+        {
+            ++rptr;
+            rptr += sync_scan(data + rptr, scan_len - rptr,
+                opvt2ahr_sync, 4);
+            continue;
+        }
+        if (++block.n == PV_BLOCK_LEN)
+            flush_frames(&block, pvoff, &outs[0], 0, job->proj);
+        rptr += 137;
+    }
+    flush_frames(&block, pvoff, &outs[0], 0, job->proj);
+    return rptr;
+}
 
-    /*
-    // print useful info to debug file
-    fprintf(debug, "%15lu%15.2f"
-        "%15.2f%15.2f%15.2f"
-        "%15.2f%15.2f%15.2f%15.2f"
-        "%15.5f%15.5f%15.5f"
-        "%15.3f%15.3f%15.3f"
-        "%15.3f%15.3f%15.3f\n",
-        frame.ms_gps, frame.heading/100.0,
-        heading*180/M_PI, pitch*180/M_PI, roll*180/M_PI,
-        qw.w(), qw.x(), qw.y(), qw.z(),
-        turn_rate.x(), turn_rate.y(), turn_rate.z(),
-        p_offset.x(), p_offset.y(), p_offset.z(),
-        v_offset.x(), v_offset.y(), v_offset.z());
-    */
+// the OPVT2AHR frames are the timed frames of --scan and --index
+int frame_ms(unsigned char *msg, unsigned long *ms)
+{
+    struct opvt2ahr_t frame;
+    if (payload2opvt2ahr(&frame, msg)) return 1;
+    *ms = frame.ms_gps;
+    return 0;
 }
 
 const char* argument_error =
@@ -485,10 +316,42 @@ const char* argument_error =
     "type '%s --usage' for more info\n";
 
 const char* usage_help =
-    "usage: %s infile [-o outfile] [-pv x y z]\n"
-    "  infile: file to be converted to text\n"
+    "usage: %s infile [-o outfile] [-pv x y z] [--format f] [--stream]\n"
+    "         [--fields list] [-j n] [--from s] [--to s]\n"
+    "         [--decimate hz [--average]]\n"
+    "       %s infile [-o outfile] [-pv x y z] [--fields list]\n"
+    "         --follow [--idle s]\n"
+    "       %s infile [--scan [--rate hz]] [--index]\n"
+    "  infile: file to be converted to text, or - for stdin\n"
     "  outfile: output filename\n"
-    "  x y z: position-velocity offset\n";
+    "  x y z: position-velocity offset\n"
+    "  [--format f]: text (the default), or columnar for one binary\n"
+    "    array per field in a .col file; see src/colfile.h\n"
+    "  [--stream]: read infile as a stream; implied for stdin,\n"
+    "    FIFOs and devices\n"
+    "  [-j, --jobs n]: convert text on n threads, or one per\n"
+    "    processor for 0; the output is the same as with 1\n"
+    "  [--fields list]: only write these columns, named by their\n"
+    "    titles or the fields of struct opvt2ahr_t and separated\n"
+    "    by commas, e.g. ms_gps,heading,pitch,roll\n"
+    "  [--decimate hz]: only convert the first frame in each 1/hz\n"
+    "    seconds of GPS time\n"
+    "  [--average]: with --decimate, write the mean gyros and\n"
+    "    accelerations since the last frame converted\n"
+    "  [--from s] [--to s]: only convert the frames from and to\n"
+    "    these GPS seconds into the week, inclusive; the start is\n"
+    "    found with infile.idx if there is one. times are taken\n"
+    "    the short way around a week rollover from the log's\n"
+    "  [--follow]: keep converting data appended to infile until\n"
+    "    the writer closes it, resuming from outfile.ckpt if present\n"
+    "  [--idle s]: with --follow, stop after s seconds without new\n"
+    "    data; 0 finishes a resumed conversion without waiting\n"
+    "  [--scan]: check every frame without converting any, and\n"
+    "    print a JSON summary of the log's timing and integrity\n"
+    "  [--rate hz]: with --scan, the data rate the INS was set to,\n"
+    "    for counting dropped frames; 200 by default\n"
+    "  [--index]: check every frame, and write infile.idx, an index\n"
+    "    of the log by ms_gps; see src/timeidx.h\n";
 
 int main(int argc, char** argv)
 {
@@ -502,38 +365,27 @@ int main(int argc, char** argv)
     // help string to stderr
     if (strcmp(argv[1], "--usage") == 0)
     {
-        printf(usage_help, argv[0]);
+        printf(usage_help, argv[0], argv[0], argv[0]);
         return 0;
     }
 
-    // open the OPVT2AHR/OPVT etc file; if can't open, return error
-    FILE *infile = fopen(argv[1], "rb");
-    if (!infile)
-    {
-        fprintf(stderr, "%s: failed to open '%s'\n", argv[0], argv[1]);
-        return 1;
-    }
-
-    unsigned long long filelen;
-    fseek(infile, 0, SEEK_END);
-    filelen = ftell(infile);
-    fseek(infile, 0, SEEK_SET);
-
-    if (filelen == 0)
-    {
-        fprintf(stderr, "%s: %s is an empty file\n", argv[0], argv[1]);
-        return 1;
-    }
-    const unsigned long framelen = 137;
-    if (filelen < framelen)
-    {
-        fprintf(stderr, "%s: %s is not long enough\n", argv[0], argv[1]);
-        return 1;
-    }
-
     unsigned char out_index = 0;
     unsigned char pvoff_flag = 0;
+    unsigned char stream_flag = 0;
+    unsigned char follow_flag = 0;
+    unsigned char columnar_flag = 0;
+    unsigned char scan_flag = 0;
+    unsigned char index_flag = 0;
+    unsigned char from_flag = 0, to_flag = 0;
+    unsigned long from_ms = 0, to_ms = 0;
+    unsigned char average_flag = 0;
+    double decimate_hz = 0;
+    struct il_projection projection;
+    const struct il_projection *proj = 0;
+    long idle_ms = -1;
+    unsigned jobs = 1;
     double pvoff_input[3] = {0};
+    double rate_hz = 200;
 
     for (int i = 2; i < argc; ++i)
     {
@@ -541,7 +393,7 @@ int main(int argc, char** argv)
         {
             if (argc < i + 2)
             {
-                fprintf(stderr, usage_help, argv[0]);
+                fprintf(stderr, usage_help, argv[0], argv[0], argv[0]);
                 return 1;
             }
             out_index = ++i;
@@ -550,7 +402,7 @@ int main(int argc, char** argv)
         {
             if (argc < i + 4)
             {
-                fprintf(stderr, usage_help, argv[0]);
+                fprintf(stderr, usage_help, argv[0], argv[0], argv[0]);
                 return 1;
             }
             pvoff_flag = 1;
@@ -558,6 +410,133 @@ int main(int argc, char** argv)
             pvoff_input[1] = atof(argv[++i]);
             pvoff_input[2] = atof(argv[++i]);
         }
+        else if (!strcmp(argv[i], "--stream"))
+        {
+            stream_flag = 1;
+        }
+        else if (!strcmp(argv[i], "--follow"))
+        {
+            follow_flag = 1;
+        }
+        else if (!strcmp(argv[i], "--scan"))
+        {
+            scan_flag = 1;
+        }
+        else if (!strcmp(argv[i], "--from") | !strcmp(argv[i], "--to"))
+        {
+            if (argc < i + 2)
+            {
+                fprintf(stderr, usage_help, argv[0], argv[0], argv[0]);
+                return 1;
+            }
+            int from = !strcmp(argv[i], "--from");
+            double tow = atof(argv[++i]);
+            if (!(tow >= 0 && tow < 604800))
+            {
+                fprintf(stderr, argument_error, argv[0], argv[i], argv[0]);
+                return 1;
+            }
+            if (from) from_flag = 1, from_ms = 1000*tow + 0.5;
+            else to_flag = 1, to_ms = 1000*tow + 0.5;
+        }
+        else if (!strcmp(argv[i], "--fields"))
+        {
+            if (argc < i + 2)
+            {
+                fprintf(stderr, usage_help, argv[0], argv[0], argv[0]);
+                return 1;
+            }
+            const char *bad;
+            int error = opvt2ahr_projection(&projection, argv[++i], &bad);
+            if (error == 2)
+            {
+                fprintf(stderr, "%s: at most %d fields may be chosen\n",
+                    argv[0], IL_MAX_FIELDS);
+                return 1;
+            }
+            if (error)
+            {
+                fprintf(stderr, "%s: no such field -- '%.*s'\n", argv[0],
+                    (int) strcspn(bad, ","), bad);
+                return 1;
+            }
+            proj = &projection;
+        }
+        else if (!strcmp(argv[i], "--decimate"))
+        {
+            if (argc < i + 2)
+            {
+                fprintf(stderr, usage_help, argv[0], argv[0], argv[0]);
+                return 1;
+            }
+            decimate_hz = atof(argv[++i]);
+            if (!(decimate_hz > 0))
+            {
+                fprintf(stderr, argument_error, argv[0], argv[i], argv[0]);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--average"))
+        {
+            average_flag = 1;
+        }
+        else if (!strcmp(argv[i], "--index"))
+        {
+            index_flag = 1;
+        }
+        else if (!strcmp(argv[i], "--rate"))
+        {
+            if (argc < i + 2)
+            {
+                fprintf(stderr, usage_help, argv[0], argv[0], argv[0]);
+                return 1;
+            }
+            rate_hz = atof(argv[++i]);
+            if (!(rate_hz > 0))
+            {
+                fprintf(stderr, argument_error, argv[0], argv[i], argv[0]);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--format"))
+        {
+            if (argc < i + 2)
+            {
+                fprintf(stderr, usage_help, argv[0], argv[0], argv[0]);
+                return 1;
+            }
+            ++i;
+            if (!strcmp(argv[i], "columnar")) columnar_flag = 1;
+            else if (strcmp(argv[i], "text"))
+            {
+                fprintf(stderr, argument_error, argv[0], argv[i], argv[0]);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--idle"))
+        {
+            if (argc < i + 2)
+            {
+                fprintf(stderr, usage_help, argv[0], argv[0], argv[0]);
+                return 1;
+            }
+            idle_ms = 1000*atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-j") | !strcmp(argv[i], "--jobs"))
+        {
+            if (argc < i + 2)
+            {
+                fprintf(stderr, usage_help, argv[0], argv[0], argv[0]);
+                return 1;
+            }
+            int n = atoi(argv[++i]);
+            if (n < 0)
+            {
+                fprintf(stderr, argument_error, argv[0], argv[i], argv[0]);
+                return 1;
+            }
+            jobs = n ? n : parconv_cpus();
+        }
         else // if any argument is unexpected, throw argument error
         {
             fprintf(stderr, argument_error, argv[0], argv[i], argv[0]);
@@ -565,15 +544,112 @@ int main(int argc, char** argv)
         }
     }
 
-    unsigned char *file_buffer = (unsigned char*) malloc(filelen);
-    if (!file_buffer)
+    // anything that can't be mapped (stdin, a pipe from str2str, a
+    // serial device) is converted as a stream instead
+    struct stat instat;
+    unsigned char stdin_flag = !strcmp(argv[1], "-");
+    if (stdin_flag || (stat(argv[1], &instat) == 0 &&
+        !S_ISREG(instat.st_mode)))
     {
-        fprintf(stderr, "%s: memory allocation error\n", argv[0]);
+        stream_flag = 1;
+    }
+
+    if (follow_flag && stream_flag)
+    {
+        fprintf(stderr, "%s: --follow needs a regular file\n", argv[0]);
+        return 1;
+    }
+
+    // a scan reads the whole log at once and writes nothing else
+    if ((scan_flag || index_flag) && (stream_flag || follow_flag))
+    {
+        fprintf(stderr, "%s: --scan and --index need a regular file\n",
+            argv[0]);
+        return 1;
+    }
+
+    // a window is found by seeking in a whole file, and cuts off the
+    // rows of whatever chunk it ends in
+    if ((from_flag || to_flag) && (stream_flag || follow_flag || jobs > 1))
+    {
+        fprintf(stderr, "%s: --from and --to only convert a whole file "
+            "on one thread\n", argv[0]);
+        return 1;
+    }
+
+    // which frame of a cell comes first depends on every frame before
+    // it, which neither a chunk nor a resumed conversion has seen
+    if (decimate_hz && (follow_flag || jobs > 1))
+    {
+        fprintf(stderr, "%s: --decimate doesn't work with --follow or -j\n",
+            argv[0]);
         return 1;
     }
+    if (average_flag && !decimate_hz)
+    {
+        fprintf(stderr, "%s: --average needs --decimate\n", argv[0]);
+        return 1;
+    }
+    struct decimator decim;
+    decim_init(&decim, decimate_hz ? decimate_hz : 1, average_flag ? 6 : 0);
+
+    // a columnar file can only be laid out once every row is known
+    if (follow_flag && columnar_flag)
+    {
+        fprintf(stderr, "%s: --follow only writes text\n", argv[0]);
+        return 1;
+    }
+
+    // chunks are converted out of order, and can only be split from a
+    // file that's all there; rows of columns are laid out in order
+    if (jobs > 1 && (stream_flag || follow_flag || columnar_flag))
+    {
+        fprintf(stderr, "%s: -j only converts a whole file to text\n",
+            argv[0]);
+        return 1;
+    }
+
+    struct mapped_file infile = {0, 0, -1};
+    unsigned long long filelen = 0;
+    const unsigned long framelen = 137;
+    if (!stream_flag && !follow_flag)
+    {
+        // map the OPVT2AHR/OPVT etc file; if can't open, return error
+        if (map_file(&infile, argv[1]))
+        {
+            fprintf(stderr, "%s: failed to open '%s'\n", argv[0], argv[1]);
+            return 1;
+        }
+
+        filelen = infile.len;
+
+        if (filelen == 0)
+        {
+            fprintf(stderr, "%s: %s is an empty file\n", argv[0], argv[1]);
+            return 1;
+        }
+        if (filelen < framelen)
+        {
+            fprintf(stderr, "%s: %s is not long enough\n", argv[0], argv[1]);
+            return 1;
+        }
+    }
 
-    fread(file_buffer, 1, filelen, infile);
-    fclose(infile);
+    unsigned char *file_buffer = infile.data;
+
+    if (scan_flag || index_flag)
+    {
+        struct scan_stats stats;
+        struct timeidx index;
+        scan_init(&stats, filelen, rate_hz);
+        timeidx_init(&index, IL_OPVT2AHR_TYPE);
+        ilscan_log(file_buffer, filelen, IL_OPVT2AHR_TYPE, IL_OPVT2AHR_LEN,
+            frame_ms, &stats, index_flag ? &index : 0);
+        if (scan_flag) scan_print(stdout, &stats, argv[1], "OPVT2AHR");
+        unmap_file(&infile);
+        return index_flag && save_index(argv[0], &index, argv[1], filelen,
+            "frames");
+    }
 
     char *outfn = (char*) malloc(strlen(argv[1]) + 1);
     if (!outfn)
@@ -582,6 +658,7 @@ int main(int argc, char** argv)
         return 1;
     }
     strcpy(outfn, argv[1]);
+    const char *out_ext = columnar_flag ? ".col" : ".txt";
     char *ext_ptr = strstr(outfn, ".bin");
     if (!ext_ptr) // file does not contain ".bin", so tack ".txt" on the end
     {
@@ -593,25 +670,149 @@ int main(int argc, char** argv)
             return 1;
         }
         strcpy(outfn, argv[1]);
-        strcpy(outfn + strlen(outfn), ".txt");
+        strcpy(outfn + strlen(outfn), out_ext);
     }
     else // replace ".bin" with ".txt"
     {
-        strcpy(ext_ptr, ".txt");
+        strcpy(ext_ptr, out_ext);
     }
 
-    FILE *outfile;
+    // converted text goes through a double-buffered writer thread
+    struct outbuf out;
+    struct outbuf *outfile = &out;
+    int outfd;
     if (out_index)
     {
         outfn = argv[out_index];
     }
-    outfile = fopen(outfn, "wb");
-    if (!outfile)
+
+    if (follow_flag)
+    {
+        struct follow_state fs = {{0, 0, pvoff_flag, pvoff_input, 0, 0}, 0};
+        char *ckpt_fn = (char*) malloc(strlen(outfn) + 6);
+        if (!ckpt_fn)
+        {
+            fprintf(stderr, "%s: memory allocation error\n", argv[0]);
+            return 1;
+        }
+        strcpy(ckpt_fn, outfn);
+        strcat(ckpt_fn, ".ckpt");
+        fs.ckpt_fn = ckpt_fn;
+        fs.st.proj = proj;
+
+        // resume only if the output still holds everything the
+        // checkpoint says was written; anything written after the
+        // checkpoint is discarded and converted again
+        struct checkpoint cp;
+        struct stat outstat;
+        unsigned long long offset = 0;
+        if (checkpoint_load(ckpt_fn, &cp) == 0 &&
+            stat(outfn, &outstat) == 0 &&
+            (unsigned long long) outstat.st_size >= cp.out_offset[0] &&
+            truncate(outfn, cp.out_offset[0]) == 0)
+        {
+            offset = cp.in_offset;
+            fs.st.header_printed = cp.flags;
+            outfd = open(outfn, O_WRONLY);
+            if (outfd != -1) lseek(outfd, 0, SEEK_END);
+            fprintf(stderr, "%s: resuming '%s' at 0x%02llx\n",
+                argv[0], argv[1], offset);
+        }
+        else outfd = open(outfn, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (outfd == -1 || outbuf_open(outfile, outfd, OUTBUF_DEFAULT_CAP))
+        {
+            fprintf(stderr, "%s: failed to open '%s'\n", argv[0], outfn);
+            return 1;
+        }
+        if (offset == 0)
+        {
+            outbuf_printf(outfile,
+                "post-test applied PV offset: %.2f %.2f %.2f\n",
+                pvoff_input[0], pvoff_input[1], pvoff_input[2]);
+        }
+
+        fs.st.out = outfile;
+        if (follow_file(argv[1], offset, idle_ms,
+            follow_decode, follow_checkpoint, &fs))
+        {
+            fprintf(stderr, "%s: failed to follow '%s'\n", argv[0], argv[1]);
+            return 1;
+        }
+        fprintf(stderr, "%s: Converted %llu frames.\n",
+            argv[0], fs.st.frames);
+        free(ckpt_fn);
+        return close_output(argv[0], outfile, outfd);
+    }
+
+    if (stdin_flag && !out_index) // stdin to stdout, like a filter
+    {
+        outfd = 1;
+    }
+    else outfd = open(outfn, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    // rows that outgrow memory while writing columns are kept in a
+    // scratch file next to the output until it's assembled
+    struct colfile col;
+    struct colfile *colfile = 0;
+    if (columnar_flag)
+    {
+        char *scratch_fn = (char*) malloc(strlen(outfn) + 6);
+        if (!scratch_fn)
+        {
+            fprintf(stderr, "%s: memory allocation error\n", argv[0]);
+            return 1;
+        }
+        strcpy(scratch_fn, outfn);
+        strcat(scratch_fn, ".part");
+        if (outfd == -1 || (proj ?
+            colfile_open(&col, outfd, scratch_fn, proj->cols, proj->n) :
+            colfile_open(&col, outfd, scratch_fn,
+                opvt2ahr_cols, opvt2ahr_ncols)))
+        {
+            fprintf(stderr, "%s: failed to open '%s'\n", argv[0], outfn);
+            return 1;
+        }
+        free(scratch_fn);
+        colfile = &col;
+        outfile = 0;
+    }
+    else if (outfd == -1 || outbuf_open(outfile, outfd, OUTBUF_DEFAULT_CAP))
     {
         fprintf(stderr, "%s: failed to open '%s'\n", argv[0], outfn);
         return 1;
     }
 
+    if (stream_flag)
+    {
+        int fd = stdin_flag ? 0 : open(argv[1], O_RDONLY);
+        if (fd == -1)
+        {
+            fprintf(stderr, "%s: failed to open '%s'\n", argv[0], argv[1]);
+            return 1;
+        }
+
+        if (outfile)
+        {
+            outbuf_printf(outfile,
+                "post-test applied PV offset: %.2f %.2f %.2f\n",
+                pvoff_input[0], pvoff_input[1], pvoff_input[2]);
+        }
+
+        struct stream_state st =
+            {outfile, colfile, pvoff_flag, pvoff_input, 0, 0, 0};
+        if (decimate_hz) st.decim = &decim;
+        st.proj = proj;
+        if (convert_stream(fd, &st))
+        {
+            fprintf(stderr, "%s: error reading '%s'\n", argv[0], argv[1]);
+            return 1;
+        }
+        fprintf(stderr, "%s: Converted %llu frames.\n", argv[0], st.frames);
+        if (!stdin_flag) close(fd);
+        if (colfile) return close_columnar(argv[0], colfile, outfd);
+        return close_output(argv[0], outfile, outfd);
+    }
+
     // FILE *debug;
     /*
     if (pvoff_flag)
@@ -632,8 +833,12 @@ int main(int argc, char** argv)
 
     unsigned long long rptr = 0;
 
-    fprintf(outfile, "post-test applied PV offset: %.2f %.2f %.2f\n",
-        pvoff_input[0], pvoff_input[1], pvoff_input[2]);
+    if (outfile)
+    {
+        outbuf_printf(outfile,
+            "post-test applied PV offset: %.2f %.2f %.2f\n",
+            pvoff_input[0], pvoff_input[1], pvoff_input[2]);
+    }
 
     // TODO: include checksum verification
 
@@ -658,6 +863,12 @@ int main(int argc, char** argv)
     }
 
     unsigned short msg_len = file_buffer[rptr+4] | (file_buffer[rptr+5] << 8);
+    if (rptr + msg_len + 2 > filelen)
+    {
+            fprintf(stderr, "%s: file align block truncated at 0x%02llx\n",
+                argv[0], rptr);
+            return 1;
+    }
     if (msg_len == 0x38) // short alignment block
     {
         struct short_align_block header;
@@ -673,33 +884,75 @@ int main(int argc, char** argv)
         rptr += 136;
     }
 
-    unsigned char progress, old_progress = 255;
+    struct progress progress;
+    progress_init(&progress, argv[0], 0, filelen);
 
-    fprintf(outfile, "\n");
-    println_opvt2ahr(outfile, 0);
-    while (rptr < filelen)
+    if (outfile) outbuf_printf(outfile, "\n");
+    println_frame(outfile, proj, 0);
+    if (jobs > 1)
+    {
+        struct chunk_job job = {pvoff_flag, pvoff_input, proj};
+        if (parconv_run(file_buffer, filelen, rptr, jobs, align_frame,
+            decode_chunk, &progress, &job, &outfile, 1, 0))
+        {
+            fprintf(stderr, "\n%s: memory allocation error\n", argv[0]);
+            return 1;
+        }
+        rptr = filelen;
+    }
+    if (from_flag)
+    {
+        // skip straight to the window, with the log's index if it has a
+        // usable one and by bisecting the log if not
+        struct timeidx index;
+        char *idx_fn = timeidx_filename(argv[1]);
+        int indexed = idx_fn &&
+            !timeidx_load(&index, idx_fn, IL_OPVT2AHR_TYPE, filelen);
+        rptr = timeidx_seek(indexed ? &index : 0, probe_frame, &infile,
+            rptr, filelen, from_ms);
+        if (indexed) timeidx_free(&index);
+        free(idx_fn);
+    }
+    const double *pvoff = pvoff_flag ? pvoff_input : 0;
+    struct frame_block block;
+    block.n = 0;
+    // the input is mapped rather than copied, so never let a frame
+    // parse run past the end of the file
+    while (rptr + framelen <= filelen)
     {
         // at the beginning of every iteration,
         // rptr will point at the AA in the beginning
         // of every packet
-        struct opvt2ahr_t frame;
-        if (payload2opvt2ahr(&frame, file_buffer + rptr))
+        if (payload2opvt2ahr(&block.frames[block.n], file_buffer + rptr))
         {
+            // resync at the next OPVT2AHR sync sequence
             ++rptr;
+            rptr += sync_scan(file_buffer + rptr, filelen - rptr,
+                opvt2ahr_sync, 4);
             continue;
         }
-        if (pvoff_flag) apply_PV_offset(frame, pvoff_input);
-        println_opvt2ahr(outfile, &frame);
+        // frames outside the window or between the rows of --decimate
+        // are never offset or formatted, and the first frame past the
+        // window ends the conversion
+        unsigned long ms = block.frames[block.n].ms_gps;
+        if (to_flag && timeidx_diff(ms, to_ms) > 0) break;
+        if ((from_flag && timeidx_diff(ms, from_ms) < 0) ||
+            (decimate_hz && !decimate_frame(&decim, &block.frames[block.n])))
+        {
+            rptr += framelen;
+            continue;
+        }
+        // frames are offset and written out a block at a time
+        if (++block.n == PV_BLOCK_LEN)
+            flush_frames(&block, pvoff, outfile, colfile, proj);
         rptr += framelen;
-        fflush(outfile);
-
-        progress = 100*rptr/filelen;
-        if (progress != old_progress)
-            fprintf(stderr, "\r%s: Writing... %2hhu%%",
-                argv[0], progress);
+        progress_update(&progress, rptr);
     }
-    fprintf(stderr, "\r%s: Writing... Done.\n", argv[0]);
-    fclose(outfile);
+    flush_frames(&block, pvoff, outfile, colfile, proj);
+    progress_done(&progress);
+    unmap_file(&infile);
+    if (colfile) return close_columnar(argv[0], colfile, outfd);
+    if (close_output(argv[0], outfile, outfd)) return 1;
     // if (pvoff_flag) fclose(debug);
     return 0;
 }
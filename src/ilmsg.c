@@ -0,0 +1,545 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "ilmsg.h"
+#include "fmtnum.h"
+
+// little-endian loads of each type a field can have. every offset the
+// decoders pass is a constant, so each of these compiles to a single
+// load of the right width, with no branching on the field
+static inline unsigned char il_get_U8(const unsigned char *p)
+{
+    return p[0];
+}
+
+static inline signed char il_get_I8(const unsigned char *p)
+{
+    return (signed char) p[0];
+}
+
+static inline unsigned short il_get_U16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static inline signed short il_get_I16(const unsigned char *p)
+{
+    return (signed short) il_get_U16(p);
+}
+
+static inline unsigned long il_get_U32(const unsigned char *p)
+{
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) |
+        ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static inline signed long il_get_I32(const unsigned char *p)
+{
+    return (int32_t) il_get_U32(p);
+}
+
+static inline signed long long il_get_I64(const unsigned char *p)
+{
+    return (int64_t) (il_get_U32(p) | ((uint64_t) il_get_U32(p+4) << 32));
+}
+
+static inline float il_get_F32(const unsigned char *p)
+{
+    float value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline double il_get_F64(const unsigned char *p)
+{
+    double value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// the stores that encode each type, the reverse of the loads above
+static inline void il_put_U8(unsigned char *p, unsigned char value)
+{
+    p[0] = value;
+}
+
+static inline void il_put_I8(unsigned char *p, signed char value)
+{
+    p[0] = (unsigned char) value;
+}
+
+static inline void il_put_U16(unsigned char *p, unsigned short value)
+{
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+}
+
+static inline void il_put_I16(unsigned char *p, signed short value)
+{
+    il_put_U16(p, (unsigned short) value);
+}
+
+static inline void il_put_U32(unsigned char *p, unsigned long value)
+{
+    for (int i = 0; i < 4; ++i) p[i] = (value >> 8*i) & 0xFF;
+}
+
+static inline void il_put_I32(unsigned char *p, signed long value)
+{
+    il_put_U32(p, (uint32_t) value);
+}
+
+static inline void il_put_I64(unsigned char *p, signed long long value)
+{
+    il_put_U32(p, (uint64_t) value & 0xFFFFFFFF);
+    il_put_U32(p + 4, (uint64_t) value >> 32);
+}
+
+static inline void il_put_F32(unsigned char *p, float value)
+{
+    memcpy(p, &value, sizeof(value));
+}
+
+static inline void il_put_F64(unsigned char *p, double value)
+{
+    memcpy(p, &value, sizeof(value));
+}
+
+// the statements that decode each kind of field table entry into frame
+#define IL_LOAD_SCALAR(type, name, offset) \
+    frame->name = il_get_##type(payload + IL_HEADER_LEN + (offset));
+#define IL_LOAD_ARRAY(type, name, offset, count) \
+    for (int i = 0; i < (count); ++i) \
+        frame->name[i] = il_get_##type(payload + IL_HEADER_LEN + (offset) \
+            + i*sizeof(frame->name[0]));
+#define IL_LOAD_FIELD(type, name, offset, title, width, format, \
+                      multiplier, decimals, scale) \
+    IL_LOAD_SCALAR(type, name, offset)
+
+// the statements that encode each kind of field table entry from frame
+#define IL_STORE_SCALAR(type, name, offset) \
+    il_put_##type(payload + IL_HEADER_LEN + (offset), frame->name);
+#define IL_STORE_ARRAY(type, name, offset, count) \
+    for (int i = 0; i < (count); ++i) \
+        il_put_##type(payload + IL_HEADER_LEN + (offset) \
+            + i*sizeof(frame->name[0]), frame->name[i]);
+#define IL_STORE_FIELD(type, name, offset, title, width, format, \
+                       multiplier, decimals, scale) \
+    IL_STORE_SCALAR(type, name, offset)
+
+// nonzero if payload doesn't start with the sync bytes and class every
+// message shares
+static int il_bad_sync(const unsigned char *payload)
+{
+    return (payload[0] != 0xAA) || (payload[1] != 0x55) ||
+        (payload[2] != 0x01);
+}
+
+// nonzero if the checksum closing the len byte message at payload
+// matches the sum of the bytes between the sync bytes and it
+int il_checksum_ok(const unsigned char *payload, unsigned long len)
+{
+    unsigned short checksum = 0;
+    for (unsigned long i = 2; i < len - 2; ++i)
+    {
+        checksum += payload[i];
+    }
+    return checksum == il_get_U16(payload + len - 2);
+}
+
+// takes a pointer to a short_align_block struct, and a pointer to
+// an unsigned char array. the unsigned char pointer MUST point
+// to the first sync byte of the message, i.e. 0xAA. the sync bytes
+// defined by the INS ICD are 0xAA, 0x55. if the payload pointer does
+// not point at the sync bytes of the binary message, the function
+// will return an error code and the resulting short_align_block
+// is invalid. upon success, the function will return 0.
+int payload2header(struct short_align_block *frame,
+                        unsigned char *payload)
+{
+    if (!frame || !payload) return 1;
+    if (il_bad_sync(payload)) return 1;
+    if (il_get_U16(payload + 4) != IL_ALIGN_LEN - 2) return 1;
+
+    IL_ALIGN_FIELDS(IL_LOAD_SCALAR, IL_LOAD_ARRAY)
+    return !il_checksum_ok(payload, IL_ALIGN_LEN);
+}
+
+// takes a ext_align_block pointer and a pointer to the beginning
+// of an extended alignment block binary message; behavior is
+// principally identical to that of the above function
+// int payload2header(struct short_align_block*, unsigned char*)
+int payload2extheader(struct ext_align_block *frame,
+                        unsigned char *payload)
+{
+    if (!frame || !payload) return 1;
+    if (il_bad_sync(payload)) return 1;
+    if (il_get_U16(payload + 4) != IL_EXT_ALIGN_LEN - 2) return 1;
+
+    IL_EXT_ALIGN_FIELDS(IL_LOAD_SCALAR, IL_LOAD_ARRAY)
+    return !il_checksum_ok(payload, IL_EXT_ALIGN_LEN);
+}
+
+// takes a opvt2ahr_t pointer and a pointer to the beginning of an
+// OPVT2AHR binary message; behavior is principally identical to
+// that of the above function
+// int payload2header(struct short_align_block*, unsigned char*)
+int payload2opvt2ahr(struct opvt2ahr_t *frame, unsigned char *payload)
+{
+    if (!frame || !payload) return 1;
+    if (il_bad_sync(payload) || payload[3] != IL_OPVT2AHR_TYPE) return 1;
+
+    IL_OPVT2AHR_FIELDS(IL_LOAD_FIELD)
+    return !il_checksum_ok(payload, IL_OPVT2AHR_LEN);
+}
+
+// takes an opvt_t pointer and a pointer to the beginning of an OPVT
+// binary message; see payload2opvt2ahr
+int payload2opvt(struct opvt_t *frame, unsigned char *payload)
+{
+    if (!frame || !payload) return 1;
+    if (il_bad_sync(payload) || payload[3] != IL_OPVT_TYPE) return 1;
+
+    IL_OPVT_FIELDS(IL_LOAD_FIELD)
+    return !il_checksum_ok(payload, IL_OPVT_LEN);
+}
+
+// writes the header of a len byte message of the given type at
+// payload, and the checksum of what's between them; the fields must
+// already be in place
+static void il_seal(unsigned char *payload, unsigned char type,
+                    unsigned long len)
+{
+    payload[0] = 0xAA;
+    payload[1] = 0x55;
+    payload[2] = 0x01;
+    payload[3] = type;
+    il_put_U16(payload + 4, len - 2);
+    unsigned short checksum = 0;
+    for (unsigned long i = 2; i < len - 2; ++i)
+    {
+        checksum += payload[i];
+    }
+    il_put_U16(payload + len - 2, checksum);
+}
+
+void header2payload(const struct short_align_block *frame,
+                    unsigned char *payload)
+{
+    IL_ALIGN_FIELDS(IL_STORE_SCALAR, IL_STORE_ARRAY)
+    il_seal(payload, IL_ALIGN_TYPE, IL_ALIGN_LEN);
+}
+
+void extheader2payload(const struct ext_align_block *frame,
+                       unsigned char *payload)
+{
+    IL_EXT_ALIGN_FIELDS(IL_STORE_SCALAR, IL_STORE_ARRAY)
+    il_seal(payload, IL_ALIGN_TYPE, IL_EXT_ALIGN_LEN);
+}
+
+void opvt2ahr2payload(const struct opvt2ahr_t *frame, unsigned char *payload)
+{
+    IL_OPVT2AHR_FIELDS(IL_STORE_FIELD)
+    il_seal(payload, IL_OPVT2AHR_TYPE, IL_OPVT2AHR_LEN);
+}
+
+void opvt2payload(const struct opvt_t *frame, unsigned char *payload)
+{
+    IL_OPVT_FIELDS(IL_STORE_FIELD)
+    il_seal(payload, IL_OPVT_TYPE, IL_OPVT_LEN);
+}
+
+// prints a short alignment data block to the provided outbuf
+void print_header(struct outbuf *out, struct short_align_block *frame)
+{
+    if (!out || !frame) return;
+
+    outbuf_printf(out, "gyroscope bias: %.5f %.5f %.5f\n",
+        frame->gyro_bias[0], frame->gyro_bias[1], frame->gyro_bias[2]);
+    outbuf_printf(out, "mean acceleration: %.5f %.5f %.5f\n",
+        frame->avg_accel[0], frame->avg_accel[1], frame->avg_accel[2]);
+    outbuf_printf(out, "mean magnetic field: %.5f %.5f %.5f\n",
+        frame->avg_mag[0], frame->avg_mag[1], frame->avg_mag[2]);
+    outbuf_printf(out, "initial orientation: %.3f %.3f %.3f\n",
+        frame->init_hdg, frame->init_pitch, frame->init_roll);
+    outbuf_printf(out, "unit status word: 0x%04x\n", frame->USW);
+}
+
+// prints an extended alignment data block to the provided outbuf
+void print_extheader(struct outbuf *out, struct ext_align_block *frame)
+{
+    if (!out || !frame) return;
+
+    outbuf_printf(out, "gyroscope bias: %.5f %.5f %.5f\n",
+        frame->gyro_bias[0], frame->gyro_bias[1], frame->gyro_bias[2]);
+    outbuf_printf(out, "mean acceleration: %.5f %.5f %.5f\n",
+        frame->avg_accel[0], frame->avg_accel[1], frame->avg_accel[2]);
+    outbuf_printf(out, "mean magnetic field: %.5f %.5f %.5f\n",
+        frame->avg_mag[0], frame->avg_mag[1], frame->avg_mag[2]);
+    outbuf_printf(out, "initial orientation: %.3f %.3f %.3f\n",
+        frame->init_hdg, frame->init_pitch, frame->init_roll);
+    outbuf_printf(out, "unit status word: 0x%04x\n", frame->USW);
+    outbuf_printf(out, "UT_sr: %ld; UP_sr: %ld\n",
+        frame->UT_sr, frame->UP_sr);
+    outbuf_printf(out, "temp in gyro: %hd %hd %hd; acc: %hd %hd %hd; "
+                 "mag: %hd %hd %hd\n",
+        frame->t_gyro[0], frame->t_gyro[1], frame->t_gyro[2],
+        frame->t_acc[0], frame->t_acc[1], frame->t_acc[2],
+        frame->t_mag[0], frame->t_mag[1], frame->t_mag[2]);
+    outbuf_printf(out, "coordinates: %.9f %.9f %.3f\n",
+        frame->latitude, frame->longitude, frame->altitude);
+    outbuf_printf(out, "velocity: %.3f %.3f %.3f\n",
+        frame->v_east, frame->v_north, frame->v_up);
+    outbuf_printf(out, "gravity: %.5f\n", frame->g_true);
+    outbuf_printf(out, "reserved: %.6f %.6f\n",
+        frame->reserved1, frame->reserved2);
+}
+
+// the text of each format a field table can give a field; every field
+// is a scaled integer, so it's produced directly rather than through
+// printf, see fmtnum.h
+#define IL_FMT_FIXED(p, width, value, multiplier, decimals) \
+    fmt_fixed(p, width, (long long) (value)*(multiplier), decimals)
+#define IL_FMT_UINT(p, width, value, multiplier, decimals) \
+    fmt_uint(p, width, (unsigned long long) (value)*(multiplier))
+#define IL_FMT_LOWBYTE(p, width, value, multiplier, decimals) \
+    fmt_fixed(p, width, (signed char) (value), 0)
+
+#define IL_TITLE(type, name, offset, title, width, format, \
+                 multiplier, decimals, scale) \
+    outbuf_printf(out, "%*s", width, title);
+#define IL_TEXT(type, name, offset, title, width, format, \
+                multiplier, decimals, scale) \
+    p = IL_FMT_##format(p, width, frame->name, multiplier, decimals);
+#define IL_COL_DESC(type, name, offset, title, width, format, \
+                    multiplier, decimals, scale) \
+    {title, COL_##type, scale},
+#define IL_COL_PUT(type, name, offset, title, width, format, \
+                   multiplier, decimals, scale) \
+    colfile_put_int(col, frame->name);
+
+// upper bound on the length of one OPVT2AHR row: 40 fields of 15 or
+// 19 characters, with room to spare for fields that overflow
+const unsigned long opvt2ahr_row_max = 1024;
+
+// prints one line of OPVT2AHR data format to the provided outbuf,
+// imitating the INS Demo Report of Experiment format
+void println_opvt2ahr(struct outbuf *out, struct opvt2ahr_t *frame)
+{
+    if (!out) return;
+    if (!frame)
+    {
+        IL_OPVT2AHR_FIELDS(IL_TITLE)
+        outbuf_printf(out, "\n");
+        return;
+    }
+
+    char *row = outbuf_reserve(out, opvt2ahr_row_max);
+    if (!row) return;
+    char *p = row;
+    IL_OPVT2AHR_FIELDS(IL_TEXT)
+    *p++ = '\n';
+    outbuf_commit(out, p - row);
+}
+
+// columns written by --format columnar, named after the text columns.
+// values are stored exactly as they arrive in the log, with the scale
+// that turns them into the units printed in the text output
+const struct col_desc opvt2ahr_cols[] =
+{
+    IL_OPVT2AHR_FIELDS(IL_COL_DESC)
+};
+const unsigned opvt2ahr_ncols =
+    sizeof(opvt2ahr_cols)/sizeof(opvt2ahr_cols[0]);
+
+// appends one OPVT2AHR frame as a row of opvt2ahr_cols
+void colrow_opvt2ahr(struct colfile *col, struct opvt2ahr_t *frame)
+{
+    IL_OPVT2AHR_FIELDS(IL_COL_PUT)
+    colfile_end_row(col);
+}
+
+// upper bound on the length of one OPVT row: 36 fields of 15 or 19
+// characters, with room to spare for fields that overflow
+const unsigned long opvt_row_max = 1024;
+
+void println_opvt(struct outbuf *out, struct opvt_t *frame)
+{
+    if (!out) return;
+    if (!frame)
+    {
+        IL_OPVT_FIELDS(IL_TITLE)
+        outbuf_printf(out, "\n");
+        return;
+    }
+
+    char *row = outbuf_reserve(out, opvt_row_max);
+    if (!row) return;
+    char *p = row;
+    IL_OPVT_FIELDS(IL_TEXT)
+    *p++ = '\n';
+    outbuf_commit(out, p - row);
+}
+
+// columns of an OPVT frame, stored as for OPVT2AHR
+const struct col_desc opvt_cols[] =
+{
+    IL_OPVT_FIELDS(IL_COL_DESC)
+};
+const unsigned opvt_ncols = sizeof(opvt_cols)/sizeof(opvt_cols[0]);
+
+// appends one OPVT frame as a row of opvt_cols
+void colrow_opvt(struct colfile *col, struct opvt_t *frame)
+{
+    IL_OPVT_FIELDS(IL_COL_PUT)
+    colfile_end_row(col);
+}
+
+#define IL_FIELD_DESC(frame_t, type, name, offset, title, width, format, \
+                      multiplier, decimals, scale) \
+    {#name, title, COL_##type, offsetof(struct frame_t, name), width, \
+     IL_FORMAT_##format, multiplier, decimals, scale},
+#define IL_OPVT2AHR_DESC(...) IL_FIELD_DESC(opvt2ahr_t, __VA_ARGS__)
+#define IL_OPVT_DESC(...) IL_FIELD_DESC(opvt_t, __VA_ARGS__)
+
+// terminated by a field with no name
+const struct il_field_desc opvt2ahr_fields[] =
+{
+    IL_OPVT2AHR_FIELDS(IL_OPVT2AHR_DESC)
+    {0, 0, COL_U8, 0, 0, IL_FORMAT_UINT, 0, 0, 0}
+};
+
+const struct il_field_desc opvt_fields[] =
+{
+    IL_OPVT_FIELDS(IL_OPVT_DESC)
+    {0, 0, COL_U8, 0, 0, IL_FORMAT_UINT, 0, 0, 0}
+};
+
+// nonzero if the len characters at s are name, regardless of case
+static int il_name_is(const char *s, unsigned long len, const char *name)
+{
+    if (strlen(name) != len) return 0;
+    for (unsigned long i = 0; i < len; ++i)
+    {
+        if (tolower((unsigned char) s[i]) != tolower((unsigned char) name[i]))
+            return 0;
+    }
+    return 1;
+}
+
+// longest text fmt_fixed or fmt_uint writes for any value, however
+// narrow its column: a sign, a leading zero, a point and 19 digits
+#define IL_VALUE_MAX 22
+
+static int il_projection(struct il_projection *proj,
+    const struct il_field_desc *table, const char *list, const char **bad)
+{
+    proj->n = 0;
+    proj->row_max = 1; // the newline
+    const char *name = list;
+    while (1)
+    {
+        unsigned long len = strcspn(name, ",");
+        const struct il_field_desc *f = table;
+        while (f->name && !il_name_is(name, len, f->name) &&
+               !il_name_is(name, len, f->title))
+            ++f;
+        if (!f->name || proj->n == IL_MAX_FIELDS)
+        {
+            *bad = name;
+            return f->name ? 2 : 1;
+        }
+        proj->fields[proj->n] = f;
+        proj->cols[proj->n].name = f->title;
+        proj->cols[proj->n].type = f->type;
+        proj->cols[proj->n].scale = f->scale;
+        proj->row_max += f->width > IL_VALUE_MAX ? f->width : IL_VALUE_MAX;
+        ++proj->n;
+
+        if (!name[len]) return 0;
+        name += len + 1;
+    }
+}
+
+int opvt2ahr_projection(struct il_projection *proj, const char *list,
+                        const char **bad)
+{
+    return il_projection(proj, opvt2ahr_fields, list, bad);
+}
+
+int opvt_projection(struct il_projection *proj, const char *list,
+                    const char **bad)
+{
+    return il_projection(proj, opvt_fields, list, bad);
+}
+
+// the value of the field f of frame, widened from whatever its member
+// is
+static long long il_field_value(const struct il_field_desc *f,
+                                const void *frame)
+{
+    const void *p = (const char*) frame + f->member;
+    switch (f->type)
+    {
+    case COL_U8: return *(const unsigned char*) p;
+    case COL_I8: return *(const signed char*) p;
+    case COL_U16: return *(const unsigned short*) p;
+    case COL_I16: return *(const signed short*) p;
+    case COL_U32: return *(const unsigned long*) p;
+    case COL_I32: return *(const signed long*) p;
+    case COL_I64: return *(const signed long long*) p;
+    default: return 0;
+    }
+}
+
+void println_projected(struct outbuf *out, const struct il_projection *proj,
+                       const void *frame)
+{
+    if (!out) return;
+    if (!frame)
+    {
+        for (unsigned i = 0; i < proj->n; ++i)
+        {
+            outbuf_printf(out, "%*s",
+                proj->fields[i]->width, proj->fields[i]->title);
+        }
+        outbuf_printf(out, "\n");
+        return;
+    }
+
+    // fields may be repeated, so this can be wider than the full row
+    char *row = outbuf_reserve(out, proj->row_max);
+    if (!row) return;
+    char *p = row;
+    for (unsigned i = 0; i < proj->n; ++i)
+    {
+        const struct il_field_desc *f = proj->fields[i];
+        long long value = il_field_value(f, frame);
+        switch (f->format)
+        {
+        case IL_FORMAT_FIXED:
+            p = IL_FMT_FIXED(p, f->width, value, f->multiplier, f->decimals);
+            break;
+        case IL_FORMAT_UINT:
+            p = IL_FMT_UINT(p, f->width, value, f->multiplier, f->decimals);
+            break;
+        case IL_FORMAT_LOWBYTE:
+            p = IL_FMT_LOWBYTE(p, f->width, value, f->multiplier,
+                f->decimals);
+            break;
+        }
+    }
+    *p++ = '\n';
+    outbuf_commit(out, p - row);
+}
+
+void colrow_projected(struct colfile *col, const struct il_projection *proj,
+                      const void *frame)
+{
+    for (unsigned i = 0; i < proj->n; ++i)
+        colfile_put_int(col, il_field_value(proj->fields[i], frame));
+    colfile_end_row(col);
+}
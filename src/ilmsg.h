@@ -0,0 +1,311 @@
+#ifndef ILMSG_H
+#define ILMSG_H
+
+#include "outbuf.h"
+#include "colfile.h"
+
+// Inertial Labs INS messages: the alignment blocks and the OPVT and
+// OPVT2AHR data frames, their decoders, and their text and columnar
+// rows. shared by ilconv, opvt and qtconv.
+//
+// every message starts with the sync bytes 0xAA 0x55 and the message
+// class 0x01, followed by the message type and a 16-bit length that
+// counts everything after the sync bytes, checksum included. the
+// checksum is the 16-bit sum of every byte between the sync bytes and
+// the checksum itself.
+
+// total lengths of the messages, sync bytes included
+#define IL_ACK_LEN 10
+#define IL_ALIGN_LEN 58
+#define IL_EXT_ALIGN_LEN 136
+#define IL_OPVT_LEN 100
+#define IL_OPVT2AHR_LEN 137
+
+// message types of the data frames, and the one the alignment blocks
+// arrive with
+#define IL_OPVT_TYPE 0x52
+#define IL_OPVT2AHR_TYPE 0x58
+#define IL_ALIGN_TYPE 0xC8
+
+// length of the header every message starts with: the sync bytes, the
+// message class and type, and the length. field offsets below count
+// from the end of it.
+#define IL_HEADER_LEN 6
+
+// the layout of each message is given once, as a table of its fields,
+// and its struct, decoder, text row and columns are all generated from
+// that table; a new message type is a new table. a field of a data
+// frame is
+//
+//     X(type, name, offset, title, width, format, multiplier, decimals,
+//       scale)
+//
+// type: how it's stored, little-endian: U8, I8, U16, I16, U32, I32,
+//   I64, F32 or F64
+// offset: where it starts, counting from the end of the header
+// title, width: its text column, right-aligned in width characters
+// format: FIXED prints value*multiplier with that many decimals, UINT
+//   prints value*multiplier, and LOWBYTE prints the low byte of value as
+//   a signed integer, as the %hhd the latencies were once printed with
+//   did
+// scale: turns the stored value into the units of the text column;
+//   columnar output stores the value itself, with this scale
+//
+// fields are listed in the order of the text columns, which isn't
+// always the order they arrive in
+
+// C types the fields are decoded to
+#define IL_CTYPE_U8 unsigned char
+#define IL_CTYPE_I8 signed char
+#define IL_CTYPE_U16 unsigned short
+#define IL_CTYPE_I16 signed short
+#define IL_CTYPE_U32 unsigned long
+#define IL_CTYPE_I32 signed long
+#define IL_CTYPE_I64 signed long long
+#define IL_CTYPE_F32 float
+#define IL_CTYPE_F64 double
+
+// INS OPVT2AHR data frame
+#define IL_OPVT2AHR_FIELDS(X) \
+    X(U16, heading,          0, "Heading",         15, FIXED,     1, 2, 1E-2) \
+    X(I16, pitch,            2, "Pitch",           15, FIXED,     1, 2, 1E-2) \
+    X(I16, roll,             4, "Roll",            15, FIXED,     1, 2, 1E-2) \
+    X(I32, gyro_x,           6, "Gyro_X",          15, FIXED,     1, 5, 1E-5) \
+    X(I32, gyro_y,          10, "Gyro_Y",          15, FIXED,     1, 5, 1E-5) \
+    X(I32, gyro_z,          14, "Gyro_Z",          15, FIXED,     1, 5, 1E-5) \
+    X(I32, acc_x,           18, "Acc_X",           15, FIXED,     1, 6, 1E-6) \
+    X(I32, acc_y,           22, "Acc_Y",           15, FIXED,     1, 6, 1E-6) \
+    X(I32, acc_z,           26, "Acc_Z",           15, FIXED,     1, 6, 1E-6) \
+    X(I16, mag_x,           30, "Magn_X",          15, FIXED,   100, 1, 10) \
+    X(I16, mag_y,           32, "Magn_Y",          15, FIXED,   100, 1, 10) \
+    X(I16, mag_z,           34, "Magn_Z",          15, FIXED,   100, 1, 10) \
+    X(I16, temp,            40, "Temperature",     15, FIXED,     1, 1, 1E-1) \
+    X(U16, vinp,            38, "Vdd",             15, FIXED,     1, 2, 1E-2) \
+    X(U16, USW,             36, "USW",             15, UINT,      1, 0, 1) \
+    X(I64, latitude,        42, "Latitude",        15, FIXED,     1, 9, 1E-9) \
+    X(I64, longitude,       50, "Longitude",       15, FIXED,     1, 9, 1E-9) \
+    X(I32, altitude,        58, "Altitude",        15, FIXED, 10000, 7, 1E-3) \
+    X(I32, v_east,          62, "V_East",          15, FIXED,     1, 2, 1E-2) \
+    X(I32, v_north,         66, "V_North",         15, FIXED,     1, 2, 1E-2) \
+    X(I32, v_up,            70, "V_Up",            15, FIXED,     1, 2, 1E-2) \
+    X(I64, lat_GNSS,        74, "Lat_GNSS",        15, FIXED,     1, 9, 1E-9) \
+    X(I64, lon_GNSS,        82, "Long_GNSS",       15, FIXED,     1, 9, 1E-9) \
+    X(I32, alt_GNSS,        90, "Height_GNSS",     15, FIXED, 10000, 7, 1E-3) \
+    X(I32, vh_GNSS,         94, "Hor_spd",         15, FIXED,     1, 2, 1E-2) \
+    X(I16, track_grnd,      98, "Trk_gnd",         15, FIXED,     1, 2, 1E-2) \
+    X(I32, vup_GNSS,       100, "Ver_spd",         15, FIXED,     1, 2, 1E-2) \
+    X(U32, ms_gps,         104, "ms_gps",          15, UINT,      1, 0, 1) \
+    X(U8,  GNSS_info1,     108, "GNSS_info_1",     15, UINT,      1, 0, 1) \
+    X(U8,  GNSS_info2,     109, "GNSS_info_2",     15, UINT,      1, 0, 1) \
+    X(U8,  solnSVs,        110, "#solnSVs",        15, UINT,      1, 0, 1) \
+    X(U16, v_latency,      111, "latency",         15, UINT,      1, 0, 1) \
+    X(U8,  angle_pos_type, 113, "anglesPosType",   15, UINT,      1, 0, 1) \
+    X(U16, hdg_GNSS,       114, "Heading_GNSS",    15, FIXED,     1, 2, 1E-2) \
+    X(I16, latency_ms_hdg, 116, "Latency_ms_head", 19, LOWBYTE,   1, 0, 1) \
+    X(I16, latency_ms_pos, 118, "Latency_ms_pos",  19, LOWBYTE,   1, 0, 1) \
+    X(I16, latency_ms_vel, 120, "Latency_ms_vel",  19, LOWBYTE,   1, 0, 1) \
+    X(U16, p_bar,          122, "P_Bar",           15, UINT,      2, 0, 2) \
+    X(I32, h_bar,          124, "H_Bar",           15, FIXED,     1, 2, 1E-2) \
+    X(U8,  new_gps,        128, "New_GPS",         15, UINT,      1, 0, 1)
+
+// INS OPVT data frame, the older and narrower sibling of OPVT2AHR
+#define IL_OPVT_FIELDS(X) \
+    X(U16, heading,          0, "Heading",         15, FIXED,     1, 2, 1E-2) \
+    X(I16, pitch,            2, "Pitch",           15, FIXED,     1, 2, 1E-2) \
+    X(I16, roll,             4, "Roll",            15, FIXED,     1, 2, 1E-2) \
+    X(I16, gyro_x,           6, "Gyro_X",          15, FIXED,     1, 5, 1E-5) \
+    X(I16, gyro_y,           8, "Gyro_Y",          15, FIXED,     1, 5, 1E-5) \
+    X(I16, gyro_z,          10, "Gyro_Z",          15, FIXED,     1, 5, 1E-5) \
+    X(I16, acc_x,           12, "Acc_X",           15, FIXED,     1, 6, 1E-6) \
+    X(I16, acc_y,           14, "Acc_Y",           15, FIXED,     1, 6, 1E-6) \
+    X(I16, acc_z,           16, "Acc_Z",           15, FIXED,     1, 6, 1E-6) \
+    X(I16, mag_x,           18, "Magn_X",          15, FIXED,   100, 1, 10) \
+    X(I16, mag_y,           20, "Magn_Y",          15, FIXED,   100, 1, 10) \
+    X(I16, mag_z,           22, "Magn_Z",          15, FIXED,   100, 1, 10) \
+    X(I16, temp,            28, "Temperature",     15, FIXED,     1, 1, 1E-1) \
+    X(U16, vinp,            26, "Vdd",             15, FIXED,     1, 2, 1E-2) \
+    X(U16, USW,             24, "USW",             15, UINT,      1, 0, 1) \
+    X(I32, latitude,        30, "Latitude",        15, FIXED,     1, 9, 1E-9) \
+    X(I32, longitude,       34, "Longitude",       15, FIXED,     1, 9, 1E-9) \
+    X(I32, altitude,        38, "Altitude",        15, FIXED, 10000, 7, 1E-3) \
+    X(I32, v_east,          42, "V_East",          15, FIXED,     1, 2, 1E-2) \
+    X(I32, v_north,         46, "V_North",         15, FIXED,     1, 2, 1E-2) \
+    X(I32, v_up,            50, "V_Up",            15, FIXED,     1, 2, 1E-2) \
+    X(I32, lat_GNSS,        54, "Lat_GNSS",        15, FIXED,     1, 9, 1E-9) \
+    X(I32, lon_GNSS,        58, "Long_GNSS",       15, FIXED,     1, 9, 1E-9) \
+    X(I32, alt_GNSS,        62, "Height_GNSS",     15, FIXED, 10000, 7, 1E-3) \
+    X(I32, vh_GNSS,         66, "Hor_spd",         15, FIXED,     1, 2, 1E-2) \
+    X(I16, track_grnd,      70, "Trk_gnd",         15, FIXED,     1, 2, 1E-2) \
+    X(I32, vup_GNSS,        72, "Ver_spd",         15, FIXED,     1, 2, 1E-2) \
+    X(U32, ms_gps,          76, "ms_gps",          15, UINT,      1, 0, 1) \
+    X(U8,  GNSS_info1,      80, "GNSS_info_1",     15, UINT,      1, 0, 1) \
+    X(U8,  GNSS_info2,      81, "GNSS_info_2",     15, UINT,      1, 0, 1) \
+    X(U8,  solnSVs,         82, "#solnSVs",        15, UINT,      1, 0, 1) \
+    X(I8,  latency_ms_pos,  83, "Latency_ms_pos",  19, FIXED,     1, 0, 1) \
+    X(I8,  latency_ms_vel,  84, "Latency_ms_vel",  19, FIXED,     1, 0, 1) \
+    X(U16, p_bar,           85, "P_Bar",           15, UINT,      2, 0, 2) \
+    X(I32, h_bar,           87, "H_Bar",           15, FIXED,     1, 2, 1E-2) \
+    X(U8,  new_gps,         91, "New_GPS",         15, UINT,      1, 0, 1)
+
+// the alignment blocks aren't rows of a table, so their fields are only
+// F(type, name, offset), or A(type, name, offset, count) for an array
+
+// INS short initial alignment data block, only kept for backwards
+// compatibility
+#define IL_ALIGN_FIELDS(F, A) \
+    A(F32, gyro_bias,   0, 3) \
+    A(F32, avg_accel,  12, 3) \
+    A(F32, avg_mag,    24, 3) \
+    F(F32, init_hdg,   36) \
+    F(F32, init_roll,  40) \
+    F(F32, init_pitch, 44) \
+    F(U16, USW,        48)
+
+// INS extended initial alignment data block
+#define IL_EXT_ALIGN_FIELDS(F, A) \
+    IL_ALIGN_FIELDS(F, A) \
+    F(I32, UT_sr,      50) \
+    F(I32, UP_sr,      54) \
+    A(I16, t_gyro,     58, 3) \
+    A(I16, t_acc,      64, 3) \
+    A(I16, t_mag,      70, 3) \
+    F(F64, latitude,   76) \
+    F(F64, longitude,  84) \
+    F(F64, altitude,   92) \
+    F(F32, v_east,    100) \
+    F(F32, v_north,   104) \
+    F(F32, v_up,      108) \
+    F(F64, g_true,    112) \
+    F(F32, reserved1, 120) \
+    F(F32, reserved2, 124)
+
+#define IL_FIELD_MEMBER(type, name, offset, title, width, format, \
+                        multiplier, decimals, scale) IL_CTYPE_##type name;
+#define IL_SCALAR_MEMBER(type, name, offset) IL_CTYPE_##type name;
+#define IL_ARRAY_MEMBER(type, name, offset, count) \
+    IL_CTYPE_##type name[count];
+
+struct short_align_block
+{
+    IL_ALIGN_FIELDS(IL_SCALAR_MEMBER, IL_ARRAY_MEMBER)
+};
+
+struct ext_align_block
+{
+    IL_EXT_ALIGN_FIELDS(IL_SCALAR_MEMBER, IL_ARRAY_MEMBER)
+};
+
+struct opvt2ahr_t
+{
+    IL_OPVT2AHR_FIELDS(IL_FIELD_MEMBER)
+};
+
+struct opvt_t
+{
+    IL_OPVT_FIELDS(IL_FIELD_MEMBER)
+};
+
+// each decoder takes a pointer to the first sync byte of a whole
+// message, fills in frame and returns 0, or returns nonzero if the
+// message isn't of its kind or fails its checksum, in which case frame
+// is invalid
+int payload2header(struct short_align_block *frame, unsigned char *payload);
+int payload2extheader(struct ext_align_block *frame,
+                      unsigned char *payload);
+int payload2opvt2ahr(struct opvt2ahr_t *frame, unsigned char *payload);
+int payload2opvt(struct opvt_t *frame, unsigned char *payload);
+
+// nonzero if the checksum in the last 2 bytes of a len byte message
+// matches the bytes between the sync bytes and it
+int il_checksum_ok(const unsigned char *payload, unsigned long len);
+
+// the reverse of the decoders: each writes frame as a whole message,
+// header and checksum included, to the IL_*_LEN bytes at payload
+void header2payload(const struct short_align_block *frame,
+                    unsigned char *payload);
+void extheader2payload(const struct ext_align_block *frame,
+                       unsigned char *payload);
+void opvt2ahr2payload(const struct opvt2ahr_t *frame, unsigned char *payload);
+void opvt2payload(const struct opvt_t *frame, unsigned char *payload);
+
+// print an alignment data block to the provided outbuf
+void print_header(struct outbuf *out, struct short_align_block *frame);
+void print_extheader(struct outbuf *out, struct ext_align_block *frame);
+
+// print one row of a data frame to the provided outbuf, imitating the
+// INS Demo Report of Experiment format, or the column titles if frame
+// is null
+void println_opvt2ahr(struct outbuf *out, struct opvt2ahr_t *frame);
+void println_opvt(struct outbuf *out, struct opvt_t *frame);
+
+// columns written by --format columnar, named after the text columns,
+// and the functions appending one frame as a row of them
+extern const struct col_desc opvt2ahr_cols[];
+extern const unsigned opvt2ahr_ncols;
+extern const struct col_desc opvt_cols[];
+extern const unsigned opvt_ncols;
+
+void colrow_opvt2ahr(struct colfile *col, struct opvt2ahr_t *frame);
+void colrow_opvt(struct colfile *col, struct opvt_t *frame);
+
+// the field tables again, as data, for --fields: the converters' way
+// of writing only some of a data frame's columns, in an order of the
+// user's choosing
+
+enum il_format { IL_FORMAT_FIXED, IL_FORMAT_UINT, IL_FORMAT_LOWBYTE };
+
+struct il_field_desc
+{
+    // struct member and text column title, either of which names the
+    // field in a --fields list
+    const char *name, *title;
+    enum col_type type;
+    // where the member is in the frame struct
+    unsigned long member;
+    int width;
+    enum il_format format;
+    long multiplier;
+    int decimals;
+    double scale;
+};
+
+extern const struct il_field_desc opvt2ahr_fields[];
+extern const struct il_field_desc opvt_fields[];
+
+// data frames have fewer fields than this
+#define IL_MAX_FIELDS 64
+
+// the columns --fields chose, and the columns of a columnar file of
+// just those
+struct il_projection
+{
+    unsigned n;
+
+    // upper bound on the length of one text row of the fields
+    unsigned long row_max;
+    const struct il_field_desc *fields[IL_MAX_FIELDS];
+    struct col_desc cols[IL_MAX_FIELDS];
+};
+
+// fills proj with the fields of an OPVT2AHR or OPVT frame named in
+// list, separated by commas; names are matched regardless of case.
+// returns 0 on success, 1 if list names no fields or a name isn't one
+// of the frame's, or 2 if it names more than IL_MAX_FIELDS; *bad then
+// points at the name in list that couldn't be added
+int opvt2ahr_projection(struct il_projection *proj, const char *list,
+                        const char **bad);
+int opvt_projection(struct il_projection *proj, const char *list,
+                    const char **bad);
+
+// prints the projected columns of one row of a data frame of the kind
+// proj was made for, or their titles if frame is null. only those
+// columns are formatted; the text of each is the same as in the full
+// row's.
+void println_projected(struct outbuf *out, const struct il_projection *proj,
+                       const void *frame);
+
+// appends the projected columns of a frame as a row of proj->cols
+void colrow_projected(struct colfile *col, const struct il_projection *proj,
+                      const void *frame);
+
+#endif // ILMSG_H
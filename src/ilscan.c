@@ -0,0 +1,42 @@
+#include "ilscan.h"
+#include "syncscan.h"
+#include "ilmsg.h"
+
+void ilscan_log(unsigned char *buf, unsigned long long len,
+    unsigned char frame_type, unsigned frame_len, ilscan_decode decode,
+    struct scan_stats *stats, struct timeidx *index)
+{
+    unsigned long long rptr = 0;
+    while (rptr + 6 <= len)
+    {
+        rptr += sync_scan(buf + rptr, len - rptr, il_sync, 3);
+        if (rptr + 6 > len) break;
+
+        unsigned short msg_len = buf[rptr+4] | (buf[rptr+5] << 8);
+        if (rptr + msg_len + 2 > len)
+        {
+            ++rptr;
+            continue;
+        }
+        if (msg_len == frame_len - 2 && buf[rptr+3] == frame_type)
+        {
+            unsigned long ms;
+            if (!decode(buf + rptr, &ms))
+            {
+                scan_frame(stats, ms, frame_len);
+                if (index) timeidx_add(index, ms, rptr);
+                rptr += frame_len;
+                continue;
+            }
+            ++stats->bad_checksums;
+        }
+        else if ((msg_len == 0x08 || msg_len == 0x38 || msg_len == 0x86) &&
+                 il_checksum_ok(buf + rptr, msg_len + 2))
+        {
+            scan_other(stats, msg_len + 2);
+            rptr += msg_len + 2;
+            continue;
+        }
+        ++rptr;
+    }
+}
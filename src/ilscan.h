@@ -0,0 +1,26 @@
+#ifndef ILSCAN_H
+#define ILSCAN_H
+
+#include "scanstat.h"
+#include "timeidx.h"
+
+// --scan and --index for the Inertial Labs converters, ilconv and
+// opvt: every message of a log is found the way the stream converters
+// find them, but none of them is formatted. the converter only says
+// which messages are its timed frames and how to decode one.
+
+// decodes the timed frame at msg, checksum and all, and sets *ms to
+// its GPS milliseconds into the week; returns nonzero if it doesn't
+// decode
+typedef int (*ilscan_decode)(unsigned char *msg, unsigned long *ms);
+
+// counts every message in the len byte log buf into stats, and adds
+// every timed frame to index if it isn't null. the timed frames are
+// the frame_len byte messages of type frame_type; one whose sync bytes
+// and length check out but whose checksum doesn't is a checksum
+// failure. anything that isn't a whole message is skipped.
+void ilscan_log(unsigned char *buf, unsigned long long len,
+    unsigned char frame_type, unsigned frame_len, ilscan_decode decode,
+    struct scan_stats *stats, struct timeidx *index);
+
+#endif // ILSCAN_H
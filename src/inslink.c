@@ -0,0 +1,138 @@
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "inslink.h"
+
+long long inslink_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1000LL + ts.tv_nsec/1000000;
+}
+
+void inslink_reset(struct inslink_reader *r)
+{
+    r->state = INSLINK_SYNC;
+    r->have = r->pos = r->len = 0;
+}
+
+long inslink_fill(struct inslink_reader *r, int fd)
+{
+    // what's been dealt with is dropped to make room; a message being
+    // assembled is never longer than half the buffer
+    memmove(r->buf, r->buf + r->pos, r->have - r->pos);
+    r->have -= r->pos;
+    r->pos = 0;
+
+    ssize_t n = read(fd, r->buf + r->have, sizeof(r->buf) - r->have);
+    if (n < 0) return errno == EAGAIN || errno == EINTR ? 0 : -1;
+    r->have += n;
+    return n;
+}
+
+// gives up on the message starting at pos, which turned out not to be
+// one, and looks for the next from the byte after its first
+static void inslink_resync(struct inslink_reader *r)
+{
+    ++r->pos;
+    r->state = INSLINK_SYNC;
+}
+
+const unsigned char* inslink_next(struct inslink_reader *r,
+                                  unsigned long *len)
+{
+    while (1)
+    {
+        const unsigned char *msg = r->buf + r->pos;
+        unsigned long avail = r->have - r->pos;
+        switch (r->state)
+        {
+        case INSLINK_SYNC:
+            // a lone 0xAA at the end might be the start of one
+            while (avail >= 2 && (msg[0] != 0xAA || msg[1] != 0x55))
+            {
+                ++r->pos;
+                ++msg;
+                --avail;
+            }
+            if (avail < 2)
+            {
+                if (avail == 1 && msg[0] != 0xAA) ++r->pos;
+                return 0;
+            }
+            r->state = INSLINK_HEADER;
+            break;
+
+        case INSLINK_HEADER:
+            if (avail < 6) return 0;
+            // the smallest message has no payload at all
+            r->len = 2 + (msg[4] | (msg[5] << 8));
+            if (r->len < 8 || r->len > INSLINK_FRAME_MAX) inslink_resync(r);
+            else r->state = INSLINK_BODY;
+            break;
+
+        case INSLINK_BODY:
+        {
+            if (avail < r->len) return 0;
+            unsigned short checksum = 0;
+            for (unsigned long i = 2; i < r->len - 2; ++i)
+                checksum += msg[i];
+            if (checksum != (msg[r->len-2] | (msg[r->len-1] << 8)))
+            {
+                inslink_resync(r);
+                break;
+            }
+            *len = r->len;
+            r->pos += r->len;
+            r->state = INSLINK_SYNC;
+            return msg;
+        }
+        }
+    }
+}
+
+void inslink_seal(unsigned char *msg, unsigned long len)
+{
+    unsigned short checksum = 0;
+    for (unsigned long i = 2; i < len - 2; ++i) checksum += msg[i];
+    msg[len-2] = checksum & 0xFF;
+    msg[len-1] = checksum >> 8;
+}
+
+void inslink_clear(struct inslink_writer *w)
+{
+    w->len = w->pos = 0;
+}
+
+int inslink_queue(struct inslink_writer *w, const unsigned char *msg,
+                  unsigned long len)
+{
+    if (w->len + len > sizeof(w->buf))
+    {
+        memmove(w->buf, w->buf + w->pos, w->len - w->pos);
+        w->len -= w->pos;
+        w->pos = 0;
+    }
+    if (w->len + len > sizeof(w->buf)) return 1;
+    memcpy(w->buf + w->len, msg, len);
+    w->len += len;
+    return 0;
+}
+
+long inslink_flush(struct inslink_writer *w, int fd)
+{
+    while (w->pos < w->len)
+    {
+        ssize_t n = write(fd, w->buf + w->pos, w->len - w->pos);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) break;
+        if (n < 0) return -1;
+        w->pos += n;
+    }
+    if (w->pos == w->len) inslink_clear(w);
+    return w->len - w->pos;
+}
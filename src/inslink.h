@@ -0,0 +1,74 @@
+#ifndef INSLINK_H
+#define INSLINK_H
+
+// the serial side of talking to an Inertial Labs INS, for ldprm.
+// commands are queued and written as the port takes them, and replies
+// are reassembled from whatever pieces the port hands over as they
+// arrive, so an exchange is over as soon as its reply is in rather
+// than after a fixed sleep, and nothing blocks on one unit while
+// others are being talked to. a reply is only ever handed over whole
+// and with a good checksum.
+//
+// every message is the sync bytes 0xAA 0x55, a class and type byte, a
+// 16-bit length counting everything after the sync bytes, and a 16-bit
+// checksum of the bytes between the sync bytes and it; see ilmsg.h.
+
+// the longest message a unit sends: the full parameter frame
+#define INSLINK_FRAME_MAX 2056
+
+// what the reader is waiting for: the sync bytes, the rest of the
+// header, or the rest of the message
+enum inslink_state { INSLINK_SYNC, INSLINK_HEADER, INSLINK_BODY };
+
+struct inslink_reader
+{
+    enum inslink_state state;
+
+    // bytes buffered, where the message being assembled starts among
+    // them, and its length once its header is in
+    unsigned long have, pos, len;
+    unsigned char buf[2*INSLINK_FRAME_MAX];
+};
+
+// milliseconds on a clock that never jumps, for deadlines
+long long inslink_now_ms(void);
+
+// empties r, dropping anything half assembled
+void inslink_reset(struct inslink_reader *r);
+
+// reads whatever fd has ready into r; returns the number of bytes
+// read, 0 if there were none, or -1 if the port can't be read
+long inslink_fill(struct inslink_reader *r, int fd);
+
+// the next whole message in r with a good checksum, or null if no more
+// have arrived; sets *len to its length. anything in front of it that
+// isn't a message is dropped. the message stays valid until the next
+// inslink_fill.
+const unsigned char* inslink_next(struct inslink_reader *r,
+                                  unsigned long *len);
+
+// fills in the checksum closing the len byte message at msg
+void inslink_seal(unsigned char *msg, unsigned long len);
+
+// messages waiting to go out on a non-blocking port, so that nothing
+// has to wait for a slow unit to take them
+struct inslink_writer
+{
+    // bytes queued, and how many of them have been written
+    unsigned long len, pos;
+    unsigned char buf[2*INSLINK_FRAME_MAX];
+};
+
+// empties w, dropping anything not yet written
+void inslink_clear(struct inslink_writer *w);
+
+// adds the len byte message msg to the end of w; returns 0 on
+// success, or 1 if there's no room for it
+int inslink_queue(struct inslink_writer *w, const unsigned char *msg,
+                  unsigned long len);
+
+// writes as much of w to fd as fd takes without blocking; returns the
+// number of bytes still queued, or -1 if the port can't be written
+long inslink_flush(struct inslink_writer *w, int fd);
+
+#endif // INSLINK_H
@@ -1,13 +1,18 @@
 #define _DEFAULT_SOURCE
 
+#include <errno.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
 #include <string.h>
 #include <fcntl.h>
+#include <sys/epoll.h>
 #include <termios.h>
 #include <unistd.h>
 
+#include "inslink.h"
+
 // LoadINSPar data structure as specified in INS ICD
 // revision 2.9, section 6.3.4
 struct short_prm_t
@@ -134,63 +139,63 @@ void struct2payload(const struct short_prm_t *prm, unsigned char payload[60])
     payload[58] = prm->baro_altimeter;
 }
 
-// prints payload to stdout with helpful labels
-void print_payload(const unsigned char payload[60])
+// prints payload to out with helpful labels
+void print_payload(FILE *out, const unsigned char payload[60])
 {
-    printf("device name:");
+    fprintf(out, "device name:");
     for (int i = 50; i < 58; ++i)
     {
-        printf(" %02x", payload[i]);
+        fprintf(out, " %02x", payload[i]);
     }
-    printf("\ndata rate: %02x %02x\n", payload[0], payload[1]);
-    printf("initial alignment time: %02x %02x\n",
+    fprintf(out, "\ndata rate: %02x %02x\n", payload[0], payload[1]);
+    fprintf(out, "initial alignment time: %02x %02x\n",
             payload[2], payload[3]);
-    printf("magnetic declination: %02x %02x %02x %02x\n",
+    fprintf(out, "magnetic declination: %02x %02x %02x %02x\n",
             payload[4], payload[5], payload[6], payload[7]);
-    printf("position: %02x %02x %02x %02x, %02x %02x "
-                     "%02x %02x, %02x %02x %02x %02x\n",
+    fprintf(out, "position: %02x %02x %02x %02x, %02x %02x "
+                          "%02x %02x, %02x %02x %02x %02x\n",
             payload[8], payload[9], payload[10], payload[11],
             payload[12], payload[13], payload[14], payload[15],
             payload[16], payload[17], payload[18], payload[19]);
-    printf("date: %02x/%02x/%02x\n", payload[20], payload[21], payload[22]);
-    printf("alignment angles: <%02x %02x, %02x %02x, %02x %02x>\n",
+    fprintf(out, "date: %02x/%02x/%02x\n", payload[20], payload[21], payload[22]);
+    fprintf(out, "alignment angles: <%02x %02x, %02x %02x, %02x %02x>\n",
         payload[23], payload[24], payload[25],
         payload[26], payload[27], payload[28]);
-    printf("mounting lever: <%02x %02x, %02x %02x, %02x %02x>\n",
+    fprintf(out, "mounting lever: <%02x %02x, %02x %02x, %02x %02x>\n",
         payload[29], payload[30], payload[31],
         payload[32], payload[33], payload[34]);
-    printf("lever arm: <%02x %02x, %02x %02x, %02x %02x>\n",
+    fprintf(out, "lever arm: <%02x %02x, %02x %02x, %02x %02x>\n",
         payload[35], payload[36], payload[37],
         payload[38], payload[39], payload[40]);
-    printf("altitude output: %02x\n", payload[41]);
-    printf("baro enabled: %02x\n", payload[58]);
+    fprintf(out, "altitude output: %02x\n", payload[41]);
+    fprintf(out, "baro enabled: %02x\n", payload[58]);
 }
 
-// prints short_prm_t struct to stdout
+// prints short_prm_t struct to out
 // note: values are printed in SI units, as opposed to the way they're
 // stored in the data structure; for example, magnetic declination
 // is expressed in degrees, rather than hundredths of degrees
-void print_struct(struct short_prm_t prm)
+void print_struct(FILE *out, struct short_prm_t prm)
 {
-    printf("device name: %s\n", prm.device_name);
-    printf("data rate: %hu Hz\n", prm.data_rate);
-    printf("initial alignment time: %hu seconds\n", prm.align_time);
-    printf("magnetic declination: %0.2f degrees\n", prm.mag_dec/100.0);
-    printf("position: %0.5f, %0.5f, %0.2f\n",
+    fprintf(out, "device name: %s\n", prm.device_name);
+    fprintf(out, "data rate: %hu Hz\n", prm.data_rate);
+    fprintf(out, "initial alignment time: %hu seconds\n", prm.align_time);
+    fprintf(out, "magnetic declination: %0.2f degrees\n", prm.mag_dec/100.0);
+    fprintf(out, "position: %0.5f, %0.5f, %0.2f\n",
             prm.latitude/10000000.0,
             prm.longitude/10000000.0,
             prm.altitude/100.0);
-    printf("date: %hu/%02hhu/%02hhu\n", 2000 + prm.year, prm.month, prm.day);
-    printf("alignment angles: <%0.2f, %0.2f, %0.2f> degrees\n",
+    fprintf(out, "date: %hu/%02hhu/%02hhu\n", 2000 + prm.year, prm.month, prm.day);
+    fprintf(out, "alignment angles: <%0.2f, %0.2f, %0.2f> degrees\n",
         prm.align_angles[0]/100.0,
         prm.align_angles[1]/100.0,
         prm.align_angles[2]/100.0);
-    printf("mounting lever: <%0.2f, %0.2f, %0.2f> meters\n",
+    fprintf(out, "mounting lever: <%0.2f, %0.2f, %0.2f> meters\n",
         prm.mount[0]/100.0, prm.mount[1]/100.0, prm.mount[2]/100.0);
-    printf("lever arm: <%0.2f, %0.2f, %0.2f> meters\n",
+    fprintf(out, "lever arm: <%0.2f, %0.2f, %0.2f> meters\n",
         prm.lever[0]/100.0, prm.lever[1]/100.0, prm.lever[2]/100.0);
-    printf("altitude output: %hhu\n", prm.altitude_byte);
-    printf("baro enabled: %hhu\n", prm.baro_altimeter);
+    fprintf(out, "altitude output: %hhu\n", prm.altitude_byte);
+    fprintf(out, "baro enabled: %hhu\n", prm.baro_altimeter);
 }
 
 // converts user input, unsigned long, to the type
@@ -221,6 +226,34 @@ speed_t int2speed_t(unsigned long baudrate)
     }
 }
 
+// the opposite of int2speed_t; returns 0 for an unknown speed
+unsigned long speed2int(speed_t speed)
+{
+    switch (speed)
+    {
+        case B4800: return 4800;
+        case B9600: return 9600;
+        case B19200: return 19200;
+        case B38400: return 38400;
+        case B57600: return 57600;
+        case B115200: return 115200;
+        case B230400: return 230400;
+        case B460800: return 460800;
+        case B500000: return 500000;
+        case B576000: return 576000;
+        case B921600: return 921600;
+        case B1000000: return 1000000;
+        case B1152000: return 1152000;
+        case B1500000: return 1500000;
+        case B2000000: return 2000000;
+        case B2500000: return 2500000;
+        case B3000000: return 3000000;
+        case B3500000: return 3500000;
+        case B4000000: return 4000000;
+    }
+    return 0;
+}
+
 char* speed2str(speed_t speed)
 {
     switch (speed)
@@ -266,13 +299,48 @@ unsigned char speed2id(speed_t speed)
     return 0;
 }
 
+// how long each reply may take to arrive, in milliseconds, once the
+// command asking for it has been transmitted. the waits for an
+// acknowledgement are the fixed sleeps ldprm used to make after each
+// command; a unit that acknowledges cuts them short.
+#define READ_INS_PAR_TIMEOUT 1000
+#define READ_FULL_PRM_TIMEOUT 2000
+#define WRITE_FULL_PRM_ACK_TIMEOUT 100
+#define FULL_PRM_ACK_TIMEOUT 2000
+#define CHANGE_BPS_ACK_TIMEOUT 600
+#define LOAD_INS_PAR_ACK_TIMEOUT 200
+#define LOAD_PAYLOAD_ACK_TIMEOUT 200
+
+// length of the acknowledgement a unit sends for a message. its type
+// is the code of the command it acknowledges, and its payload echoes
+// that message's checksum.
+#define ACK_LENGTH 10
+
+// length of a command, which has no payload
+#define COMMAND_LENGTH 9
+
+// commands to the INS, none of which has a payload
+const unsigned char STOP_command[] =
+    {0xAA, 0x55, 0, 0, 7, 0, 0xFE, 0x05, 0x01};
+const unsigned char GetBIT_command[] =
+    {0xAA, 0x55, 0, 0, 7, 0, 0x1A, 0x21, 0x00};
+const unsigned char ReadINSPar_command[] =
+    {0xAA, 0x55, 0, 0, 7, 0, 0x41, 0x48, 0};
+const unsigned char LoadINSPar_command[] =
+    {0xAA, 0x55, 0, 0, 7, 0, 0x40, 0x47, 0};
+const unsigned char read_full_prm[] = {0xAA, 0x55, 0, 0, 7, 0, 0x0B, 0x12, 0};
+const unsigned char write_full_prm[] =  {0xAA, 0x55, 0, 0, 7, 0, 0x0E, 0x15, 0};
+const unsigned char change_com1_bps[] = {0xAA, 0x55, 0, 0, 7, 0, 0xC2, 0xC9, 0};
+
 const char* argument_error =
     "%s: invalid option -- '%s'\n"
     "type '%s --usage' for more info\n";
 
 const char* usage_help =
     "usage: %s device [-n -v -h] [-b br] [-r dr] [-i s] [-l lx ly lz] [-a h p r]\n"
-    "  device: INS COM1 serial device path\n"
+    "         [-t ms] [device [options]]...\n"
+    "  device: INS COM1 serial device path; the options after each\n"
+    "    device apply to it, and every device is configured at once\n"
     "  [-n]: print INS serial number\n"
     "  [-v]: verbose output\n"
     "  [-h]: print INS params in hex\n"
@@ -280,7 +348,9 @@ const char* usage_help =
     "  dr: data rate of INS output, in Hz; must be factor of 200 Hz\n"
     "  s: INS initial alignment time in seconds\n"
     "  lx ly lz: offset from imu to antenna, in meters\n"
-    "  h p r: angle offset from vehicle orientation, in degrees\n";
+    "  h p r: angle offset from vehicle orientation, in degrees\n"
+    "  ms: how long to wait for the INS to answer at each bitrate\n"
+    "    while finding its bitrate, in milliseconds; 300 by default\n";
 
 // valid data rates for INS data frame output, in Hz
 const unsigned char valid_rates[] = {1, 2, 4, 5, 8, 10, 20, 25, 40, 50, 100, 200};
@@ -290,6 +360,450 @@ const speed_t valid_bps[] =
     {B460800, B115200, B921600, B230400, B4800,
      B9600, B19200, B38400, B57600};
 
+// the exchanges with a unit, in the order they happen, each named for
+// what it waits for
+enum step
+{
+    PROBE_STOP,     // STOP to be transmitted at the bitrate being tried
+    PROBE_BIT,      // the GetBIT reply
+    READ_FULL_PRM,  // the full parameter frame
+    WRITE_FULL_PRM, // write_full_prm to be acknowledged
+    FULL_PRM,       // the new full parameter frame to be acknowledged
+    CHANGE_BPS,     // change_com1_bps to be acknowledged
+    READ_INS_PAR,   // the ReadINSPar reply
+    LOAD_INS_PAR,   // LoadINSPar to be acknowledged
+    LOAD_PAYLOAD,   // the new parameters to be acknowledged
+    DONE
+};
+
+// an INS named on the command line, the options given after it, and
+// how far ldprm has got with it
+struct device
+{
+    const char *path;
+    int fd, epfd;
+
+    // these flags indicate whether each flag has appeared in argv,
+    // rate_flag for -r, init_flag for -i, etc. The default state is 0.
+    unsigned char baud_flag;
+    unsigned char rate_flag;
+    unsigned char init_flag;
+    unsigned char lever_flag;
+    unsigned char angle_flag;
+    unsigned char print_flag;
+    unsigned char hex_flag;
+    unsigned char name_flag;
+
+    // if user provides arguments, they'll be stored here
+    speed_t baud_input;
+    unsigned char rate_input;
+    unsigned char init_input;
+    double lever_input[3];
+    double angle_input[3];
+    int timeout_input;
+
+    // where its output goes: stdout if it's the only device, otherwise
+    // a buffer printed once every device is done, so that the outputs
+    // of devices configured at once don't interleave
+    FILE *out;
+    char *out_buf;
+    size_t out_size;
+
+    struct inslink_reader link;
+    struct inslink_writer writer;
+    int polling_out;
+
+    // the code of the last command sent, or -1 if the last message was
+    // a data block, and the checksum of that message, as its
+    // acknowledgement echoes them; and the type of that data block
+    int ack_type;
+    unsigned char ack_sum[2];
+    unsigned char block_type;
+
+    // the step it's at, the length of the reply that step waits for (0
+    // for none), when it stops waiting, and the bytes sent for it
+    enum step step;
+    unsigned long want;
+    long long deadline;
+    unsigned long sent;
+
+    // the bitrate being tried or found, and when trying it started
+    int bps_index;
+    speed_t baudrate;
+    long long probe_start;
+
+    unsigned char payload[60];
+    unsigned char full_prm_frame[2056];
+    int failed;
+};
+
+// for messages about a device: the program's name, and whether there's
+// more than one device they could be about
+const char *program_name;
+int several_devices;
+
+// marks d done, and stops epoll watching its port: a port nothing
+// reads any more would otherwise be reported ready again and again
+void finish(struct device *d)
+{
+    d->step = DONE;
+    epoll_ctl(d->epfd, EPOLL_CTL_DEL, d->fd, 0);
+}
+
+// prints an error about d to stderr, naming d if there are several
+// devices, and gives up on it
+void device_error(struct device *d, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "%s: ", program_name);
+    if (several_devices) fprintf(stderr, "%s: ", d->path);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    d->failed = 1;
+    finish(d);
+}
+
+// milliseconds it takes to transmit len bytes at speed, with a start
+// and a stop bit to each, rounded up
+long wire_ms(speed_t speed, unsigned long len)
+{
+    unsigned long bps = speed2int(speed);
+    return bps ? (len*10*1000 + bps - 1)/bps : 0;
+}
+
+// switches the port to speed, dropping anything not yet transmitted
+void set_speed(int fd, speed_t speed)
+{
+    struct termios settings;
+    tcgetattr(fd, &settings);
+    cfsetspeed(&settings, speed);
+    tcsetattr(fd, TCSANOW, &settings);
+    tcflush(fd, TCOFLUSH);
+}
+
+// writes whatever of d's queued output its port takes now, and has
+// epoll say when there's room for the rest
+void flush_output(struct device *d)
+{
+    long left = inslink_flush(&d->writer, d->fd);
+    if (left < 0)
+    {
+        device_error(d, "error: failed to write to %s\n", d->path);
+        return;
+    }
+    if ((left > 0) != d->polling_out)
+    {
+        d->polling_out = left > 0;
+        struct epoll_event ev = {EPOLLIN | (left ? EPOLLOUT : 0), {.ptr = d}};
+        epoll_ctl(d->epfd, EPOLL_CTL_MOD, d->fd, &ev);
+    }
+}
+
+// queues the len byte message msg to go out to d's unit
+void send_message(struct device *d, const unsigned char *msg,
+                  unsigned long len)
+{
+    if (d->step == DONE) return;
+    if (inslink_queue(&d->writer, msg, len))
+    {
+        device_error(d, "error: too much output queued for %s\n", d->path);
+        return;
+    }
+    d->sent += len;
+    d->ack_type = len == COMMAND_LENGTH ? msg[6] : -1;
+    d->block_type = msg[3];
+    d->ack_sum[0] = msg[len-2];
+    d->ack_sum[1] = msg[len-1];
+    flush_output(d);
+}
+
+// nonzero if the acknowledgement ack is for the last message sent to
+// d's unit, rather than a late one for something sent before it
+int acknowledges(const struct device *d, const unsigned char *ack)
+{
+    if (ack[6] != d->ack_sum[0] || ack[7] != d->ack_sum[1]) return 0;
+    return d->ack_type < 0 || ack[3] == d->ack_type;
+}
+
+// nonzero if ack acknowledges a data block of the kind last sent to
+// d's unit, but echoes another checksum than it had: the unit got the
+// block damaged
+int ack_mismatch(const struct device *d, const unsigned char *ack)
+{
+    return d->ack_type < 0 && ack[3] == d->block_type &&
+        !acknowledges(d, ack);
+}
+
+// notes under -v when a step waiting for the acknowledgement of what
+// went on without one, because its deadline passed
+void note_no_ack(const struct device *d, const unsigned char *reply,
+                 const char *what)
+{
+    if (!reply && d->print_flag)
+        fprintf(d->out, "No acknowledgement of %s, continuing\n", what);
+}
+
+// moves d on to step, which waits for a want byte reply (or none) until
+// timeout_ms after what's been sent for it has had time to go out
+void expect(struct device *d, enum step step, unsigned long want,
+            int timeout_ms)
+{
+    if (d->step == DONE) return;
+    d->step = step;
+    d->want = want;
+    d->deadline = inslink_now_ms() + wire_ms(d->baudrate, d->sent) + timeout_ms;
+    d->sent = 0;
+}
+
+// tries the next likely bitrate on d, or gives up if there are none left
+void start_probe(struct device *d)
+{
+    const unsigned char num_of_bps = sizeof(valid_bps)/sizeof(valid_bps[0]);
+    if (++d->bps_index == num_of_bps)
+    {
+        device_error(d, "error: could not determine baudrate\n");
+        return;
+    }
+    d->baudrate = valid_bps[d->bps_index];
+    set_speed(d->fd, d->baudrate);
+
+    if (d->print_flag) fprintf(d->out, "Probing %s...\n", speed2str(d->baudrate));
+
+    // whatever was streaming before the STOP is dropped once it's out
+    d->probe_start = inslink_now_ms();
+    tcflush(d->fd, TCIOFLUSH);
+    inslink_clear(&d->writer);
+    d->sent = 0;
+    send_message(d, STOP_command, sizeof(STOP_command));
+    expect(d, PROBE_STOP, 0, 0);
+}
+
+void start_read_ins_par(struct device *d)
+{
+    send_message(d, ReadINSPar_command, sizeof(ReadINSPar_command));
+    expect(d, READ_INS_PAR, 6 + sizeof(d->payload) + 2, READ_INS_PAR_TIMEOUT);
+}
+
+// applies d's options to the parameters its unit sent and prints them
+// as asked, then sends them back if any options changed them
+void update_ins_par(struct device *d)
+{
+    // take the payload and convert to usable primitives
+    struct short_prm_t dat;
+    payload2short_prm(&dat, d->payload);
+
+    // if the user enabled any flags, assign the appropriate data to the struct
+    if (d->rate_flag) dat.data_rate = d->rate_input;
+    if (d->init_flag) dat.align_time = d->init_input;
+    if (d->lever_flag)
+    {
+        dat.lever[0] = d->lever_input[0]*100;
+        dat.lever[1] = d->lever_input[1]*100;
+        dat.lever[2] = d->lever_input[2]*100;
+    }
+    if (d->angle_flag)
+    {
+        dat.align_angles[0] = d->angle_input[0]*100;
+        dat.align_angles[1] = d->angle_input[1]*100;
+        dat.align_angles[2] = d->angle_input[2]*100;
+    }
+    if (d->print_flag) print_struct(d->out, dat);
+    if (d->hex_flag) print_payload(d->out, d->payload);
+    if (d->name_flag) fprintf(d->out, "%s\n", dat.device_name);
+
+    // this flag will be 1 if any write commands were issued in argv; if not,
+    // the program doesn't need to send a LoadINSPar command at all
+    unsigned char write_flag = d->rate_flag | d->init_flag |
+        d->lever_flag | d->angle_flag;
+    if (!write_flag)
+    {
+        finish(d);
+        return;
+    }
+
+    // convert the struct back to a byte payload to prepare to send
+    struct2payload(&dat, d->payload);
+    send_message(d, LoadINSPar_command, sizeof(LoadINSPar_command));
+    expect(d, LOAD_INS_PAR, ACK_LENGTH, LOAD_INS_PAR_ACK_TIMEOUT);
+}
+
+// moves d on from the step it's at, given the reply the step waited for,
+// or null if its deadline passed first
+void advance(struct device *d, const unsigned char *reply)
+{
+    switch (d->step)
+    {
+    case PROBE_STOP:
+        tcflush(d->fd, TCIFLUSH);
+        inslink_reset(&d->link);
+        send_message(d, GetBIT_command, sizeof(GetBIT_command));
+
+        // the unit may still be streaming data frames when it's probed,
+        // so the 12 byte reply can turn up anywhere among them
+        expect(d, PROBE_BIT, 12, d->timeout_input);
+        break;
+
+    case PROBE_BIT:
+        if (!reply)
+        {
+            start_probe(d);
+            break;
+        }
+        if (d->print_flag) fprintf(d->out, "Found %s in %lld ms\n",
+            speed2str(d->baudrate), inslink_now_ms() - d->probe_start);
+
+        // and it's stopped again, in case GetBIT started it up
+        send_message(d, STOP_command, sizeof(STOP_command));
+
+        if (d->baud_flag && d->baudrate != d->baud_input)
+        {
+            if (d->print_flag) fprintf(d->out,
+                "Changing baudrate from %s to %s\n",
+                speed2str(d->baudrate), speed2str(d->baud_input));
+            send_message(d, read_full_prm, sizeof(read_full_prm));
+            expect(d, READ_FULL_PRM, sizeof(d->full_prm_frame),
+                READ_FULL_PRM_TIMEOUT);
+        }
+        else start_read_ins_par(d);
+        break;
+
+    case READ_FULL_PRM:
+        // the reader has already checked its checksum
+        if (!reply)
+        {
+            device_error(d, "error: no full parameter frame received\n");
+            break;
+        }
+        memcpy(d->full_prm_frame, reply, sizeof(d->full_prm_frame));
+        d->full_prm_frame[6 + 946] = speed2id(d->baud_input);
+        d->full_prm_frame[2] = 0;
+        d->full_prm_frame[3] = 0;
+        d->full_prm_frame[4] = 6;
+        d->full_prm_frame[5] = 8;
+        inslink_seal(d->full_prm_frame, sizeof(d->full_prm_frame));
+
+        // each step from here waits for the unit's acknowledgement, if
+        // it sends one
+        send_message(d, write_full_prm, sizeof(write_full_prm));
+        expect(d, WRITE_FULL_PRM, ACK_LENGTH, WRITE_FULL_PRM_ACK_TIMEOUT);
+        break;
+
+    case WRITE_FULL_PRM:
+        note_no_ack(d, reply, "write_full_prm");
+        send_message(d, d->full_prm_frame, sizeof(d->full_prm_frame));
+        expect(d, FULL_PRM, ACK_LENGTH, FULL_PRM_ACK_TIMEOUT);
+        break;
+
+    case FULL_PRM:
+        note_no_ack(d, reply, "the full parameter frame");
+        send_message(d, change_com1_bps, sizeof(change_com1_bps));
+        expect(d, CHANGE_BPS, ACK_LENGTH, CHANGE_BPS_ACK_TIMEOUT);
+        break;
+
+    case CHANGE_BPS:
+        note_no_ack(d, reply, "change_com1_bps");
+        d->baudrate = d->baud_input;
+        set_speed(d->fd, d->baudrate);
+        tcflush(d->fd, TCIFLUSH);
+        inslink_reset(&d->link);
+        start_read_ins_par(d);
+        break;
+
+    case READ_INS_PAR:
+        // the reader verifies the message's checksum, but only the
+        // payload is kept
+        if (!reply)
+        {
+            device_error(d, "error: no valid ReadINSPar message received\n");
+            break;
+        }
+        memcpy(d->payload, reply + 6, sizeof(d->payload));
+        update_ins_par(d);
+        break;
+
+    case LOAD_INS_PAR:
+    {
+        note_no_ack(d, reply, "LoadINSPar");
+        const unsigned char header[] = {0xAA, 0x55, 1, 0, 0x42, 0};
+        unsigned char combined[68];
+        memcpy(combined, header, sizeof(header));
+        memcpy(combined + sizeof(header), d->payload, sizeof(d->payload));
+        inslink_seal(combined, sizeof(combined));
+        send_message(d, combined, sizeof(combined));
+        expect(d, LOAD_PAYLOAD, ACK_LENGTH, LOAD_PAYLOAD_ACK_TIMEOUT);
+        break;
+    }
+
+    case LOAD_PAYLOAD:
+        // a port slow to take them gets longer
+        if (!reply && d->writer.pos < d->writer.len)
+        {
+            d->deadline = inslink_now_ms() + LOAD_PAYLOAD_ACK_TIMEOUT +
+                wire_ms(d->baudrate, d->writer.len - d->writer.pos);
+            break;
+        }
+        if (!reply && d->print_flag)
+            fprintf(d->out, "No acknowledgement of the new parameters\n");
+        finish(d);
+        break;
+
+    case DONE:
+        break;
+    }
+}
+
+// hands every whole message that's arrived from d's unit to the step
+// waiting for it; others, such as streamed data frames, are skipped
+void receive(struct device *d)
+{
+    const unsigned char *msg;
+    unsigned long len;
+    while (d->step != DONE && (msg = inslink_next(&d->link, &len)))
+    {
+        if (!d->want || len != d->want) continue;
+
+        // a late acknowledgement of an earlier message, say the STOP
+        // sent before a command, mustn't move the step on early
+        if (d->want == ACK_LENGTH && ack_mismatch(d, msg))
+        {
+            if (d->print_flag) fprintf(d->out, "Acknowledgement echoes "
+                "checksum %02X %02X, not the %02X %02X sent\n",
+                msg[6], msg[7], d->ack_sum[0], d->ack_sum[1]);
+            continue;
+        }
+        if (d->want == ACK_LENGTH && !acknowledges(d, msg))
+        {
+            if (d->print_flag) fprintf(d->out,
+                "Ignoring an acknowledgement of another message\n");
+            continue;
+        }
+        advance(d, msg);
+    }
+}
+
+// puts the serial port fd into raw mode
+void configure_port(int fd)
+{
+    /////////////////////////////////////////////
+    // altering terminal serial device settings
+    // warning: very hard to read
+    struct termios settings;
+    tcgetattr(fd, &settings);
+    settings.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP |
+        INLCR | IGNCR | ICRNL | IXON );
+    settings.c_oflag &= ~(OPOST | ONLCR);
+    settings.c_lflag &= ~(ISIG | ICANON | IEXTEN | ECHO | ECHOE |
+        ECHOK | ECHOCTL | ECHOKE);
+    settings.c_cflag &= ~(CSIZE | PARENB);
+    settings.c_cflag |= CS8;
+    settings.c_cc[VMIN] = 0;
+    settings.c_cc[VTIME] = 0;
+    tcsetattr(fd, TCSANOW, &settings);
+    tcflush(fd, TCOFLUSH);
+    /////////////////////////////////////////////
+}
+
 int main(int argc, char** argv)
 {
     if (argc < 2) // first argument must be INS COM1 device
@@ -306,47 +820,37 @@ int main(int argc, char** argv)
         return 0;
     }
 
-    // open the LoadINSPar file; if can't open, return error
-    int com1 = open(argv[1], O_RDWR | O_NOCTTY | O_NDELAY);
-    if (com1 == -1)
-    {
-        fprintf(stderr, "%s: failed to open %s\n", argv[0], argv[1]);
-        return 1;
-    }
-
-    // these flags indicate whether each flag has appeared in argv,
-    // rate_flag for -r, init_flag for -i, etc. The default state is 0.
-    unsigned char baud_flag = 0;
-    unsigned char rate_flag = 0;
-    unsigned char init_flag = 0;
-    unsigned char lever_flag = 0;
-    unsigned char angle_flag = 0;
-    unsigned char print_flag = 0;
-    unsigned char hex_flag = 0;
-    unsigned char name_flag = 0;
+    program_name = argv[0];
 
-    // if user provides arguments, they'll be stored here
-    speed_t baud_input;
-    unsigned char rate_input;
-    unsigned char init_input;
-    double lever_input[3];
-    double angle_input[3];
+    // every device named in argv, each with the options that follow it
+    struct device *devices = calloc(argc, sizeof(struct device));
+    int num_of_devices = 0;
+    struct device *d = 0;
 
-    for (int i = 2; i < argc; ++i) // process every element in argv
+    for (int i = 1; i < argc; ++i) // process every element in argv
     {
+        // the first argument, and any other that isn't an option or
+        // an option's argument, names a device
+        if (i == 1 || argv[i][0] != '-')
+        {
+            d = devices + num_of_devices++;
+            d->path = argv[i];
+            d->timeout_input = 300;
+            d->bps_index = -1;
+        }
         // baudrate flag
-        if (!strcmp(argv[i], "-b") | !strcmp(argv[i], "--baud"))
+        else if (!strcmp(argv[i], "-b") | !strcmp(argv[i], "--baud"))
         {
             if (argc < i + 2)
             {
                 fprintf(stderr, usage_help, argv[0]);
                 return 1;
             }
-            baud_input = int2speed_t(atoi(argv[++i]));
-            baud_flag = 1;
+            d->baud_input = int2speed_t(atoi(argv[++i]));
+            d->baud_flag = 1;
 
-            if (baud_input != B115200 && baud_input != B230400 &&
-                baud_input != B460800 && baud_input != B921600)
+            if (d->baud_input != B115200 && d->baud_input != B230400 &&
+                d->baud_input != B460800 && d->baud_input != B921600)
             {
                 fprintf(stderr, "%s: error: invalid or unsupported "
                     "bitrate '%s'\n", argv[0], argv[i]);
@@ -361,7 +865,7 @@ int main(int argc, char** argv)
                 fprintf(stderr, usage_help, argv[0]);
                 return 1;
             }
-            rate_input = atoi(argv[++i]);
+            d->rate_input = atoi(argv[++i]);
 
             // this mess is required because only some data rates are allowed
             // by the INS; if an invalid data rate is provided by the user,
@@ -373,12 +877,12 @@ int main(int argc, char** argv)
                 // check every valid rate; if the provided rate is one of the
                 // valid ones, the program will use it
 
-                if (rate_input == valid_rates[j])
+                if (d->rate_input == valid_rates[j])
                 {
-                    rate_flag = 1;
+                    d->rate_flag = 1;
                 }
             }
-            if (!rate_flag) // if the provided rate is invalid...
+            if (!d->rate_flag) // if the provided rate is invalid...
             {
                 fprintf(stderr, "%s: valid data rates are: ", argv[0]);
 
@@ -400,8 +904,8 @@ int main(int argc, char** argv)
                 fprintf(stderr, usage_help, argv[0]);
                 return 1;
             }
-            init_flag = 1;
-            init_input = atoi(argv[++i]);
+            d->init_flag = 1;
+            d->init_input = atoi(argv[++i]);
         }
         // lever arm flag
         else if (!strcmp(argv[i], "-l") | !strcmp(argv[i], "--lever"))
@@ -414,10 +918,10 @@ int main(int argc, char** argv)
                 return 1;
             }
 
-            lever_flag = 1;
-            lever_input[0] = atof(argv[++i]);
-            lever_input[1] = atof(argv[++i]);
-            lever_input[2] = atof(argv[++i]);
+            d->lever_flag = 1;
+            d->lever_input[0] = atof(argv[++i]);
+            d->lever_input[1] = atof(argv[++i]);
+            d->lever_input[2] = atof(argv[++i]);
 
             // likewise, i is incremented by 3, because -l uses 3 arguments
         }
@@ -430,25 +934,40 @@ int main(int argc, char** argv)
                 fprintf(stderr, usage_help, argv[0]);
                 return 1;
             }
-            angle_flag = 1;
-            angle_input[0] = atof(argv[++i]);
-            angle_input[1] = atof(argv[++i]);
-            angle_input[2] = atof(argv[++i]);
+            d->angle_flag = 1;
+            d->angle_input[0] = atof(argv[++i]);
+            d->angle_input[1] = atof(argv[++i]);
+            d->angle_input[2] = atof(argv[++i]);
+        }
+        // bitrate probe timeout flag
+        else if (!strcmp(argv[i], "-t") | !strcmp(argv[i], "--timeout"))
+        {
+            if (argc < i + 2)
+            {
+                fprintf(stderr, usage_help, argv[0]);
+                return 1;
+            }
+            d->timeout_input = atoi(argv[++i]);
+            if (d->timeout_input <= 0)
+            {
+                fprintf(stderr, argument_error, argv[0], argv[i], argv[0]);
+                return 1;
+            }
         }
         // print to stdout flag
         else if (!strcmp(argv[i], "-v") | !strcmp(argv[i], "--verbose"))
         {
-            print_flag = 1;
+            d->print_flag = 1;
         }
         // print hex to stdout flag
         else if (!strcmp(argv[i], "-h") | !strcmp(argv[i], "--hex"))
         {
-            hex_flag = 1;
+            d->hex_flag = 1;
         }
         // print SN to stdout flag
         else if (!strcmp(argv[i], "-n") | !strcmp(argv[i], "--name"))
         {
-            name_flag = 1;
+            d->name_flag = 1;
         }
         else // if any argument is unexpected, throw argument error
         {
@@ -457,232 +976,107 @@ int main(int argc, char** argv)
         }
     }
 
-    // this flag will be 1 if any write commands were issued in argv; if not,
-    // the program doesn't need to send a LoadINSPar command at all
-    unsigned char write_flag = rate_flag | init_flag | lever_flag | angle_flag;
-
-    { // setting serial device configuration
-        /////////////////////////////////////////////
-        // altering terminal serial device settings
-        // warning: very hard to read
-        struct termios settings;
-        tcgetattr(com1, &settings);
-        settings.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP |
-            INLCR | IGNCR | ICRNL | IXON );
-        settings.c_oflag &= ~(OPOST | ONLCR);
-        settings.c_lflag &= ~(ISIG | ICANON | IEXTEN | ECHO | ECHOE |
-            ECHOK | ECHOCTL | ECHOKE);
-        settings.c_cflag &= ~(CSIZE | PARENB);
-        settings.c_cflag |= CS8;
-        settings.c_cc[VMIN] = 0;
-        settings.c_cc[VTIME] = 0;
-        tcsetattr(com1, TCSANOW, &settings);
-        tcflush(com1, TCOFLUSH);
-        /////////////////////////////////////////////
-    }
-
-    const unsigned char num_of_bps = sizeof(valid_bps)/sizeof(valid_bps[0]);
-    int determined_bps = 0;
-    speed_t baudrate;
+    // at this point the command line arguments are processed and the program
+    // will have exited if any were invalid.
 
-    for (int i = 0; i < num_of_bps && !determined_bps; ++i)
+    // every device is talked to at once: each one's port is watched by
+    // epoll, and each moves through its exchanges as replies arrive or
+    // deadlines pass, so the slowest unit sets how long this takes
+    several_devices = num_of_devices > 1;
+    int epfd = epoll_create1(0);
+    for (int i = 0; i < num_of_devices; ++i)
     {
-        struct termios settings;
-        tcgetattr(com1, &settings);
-        cfsetspeed(&settings, valid_bps[i]);
-        tcsetattr(com1, TCSANOW, &settings);
-        tcflush(com1, TCOFLUSH);
-
-        if (print_flag) printf("Probing %s...\n", speed2str(valid_bps[i]));
-
-        const unsigned char STOP_command[] =
-            {0xAA, 0x55, 0, 0, 7, 0, 0xFE, 0x05, 0x01};
-        const unsigned char GetBIT_command[] =
-            {0xAA, 0x55, 0, 0, 7, 0, 0x1A, 0x21, 0x00};
-        write(com1, STOP_command, sizeof(STOP_command));
-        usleep(1*1000); // sleep for 100 ms
-        unsigned char trash[10000];
-        read(com1, trash, sizeof(trash));
-        write(com1, GetBIT_command, sizeof(GetBIT_command));
-        usleep(1.5*1000*1000); // sleep for 1.5 seconds
-        unsigned char bit_response[12];
-        int x = read(com1, bit_response, 12);
-
-        unsigned short msg_check = bit_response[10] | (bit_response[11] << 8);
-        unsigned short calc_check = 0;
-        for (int j = 2; j < x - 2; ++j) calc_check += bit_response[j];
-
-        if (x == 12 && msg_check == calc_check)
+        d = devices + i;
+
+        // open the COM1 device; if can't open, return error
+        d->fd = open(d->path, O_RDWR | O_NOCTTY | O_NDELAY);
+        if (d->fd == -1)
         {
-            tcgetattr(com1, &settings);
-            cfsetspeed(&settings, valid_bps[i]);
-            tcsetattr(com1, TCSANOW, &settings);
-            tcflush(com1, TCOFLUSH);
-            determined_bps = 1;
-            baudrate = valid_bps[i];
+            fprintf(stderr, "%s: failed to open %s\n", argv[0], d->path);
+            return 1;
         }
-        write(com1, STOP_command, sizeof(STOP_command));
-    }
+        configure_port(d->fd);
 
-    if (!determined_bps)
-    {
-        fprintf(stderr, "%s: error: could not determine baudrate\n", argv[0]);
-        return 1;
+        d->epfd = epfd;
+        struct epoll_event ev = {EPOLLIN, {.ptr = d}};
+        epoll_ctl(epfd, EPOLL_CTL_ADD, d->fd, &ev);
+
+        d->out = stdout;
+        if (several_devices)
+            d->out = open_memstream(&d->out_buf, &d->out_size);
+        inslink_reset(&d->link);
+        inslink_clear(&d->writer);
     }
+    for (int i = 0; i < num_of_devices; ++i) start_probe(devices + i);
 
-    if (baud_flag && baudrate != baud_input) // changing COM1 baudrate
+    int active = num_of_devices;
+    while (active)
     {
-        if (print_flag) printf("Changing baudrate from %s to %s\n",
-            speed2str(baudrate), speed2str(baud_input));
-
-        unsigned char read_full_prm[] = {0xAA, 0x55, 0, 0, 7, 0, 0x0B, 0x12, 0};
-        unsigned char write_full_prm[] =  {0xAA, 0x55, 0, 0, 7, 0, 0x0E, 0x15, 0};
-        unsigned char change_com1_bps[] = {0xAA, 0x55, 0, 0, 7, 0, 0xC2, 0xC9, 0};
-        int x = write(com1, read_full_prm, sizeof(read_full_prm));
-        if (x != sizeof(read_full_prm))
-        {
-            fprintf(stderr, "%s: error: wrote %d/8 bytes\n", argv[0], x);
-            return 1;
-        }
-        usleep(500*1000); // sleep 500 ms
-        unsigned char full_prm_frame[2056];
-        x = read(com1, full_prm_frame, 2056);
-        if (x != 2056)
+        // epoll waits until the soonest deadline at the latest
+        long long next = -1;
+        for (int i = 0; i < num_of_devices; ++i)
         {
-            fprintf(stderr, "%s: error: read %d/2056 bytes\n", argv[0], x);
-            return 1;
+            d = devices + i;
+            if (d->step != DONE && (next < 0 || d->deadline < next))
+                next = d->deadline;
         }
+        long long wait = next - inslink_now_ms();
+        if (wait < 0) wait = 0;
 
-        unsigned short check_calc = 0;
-        for (int i = 2; i < x - 2; ++i)
+        struct epoll_event events[16];
+        int n = epoll_wait(epfd, events, 16, wait);
+        if (n < 0 && errno != EINTR)
         {
-            check_calc += full_prm_frame[i];
+            fprintf(stderr, "%s: error waiting for devices\n", argv[0]);
+            return 1;
         }
-        unsigned short checksum = full_prm_frame[2054] |
-                                 (full_prm_frame[2055] << 8);
-        if (check_calc != checksum)
+        for (int i = 0; i < n; ++i)
         {
-            fprintf(stderr, "%s: error: checksum mismatch in "
-                "full parameter file", argv[0]);
-            return 1;
+            d = events[i].data.ptr;
+            if (d->step == DONE) continue;
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+            {
+                device_error(d, "error: lost %s\n", d->path);
+                continue;
+            }
+            if (events[i].events & EPOLLOUT) flush_output(d);
+            if (events[i].events & EPOLLIN)
+            {
+                if (inslink_fill(&d->link, d->fd) < 0)
+                {
+                    device_error(d, "error: failed to read %s\n", d->path);
+                    continue;
+                }
+                receive(d);
+            }
         }
 
-        full_prm_frame[6 + 946] = speed2id(baud_input);
-        full_prm_frame[2] = 0;
-        full_prm_frame[3] = 0;
-        full_prm_frame[4] = 6;
-        full_prm_frame[5] = 8;
-        check_calc = 0;
-        for (int i = 2; i < x - 2; ++i)
+        long long now = inslink_now_ms();
+        active = 0;
+        for (int i = 0; i < num_of_devices; ++i)
         {
-            check_calc += full_prm_frame[i];
+            d = devices + i;
+            if (d->step != DONE && now >= d->deadline) advance(d, 0);
+            if (d->step != DONE) ++active;
         }
-        full_prm_frame[2054] = check_calc & 0xFF;
-        full_prm_frame[2055] = check_calc >> 8;
-
-        write(com1, write_full_prm, sizeof(write_full_prm));
-        usleep(100*1000); // sleep 100 ms
-        write(com1, full_prm_frame, sizeof(full_prm_frame));
-        usleep(2*1000*1000); // sleep 2 seconds
-        write(com1, change_com1_bps, sizeof(change_com1_bps));
-        usleep(600*1000); // sleep 600 ms
-
-        struct termios settings;
-        tcgetattr(com1, &settings);
-        cfsetspeed(&settings, baud_input);
-        tcsetattr(com1, TCSANOW, &settings);
-        tcflush(com1, TCOFLUSH);
-
-        unsigned char dump[100];
-        read(com1, dump, sizeof(dump));
     }
 
-    // at this point the command line arguments are processed and the program
-    // will have exited if any were invalid.
-
-    // this block reads the entire ReadINSPar message and verifies that
-    // the message structure is as expected, but only keeps the payload
-    unsigned char payload[60];
+    // each device's output, in the order they were named, under its name
+    int failed = 0;
+    for (int i = 0; i < num_of_devices; ++i)
     {
-        const unsigned char ReadINSPar_command[] =
-            {0xAA, 0x55, 0, 0, 7, 0, 0x41, 0x48, 0};
-        unsigned char header[6], checksum[2];
-
-        int x = write(com1, ReadINSPar_command, sizeof(ReadINSPar_command));
-        if (x != sizeof(ReadINSPar_command))
+        d = devices + i;
+        if (several_devices)
         {
-            fprintf(stderr, "%s: error sending ReadINSPar command "
-                            "(%d bytes written)\n", argv[0], x);
-            return 1;
+            fclose(d->out);
+            printf("%s%s:\n", i ? "\n" : "", d->path);
+            fwrite(d->out_buf, 1, d->out_size, stdout);
+            free(d->out_buf);
         }
-        usleep(50*1000); // wait for 50 milliseconds
-        x = read(com1, header, sizeof(header)); // read the header
-        x += read(com1, payload, sizeof(payload)); // read the payload
-        x += read(com1, checksum, sizeof(checksum)); // checksum
-
-        // TODO: verify the message contents
-
-        if (x != sizeof(header) + sizeof(payload) + sizeof(checksum))
-        {
-            fprintf(stderr, "%s: error receiving ReadINSPar message "
-                            "(%d bytes read)\n", argv[0], x);
-            return 1;
-        }
-    }
-
-    // take the payload and convert to usable primitives
-    struct short_prm_t dat;
-    payload2short_prm(&dat, payload);
-
-    // if the user enabled any flags, assign the appropriate data to the struct
-    if (rate_flag) dat.data_rate = rate_input;
-    if (init_flag) dat.align_time = init_input;
-    if (lever_flag)
-    {
-        dat.lever[0] = lever_input[0]*100;
-        dat.lever[1] = lever_input[1]*100;
-        dat.lever[2] = lever_input[2]*100;
+        close(d->fd);
+        failed |= d->failed;
     }
-    if (angle_flag)
-    {
-        dat.align_angles[0] = angle_input[0]*100;
-        dat.align_angles[1] = angle_input[1]*100;
-        dat.align_angles[2] = angle_input[2]*100;
-    }
-    if (print_flag) print_struct(dat);
-    if (hex_flag) print_payload(payload);
-    if (name_flag) printf("%s\n", dat.device_name);
-
-    // if no write flags are enabled, exit here
-    if (!write_flag) return 0;
-
-    // convert the struct back to a byte payload to prepare to send
-    struct2payload(&dat, payload);
-
-    const unsigned char command[] = {0xAA, 0x55, 0, 0, 7, 0, 0x40, 0x47, 0};
-    const unsigned char header[] = {0xAA, 0x55, 1, 0, 0x42, 0};
-    unsigned short checksum = 1 + 0x42;
-    for (int i = 0; i < 60; ++i)
-    {
-        checksum += payload[i];
-    }
-    const unsigned char checksum_bytes[] = {checksum & 0xFF, checksum >> 8};
-    unsigned char combined[68];
-    memcpy(combined, header, sizeof(header));
-    memcpy(combined + sizeof(header), payload, sizeof(payload));
-    memcpy(combined + sizeof(header) + sizeof(payload),
-        checksum_bytes, sizeof(checksum_bytes));
-
-    int n = write(com1, command, sizeof(command));
-    usleep(200*1000); // wait 200 milliseconds
-    n += write(com1, combined, sizeof(combined));
-    if (n < sizeof(combined))
-    {
-        fprintf(stderr, "%s: failed to write all bytes "
-            "(%d written)\n", argv[0], n);
-    }
-
-    // TODO: verify checksum match
-
-    return 0;
+    close(epfd);
+    free(devices);
+    return failed;
 }
@@ -0,0 +1,583 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "outbuf.h"
+#include "ilmsg.h"
+#include "oem7msg.h"
+
+// synthetic log generator, for testing the converters and reports at
+// sizes no real test reaches. writes an INS log of OPVT2AHR or OPVT
+// frames, or a SPAN log of INSPVAB and BESTGNSSPOSB logs, as a vehicle
+// driving a figure eight would produce them, for any duration. the
+// trajectory depends only on time, so an INS log and a SPAN log of the
+// same duration describe the same drive and can be compared like a
+// real test's. corruption, dropped frames and frames cut short can be
+// mixed in at given rates, reproducibly for a given seed.
+
+// where and when the drive starts: by the sample test, at the GPS time
+// its logs start
+#define START_LAT 39.149139
+#define START_LON -77.619384
+#define START_ALT 163.7
+#define START_WEEK 2008
+#define START_MS 325354950ULL
+#define MS_PER_WEEK 604800000ULL
+
+#define R_EARTH 6371000.0
+#define GRAVITY 9.80665
+
+// the figure eight is 2*FIG8_EAST metres east to west and 2*FIG8_NORTH
+// metres north to south, driven once every FIG8_PERIOD seconds at 9 to
+// 22 m/s; the road rises and falls FIG8_UP metres once a lap
+#define FIG8_EAST 1500.0
+#define FIG8_NORTH 750.0
+#define FIG8_UP 5.0
+#define FIG8_PERIOD 600.0
+
+// the SPAN logs INSPVA every 50 ms and BESTGNSSPOS every 200 ms, and
+// the INS gets a new GNSS fix as often
+#define INSPVA_PERIOD_MS 50
+#define GNSS_PERIOD_MS 200
+
+// the state of the vehicle at one instant
+struct epoch
+{
+    unsigned long week, ms;         // GPS week and milliseconds into it
+    double lat, lon, alt;           // degrees and metres
+    double v_east, v_north, v_up;   // m/s
+    double heading, pitch, roll;    // degrees
+    double gyro[3];                 // deg/s about right, forward and up
+    double acc[3];                  // g along right, forward and up
+};
+
+// the vehicle at ms milliseconds into the drive
+void trajectory(unsigned long long ms, struct epoch *e)
+{
+    double t = ms/1000.0, w = 2*M_PI/FIG8_PERIOD;
+    double east = FIG8_EAST*sin(w*t), north = FIG8_NORTH*sin(2*w*t);
+    double a_east = -FIG8_EAST*w*w*sin(w*t),
+           a_north = -4*FIG8_NORTH*w*w*sin(2*w*t);
+
+    unsigned long long gps_ms = START_WEEK*MS_PER_WEEK + START_MS + ms;
+    e->week = gps_ms/MS_PER_WEEK;
+    e->ms = gps_ms % MS_PER_WEEK;
+    e->lat = START_LAT + (180/M_PI)*north/R_EARTH;
+    e->lon = START_LON +
+        (180/M_PI)*east/(R_EARTH*cos((M_PI/180)*START_LAT));
+    e->alt = START_ALT + FIG8_UP*sin(w*t);
+    e->v_east = FIG8_EAST*w*cos(w*t);
+    e->v_north = 2*FIG8_NORTH*w*cos(2*w*t);
+    e->v_up = FIG8_UP*w*cos(w*t);
+
+    // heading follows the velocity, pitch follows the road, and the
+    // body leans into turns
+    double v_hor = hypot(e->v_east, e->v_north);
+    double turn_rate = (e->v_north*a_east - e->v_east*a_north)/(v_hor*v_hor);
+    double a_fwd = (e->v_east*a_east + e->v_north*a_north)/v_hor;
+    e->heading = (180/M_PI)*atan2(e->v_east, e->v_north);
+    if (e->heading < 0) e->heading += 360;
+    e->pitch = (180/M_PI)*atan2(e->v_up, v_hor);
+    e->roll = (180/M_PI)*atan(v_hor*turn_rate/GRAVITY);
+
+    e->gyro[0] = 0;
+    e->gyro[1] = 0;
+    e->gyro[2] = -(180/M_PI)*turn_rate;
+    e->acc[0] = v_hor*turn_rate/GRAVITY;
+    e->acc[1] = a_fwd/GRAVITY;
+    e->acc[2] = 1;
+}
+
+// xorshift64, so that a log can be reproduced from its seed
+unsigned long long rng_state = 88172645463325252ULL;
+unsigned long long rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// uniform on [0, 1)
+double uniform(void)
+{
+    return (rng() >> 11)*(1.0/9007199254740992.0);
+}
+
+// uniform on [-size, size), the INS's measurement noise
+double noise(double size)
+{
+    return size*(2*uniform() - 1);
+}
+
+// value in units of scale, rounded and held within [lo, hi]; OPVT's
+// narrower fields saturate rather than wrap
+long long scaled(double value, double scale, long long lo, long long hi)
+{
+    double v = floor(value/scale + 0.5);
+    if (v < lo) return lo;
+    if (v > hi) return hi;
+    return (long long) v;
+}
+
+#define I16_RANGE -32768LL, 32767LL
+#define U16_RANGE 0LL, 65535LL
+#define I32_RANGE -2147483648LL, 2147483647LL
+#define I64_RANGE -9223372036854775807LL, 9223372036854775807LL
+
+// what the INS reports at one epoch: the vehicle's state with noise,
+// and the last GNSS fix it got
+struct ins_epoch
+{
+    struct epoch e;
+    struct epoch fix;
+    unsigned char new_gps;
+};
+
+void measure(struct ins_epoch *m)
+{
+    m->e.lat += (180/M_PI)*noise(0.02)/R_EARTH;
+    m->e.lon += (180/M_PI)*noise(0.02)/R_EARTH;
+    m->e.alt += noise(0.03);
+    m->e.v_east += noise(0.02);
+    m->e.v_north += noise(0.02);
+    m->e.v_up += noise(0.02);
+    m->e.heading = fmod(m->e.heading + noise(0.05) + 360, 360);
+    m->e.pitch += noise(0.02);
+    m->e.roll += noise(0.02);
+    for (int i = 0; i < 3; ++i)
+    {
+        m->e.gyro[i] += noise(0.01);
+        m->e.acc[i] += noise(0.001);
+    }
+}
+
+void fill_opvt2ahr(struct opvt2ahr_t *frame, const struct ins_epoch *m)
+{
+    const struct epoch *e = &m->e, *fix = &m->fix;
+    memset(frame, 0, sizeof(*frame));
+    frame->heading = scaled(e->heading, 1E-2, U16_RANGE);
+    frame->pitch = scaled(e->pitch, 1E-2, I16_RANGE);
+    frame->roll = scaled(e->roll, 1E-2, I16_RANGE);
+    frame->gyro_x = scaled(e->gyro[0], 1E-5, I32_RANGE);
+    frame->gyro_y = scaled(e->gyro[1], 1E-5, I32_RANGE);
+    frame->gyro_z = scaled(e->gyro[2], 1E-5, I32_RANGE);
+    frame->acc_x = scaled(e->acc[0], 1E-6, I32_RANGE);
+    frame->acc_y = scaled(e->acc[1], 1E-6, I32_RANGE);
+    frame->acc_z = scaled(e->acc[2], 1E-6, I32_RANGE);
+    frame->mag_x = scaled(22000*sin((M_PI/180)*e->heading), 10, I16_RANGE);
+    frame->mag_y = scaled(22000*cos((M_PI/180)*e->heading), 10, I16_RANGE);
+    frame->mag_z = scaled(-37500, 10, I16_RANGE);
+    frame->temp = 412;
+    frame->vinp = 1204;
+    frame->latitude = scaled(e->lat, 1E-9, I64_RANGE);
+    frame->longitude = scaled(e->lon, 1E-9, I64_RANGE);
+    frame->altitude = scaled(e->alt, 1E-3, I32_RANGE);
+    frame->v_east = scaled(e->v_east, 1E-2, I32_RANGE);
+    frame->v_north = scaled(e->v_north, 1E-2, I32_RANGE);
+    frame->v_up = scaled(e->v_up, 1E-2, I32_RANGE);
+    frame->lat_GNSS = scaled(fix->lat, 1E-9, I64_RANGE);
+    frame->lon_GNSS = scaled(fix->lon, 1E-9, I64_RANGE);
+    frame->alt_GNSS = scaled(fix->alt, 1E-3, I32_RANGE);
+    frame->vh_GNSS = scaled(hypot(fix->v_east, fix->v_north), 1E-2,
+        I32_RANGE);
+    frame->track_grnd = scaled(fix->heading, 1E-2, I16_RANGE);
+    frame->vup_GNSS = scaled(fix->v_up, 1E-2, I32_RANGE);
+    frame->ms_gps = e->ms;
+    frame->GNSS_info1 = 48;
+    frame->GNSS_info2 = 108;
+    frame->solnSVs = 11;
+    frame->angle_pos_type = 100;
+    frame->latency_ms_hdg = -15;
+    frame->latency_ms_pos = -45;
+    frame->latency_ms_vel = -35;
+    frame->p_bar = 50240;
+    frame->h_bar = scaled(e->alt, 1E-2, I32_RANGE);
+    frame->new_gps = m->new_gps;
+}
+
+void fill_opvt(struct opvt_t *frame, const struct ins_epoch *m)
+{
+    const struct epoch *e = &m->e, *fix = &m->fix;
+    memset(frame, 0, sizeof(*frame));
+    frame->heading = scaled(e->heading, 1E-2, U16_RANGE);
+    frame->pitch = scaled(e->pitch, 1E-2, I16_RANGE);
+    frame->roll = scaled(e->roll, 1E-2, I16_RANGE);
+    frame->gyro_x = scaled(e->gyro[0], 1E-5, I16_RANGE);
+    frame->gyro_y = scaled(e->gyro[1], 1E-5, I16_RANGE);
+    frame->gyro_z = scaled(e->gyro[2], 1E-5, I16_RANGE);
+    frame->acc_x = scaled(e->acc[0], 1E-6, I16_RANGE);
+    frame->acc_y = scaled(e->acc[1], 1E-6, I16_RANGE);
+    frame->acc_z = scaled(e->acc[2], 1E-6, I16_RANGE);
+    frame->mag_x = scaled(22000*sin((M_PI/180)*e->heading), 10, I16_RANGE);
+    frame->mag_y = scaled(22000*cos((M_PI/180)*e->heading), 10, I16_RANGE);
+    frame->mag_z = scaled(-37500, 10, I16_RANGE);
+    frame->temp = 412;
+    frame->vinp = 1204;
+    frame->latitude = scaled(e->lat, 1E-9, I32_RANGE);
+    frame->longitude = scaled(e->lon, 1E-9, I32_RANGE);
+    frame->altitude = scaled(e->alt, 1E-3, I32_RANGE);
+    frame->v_east = scaled(e->v_east, 1E-2, I32_RANGE);
+    frame->v_north = scaled(e->v_north, 1E-2, I32_RANGE);
+    frame->v_up = scaled(e->v_up, 1E-2, I32_RANGE);
+    frame->lat_GNSS = scaled(fix->lat, 1E-9, I32_RANGE);
+    frame->lon_GNSS = scaled(fix->lon, 1E-9, I32_RANGE);
+    frame->alt_GNSS = scaled(fix->alt, 1E-3, I32_RANGE);
+    frame->vh_GNSS = scaled(hypot(fix->v_east, fix->v_north), 1E-2,
+        I32_RANGE);
+    frame->track_grnd = scaled(fix->heading, 1E-2, I16_RANGE);
+    frame->vup_GNSS = scaled(fix->v_up, 1E-2, I32_RANGE);
+    frame->ms_gps = e->ms;
+    frame->GNSS_info1 = 48;
+    frame->GNSS_info2 = 108;
+    frame->solnSVs = 11;
+    frame->latency_ms_pos = -45;
+    frame->latency_ms_vel = -35;
+    frame->p_bar = 50240;
+    frame->h_bar = scaled(e->alt, 1E-2, I32_RANGE);
+    frame->new_gps = m->new_gps;
+}
+
+// the header every SPAN log gets, as the sample's have it
+void fill_oem7_header(struct oem7_header_t *header, const struct epoch *e,
+    unsigned short reserved)
+{
+    memset(header, 0, sizeof(*header));
+    header->port_addr = 64; // COM2
+    header->idle_time = 174;
+    header->time_status = 180; // FINESTEERING
+    header->week = e->week;
+    header->ms = e->ms;
+    header->rcvr_stat = 0x02000000;
+    header->reserved = reserved;
+    header->version = 14307;
+}
+
+void fill_inspva(struct inspva_t *log, const struct epoch *e)
+{
+    memset(log, 0, sizeof(*log));
+    fill_oem7_header(&log->header, e, 0x54e2);
+    log->week = e->week;
+    log->seconds = e->ms/1000.0;
+    log->latitude = e->lat;
+    log->longitude = e->lon;
+    log->altitude = e->alt;
+    log->v_north = e->v_north;
+    log->v_east = e->v_east;
+    log->v_up = e->v_up;
+    log->roll = e->roll;
+    log->pitch = e->pitch;
+    log->azimuth = e->heading;
+    log->status = 3; // INS_SOLUTION_GOOD
+}
+
+void fill_pos(struct pos_t *log, const struct epoch *e)
+{
+    memset(log, 0, sizeof(*log));
+    fill_oem7_header(&log->header, e, 0x159f);
+    log->sol_status = 0; // SOL_COMPUTED
+    log->pos_type = 50; // NARROW_INT
+    log->latitude = e->lat;
+    log->longitude = e->lon;
+    log->altitude = e->alt;
+    log->undulation = -33.5f;
+    log->datum_ID = 61; // WGS84
+    log->lat_STD = 0.01f;
+    log->lon_STD = 0.01f;
+    log->alt_STD = 0.02f;
+    log->station_ID[0] = '0';
+    log->diff_age = 1.0f;
+    log->SVs = 20;
+    log->solnSVs = 18;
+    log->ggL1 = 18;
+    log->solnMultiSVs = 18;
+}
+
+// how damaged the log is, and how much damage has been done
+struct damage
+{
+    double corrupt, drop, truncate;
+
+    // bytes to go until the next one corrupted
+    unsigned long long gap;
+
+    unsigned long long frames, dropped, truncated, corrupted;
+};
+
+// bytes between one corrupted byte and the next, geometrically
+// distributed so that each byte is corrupted with probability rate
+unsigned long long corruption_gap(double rate)
+{
+    double u = 1 - uniform();
+    return (unsigned long long) floor(log(u)/log(1 - rate));
+}
+
+// writes a frame of len bytes to out, unless it's dropped, perhaps
+// cut short and with some bytes corrupted; returns nonzero if writing
+// failed
+int emit(struct outbuf *out, struct damage *d, unsigned char *frame,
+    unsigned long len)
+{
+    ++d->frames;
+    if (d->drop > 0 && uniform() < d->drop)
+    {
+        ++d->dropped;
+        return 0;
+    }
+    if (d->truncate > 0 && uniform() < d->truncate)
+    {
+        len = 1 + rng() % (len - 1);
+        ++d->truncated;
+    }
+    if (d->corrupt > 0)
+    {
+        while (d->gap < len)
+        {
+            frame[d->gap] ^= 1 + rng() % 255;
+            ++d->corrupted;
+            d->gap += 1 + corruption_gap(d->corrupt);
+        }
+        d->gap -= len;
+    }
+    return outbuf_write(out, frame, len);
+}
+
+enum { KIND_OPVT2AHR, KIND_OPVT, KIND_SPAN };
+
+// writes the whole log; returns nonzero if writing failed
+int generate(const char *progname, const char *outfn, struct outbuf *out,
+    unsigned kind, unsigned long long duration_ms, unsigned period_ms,
+    struct damage *d)
+{
+    unsigned char buf[IL_OPVT2AHR_LEN + OEM7_MIN_HEADER_LEN + 256];
+    unsigned char progress, old_progress = 255;
+    int error = 0;
+
+    if (kind == KIND_SPAN)
+    {
+        // the receiver's answers to the commands starting the test
+        static const char reply[] = "\r\n<OK\r\n[COM2]\r\n";
+        error |= outbuf_write(out, reply, sizeof(reply) - 1);
+    }
+    else
+    {
+        // the ACK of the command starting the data, then the initial
+        // alignment block
+        unsigned char type = kind == KIND_OPVT ? IL_OPVT_TYPE
+                                               : IL_OPVT2AHR_TYPE;
+        unsigned char ack[IL_ACK_LEN] =
+            {0xAA, 0x55, 0x01, type, 0x08, 0x00, 0x5F, 0x00};
+        unsigned short checksum = 0;
+        for (int i = 2; i < IL_ACK_LEN - 2; ++i) checksum += ack[i];
+        ack[8] = checksum & 0xFF;
+        ack[9] = checksum >> 8;
+        error |= outbuf_write(out, ack, IL_ACK_LEN);
+
+        struct epoch e;
+        trajectory(0, &e);
+        struct short_align_block align;
+        memset(&align, 0, sizeof(align));
+        align.gyro_bias[0] = -0.355f;
+        align.gyro_bias[1] = 0.512f;
+        align.gyro_bias[2] = -0.738f;
+        align.avg_accel[2] = -4028.9f;
+        align.avg_mag[0] = -4448.6f;
+        align.avg_mag[1] = -3075.2f;
+        align.avg_mag[2] = 7987.1f;
+        align.init_hdg = e.heading;
+        align.init_roll = e.roll;
+        align.init_pitch = e.pitch;
+        header2payload(&align, buf);
+        error |= outbuf_write(out, buf, IL_ALIGN_LEN);
+    }
+
+    struct ins_epoch m;
+    memset(&m, 0, sizeof(m));
+    for (unsigned long long ms = 0; ms < duration_ms && !error;
+         ms += period_ms)
+    {
+        struct epoch e;
+        trajectory(ms, &e);
+        if (kind == KIND_SPAN)
+        {
+            struct inspva_t inspva;
+            fill_inspva(&inspva, &e);
+            error |= emit(out, d, buf, inspva2payload(&inspva, buf));
+            if (ms % GNSS_PERIOD_MS == 0)
+            {
+                struct pos_t pos;
+                fill_pos(&pos, &e);
+                error |= emit(out, d, buf,
+                    pos2payload(&pos, buf, BESTGNSSPOS));
+            }
+        }
+        else
+        {
+            m.e = e;
+            m.new_gps = ms % GNSS_PERIOD_MS == 0;
+            if (m.new_gps) m.fix = e;
+            measure(&m);
+            if (kind == KIND_OPVT2AHR)
+            {
+                struct opvt2ahr_t frame;
+                fill_opvt2ahr(&frame, &m);
+                opvt2ahr2payload(&frame, buf);
+                error |= emit(out, d, buf, IL_OPVT2AHR_LEN);
+            }
+            else
+            {
+                struct opvt_t frame;
+                fill_opvt(&frame, &m);
+                opvt2payload(&frame, buf);
+                error |= emit(out, d, buf, IL_OPVT_LEN);
+            }
+        }
+
+        progress = 100*ms/duration_ms;
+        if (progress != old_progress)
+        {
+            old_progress = progress;
+            fprintf(stderr, "\r%s: Writing to %s: %2hhu%%",
+                progname, outfn, progress);
+        }
+    }
+    fprintf(stderr, "\r%s: Writing to %s: Done.\n", progname, outfn);
+    return error;
+}
+
+// a duration in seconds, or in minutes, hours or days with a suffix m,
+// h or d; 0 if it isn't one
+unsigned long long parse_duration(const char *arg)
+{
+    char *end;
+    double value = strtod(arg, &end);
+    double unit = 1;
+    if (!strcmp(end, "m")) unit = 60;
+    else if (!strcmp(end, "h")) unit = 3600;
+    else if (!strcmp(end, "d")) unit = 86400;
+    else if (*end && strcmp(end, "s")) return 0;
+    if (!(value > 0)) return 0;
+    return (unsigned long long) (value*unit*1000);
+}
+
+const char* argument_error =
+    "%s: invalid option -- '%s'\n"
+    "type '%s --usage' for more info\n";
+
+const char* usage_help =
+    "usage: %s outfile [-k kind] [-d duration] [-r rate] [-c rate]\n"
+    "    [--drop rate] [--truncate rate] [--seed n]\n"
+    "  outfile: where to write the log\n"
+    "  [-k, --kind kind]: opvt2ahr (the default) or opvt for an INS\n"
+    "    log, or span for a SPAN log of INSPVAB and BESTGNSSPOSB\n"
+    "  [-d, --duration duration]: length of the drive in seconds, or\n"
+    "    with a suffix m, h or d; 10m by default. an hour of OPVT2AHR\n"
+    "    at 200 Hz is about 99 MB\n"
+    "  [-r, --rate hz]: INS frames per second, 200 by default; must\n"
+    "    divide 1000\n"
+    "  [-c, --corrupt rate]: fraction of bytes overwritten at random\n"
+    "  [--drop rate]: fraction of frames left out\n"
+    "  [--truncate rate]: fraction of frames cut short, as when a\n"
+    "    capture stops or a link drops partway through one\n"
+    "  [--seed n]: seed for the noise and the damage\n"
+    "OPVT's narrower fields saturate at the scales opvt reads them\n"
+    "with, so its positions, rates and accelerations are clipped\n";
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) // first argument must be outfile
+    {
+        fprintf(stderr, "%s: must provide a filename first\n", argv[0]);
+        return 1;
+    }
+
+    // special case: if first argument is "--usage", print the usage
+    // help string to stderr
+    if (strcmp(argv[1], "--usage") == 0)
+    {
+        printf(usage_help, argv[0]);
+        return 0;
+    }
+
+    unsigned kind = KIND_OPVT2AHR;
+    unsigned long long duration_ms = 600000;
+    long rate = 200;
+    struct damage d;
+    memset(&d, 0, sizeof(d));
+    for (int i = 2; i < argc; ++i)
+    {
+        if (i + 1 >= argc)
+        {
+            fprintf(stderr, usage_help, argv[0]);
+            return 1;
+        }
+        const char *opt = argv[i], *arg = argv[++i];
+        int bad = 0;
+        if (!strcmp(opt, "-k") | !strcmp(opt, "--kind"))
+        {
+            if (!strcmp(arg, "opvt2ahr")) kind = KIND_OPVT2AHR;
+            else if (!strcmp(arg, "opvt")) kind = KIND_OPVT;
+            else if (!strcmp(arg, "span")) kind = KIND_SPAN;
+            else bad = 1;
+        }
+        else if (!strcmp(opt, "-d") | !strcmp(opt, "--duration"))
+            bad = !(duration_ms = parse_duration(arg));
+        else if (!strcmp(opt, "-r") | !strcmp(opt, "--rate"))
+        {
+            rate = atol(arg);
+            bad = rate < 1 || rate > 1000 || 1000 % rate;
+        }
+        else if (!strcmp(opt, "-c") | !strcmp(opt, "--corrupt"))
+        {
+            d.corrupt = atof(arg);
+            bad = d.corrupt < 0 || d.corrupt >= 1;
+        }
+        else if (!strcmp(opt, "--drop"))
+        {
+            d.drop = atof(arg);
+            bad = d.drop < 0 || d.drop > 1;
+        }
+        else if (!strcmp(opt, "--truncate"))
+        {
+            d.truncate = atof(arg);
+            bad = d.truncate < 0 || d.truncate > 1;
+        }
+        else if (!strcmp(opt, "--seed"))
+        {
+            // xorshift must never be seeded with 0
+            rng_state ^= strtoull(arg, 0, 0);
+            if (!rng_state) rng_state = 1;
+        }
+        else arg = opt;
+        if (bad || arg == opt)
+        {
+            fprintf(stderr, argument_error, argv[0], arg, argv[0]);
+            return 1;
+        }
+    }
+    if (d.corrupt > 0) d.gap = corruption_gap(d.corrupt);
+
+    struct outbuf out;
+    int outfd = open(argv[1], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (outfd == -1 || outbuf_open(&out, outfd, OUTBUF_DEFAULT_CAP))
+    {
+        fprintf(stderr, "%s: failed to open '%s'\n", argv[0], argv[1]);
+        return 1;
+    }
+
+    unsigned period_ms = kind == KIND_SPAN ? INSPVA_PERIOD_MS : 1000/rate;
+    int error = generate(argv[0], argv[1], &out, kind, duration_ms,
+        period_ms, &d);
+    error |= outbuf_close(&out);
+    if (close(outfd)) error = 1;
+    fprintf(stderr, "%s: wrote %llu bytes: %llu frames, %llu dropped, "
+        "%llu cut short, %llu bytes corrupted\n", argv[0], out.bytes,
+        d.frames, d.dropped, d.truncated, d.corrupted);
+    if (error) fprintf(stderr, "%s: error writing output\n", argv[0]);
+    return error;
+}
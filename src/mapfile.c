@@ -0,0 +1,56 @@
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mapfile.h"
+
+int map_file(struct mapped_file *mf, const char *filename)
+{
+    if (!mf || !filename) return 1;
+
+    mf->data = 0;
+    mf->len = 0;
+    mf->fd = open(filename, O_RDONLY);
+    if (mf->fd == -1) return 1;
+
+    struct stat st;
+    if (fstat(mf->fd, &st) == -1)
+    {
+        close(mf->fd);
+        mf->fd = -1;
+        return 1;
+    }
+
+    mf->len = st.st_size;
+    if (mf->len == 0) return 0; // mmap refuses zero-length mappings
+
+    void *addr = mmap(0, mf->len, PROT_READ, MAP_PRIVATE, mf->fd, 0);
+    if (addr == MAP_FAILED)
+    {
+        close(mf->fd);
+        mf->fd = -1;
+        mf->len = 0;
+        return 1;
+    }
+
+    // the decoders walk the file front to back exactly once, so ask
+    // for aggressive readahead and early reclaim of consumed pages
+    madvise(addr, mf->len, MADV_SEQUENTIAL);
+    mf->data = (unsigned char*) addr;
+    return 0;
+}
+
+void unmap_file(struct mapped_file *mf)
+{
+    if (!mf) return;
+
+    if (mf->data) munmap(mf->data, mf->len);
+    if (mf->fd != -1) close(mf->fd);
+    mf->data = 0;
+    mf->len = 0;
+    mf->fd = -1;
+}
@@ -0,0 +1,23 @@
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+// read-only view of an input log. the converters decode frames
+// directly out of this mapping rather than copying the whole file
+// into a malloc'd buffer first, so memory use and startup time no
+// longer depend on the size of the log.
+struct mapped_file
+{
+    unsigned char *data;
+    unsigned long long len;
+    int fd;
+};
+
+// maps the file at the given path into memory and advises the kernel
+// that it will be read sequentially. an empty file is not an error;
+// data is null and len is zero in that case. returns 0 on success.
+int map_file(struct mapped_file *mf, const char *filename);
+
+// releases a mapping created by map_file
+void unmap_file(struct mapped_file *mf);
+
+#endif // MAPFILE_H
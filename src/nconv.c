@@ -1,491 +1,238 @@
+#define _DEFAULT_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
 #include <string.h>
 #include <fcntl.h>
 
-char numstr[11] = {0};
-
-char* num2str(unsigned long num)
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapfile.h"
+#include "follow.h"
+#include "outbuf.h"
+#include "colfile.h"
+#include "syncscan.h"
+#include "parconv.h"
+#include "scanstat.h"
+#include "timeidx.h"
+#include "decimate.h"
+#include "report.h"
+#include "oem7msg.h"
+
+// output files of a conversion, carried from one call of
+// convert_block to the next
+struct nconv_state
 {
-    sprintf(numstr, "%lu", num);
-    return numstr;
-}
+    struct oem7_outputs out;
+    const char *ckpt_fn;
 
-// encoding for the NovAtel OEM7 COM port ID table;
-// does not contain all COM port mappings
-// https://docs.novatel.com/OEM7/Content/Messages/Binary.htm
-char* port_str(unsigned long port_id)
-{
-    // there are literally 11,456 cases
-    // for this enumeration, so I'm not going
-    // to try to include all of them; just
-    // the most common ones
+    // known logs dropped because their CRC didn't match
+    unsigned long long rejected;
 
-    switch (port_id)
-    {
-        case 0: return "NO_PORTS";
-        case 1: return "COM1_ALL";
-        case 2: return "COM2_ALL";
-        case 3: return "COM3_ALL";
-        case 6: return "THISPORT_ALL";
-        case 7: return "FILE_ALL";
-        case 8: return "ALL_PORTS";
-        case 9: return "XCOM1_ALL";
-        case 10: return "XCOM2_ALL";
-        case 13: return "USB1_ALL";
-        case 14: return "USB2_ALL";
-        case 15: return "USB3_ALL";
-        case 16: return "AUX_ALL";
-        case 17: return "XCOM3_ALL";
-        case 19: return "COM4_ALL";
-        case 20: return "ETH1_ALL";
-        case 21: return "IMU_ALL";
-        case 23: return "ICOM1_ALL";
-        case 24: return "ICOM2_ALL";
-        case 25: return "ICOM3_ALL";
-        case 26: return "NCOM1_ALL";
-        case 27: return "NCOM2_ALL";
-        case 28: return "NCOM3_ALL";
-        case 29: return "ICOM4_ALL";
-        case 30: return "WCOM4_ALL";
-        case 32: return "COM1";
-        case 33: return "COM1_1";
-        // ...
-        case 63: return "COM1_31";
-        case 64: return "COM2";
-        case 65: return "COM2_1";
-        // ...
-        case 95: return "COM2_31";
-        case 96: return "COM3";
-        case 97: return "COM3_1";
-        // ...
-        case 127: return "COM3_31";
-        case 160: return "SPECIAL";
-        case 161: return "SPECIAL_1";
-        // ...
-        case 191: return "SPECIAL_31";
-        case 192: return "THISPORT";
-        case 193: return "THISPORT_1";
-        // ...
-        case 223: return "THISPORT_31";
-        case 225: return "FILE";
-        case 226: return "FILE_1";
-        case 255: return "FILE_31";
-    }
-    return num2str(port_id);
-}
+    // with --scan or --index, where logs are counted instead of
+    // converted, and the index of INSPVA logs if one is being built
+    struct scan_stats *scan;
+    struct timeidx *index;
 
-// encoding for NovAtel OEM7 INS solution status
-// https://docs.novatel.com/OEM7/Content/SPAN_Logs/INSATT.htm#InertialSolutionStatus
-char* insstat_str(unsigned long ins_status)
-{
-    switch (ins_status)
-    {
-        case 0: return "INS_INACTIVE";
-        case 1: return "INS_ALIGNING";
-        case 2: return "INS_HIGH_VARIANCE";
-        case 3: return "INS_SOLUTION_GOOD";
-        case 6: return "INS_SOLUTION_FREE";
-        case 7: return "INS_ALIGNMENT_COMPLETE";
-        case 8: return "DETERMINING_ORIENTATION";
-        case 9: return "WAITING_INITIALPOS";
-        case 10: return "WAITING_AZIMUTH";
-        case 11: return "INITIALIZING_BIASES";
-        case 12: return "MOTION_DETECT";
-    }
-    return num2str(ins_status);
-}
+    // with --from and --to, the window of GPS milliseconds into the
+    // week whose logs are converted, and whether a log past it has
+    // been reached
+    unsigned char from_flag, to_flag, past_window;
+    unsigned long from_ms, to_ms;
 
+    // the grids of --decimate, one per kind of log, if it was given
+    struct decim_grids *grids;
+};
 
-// encoding for NovAtel OEM7 receiver fix status
-// https://docs.novatel.com/OEM7/Content/Logs/BESTPOS.htm#SolutionStatus
-char* solstat_str(unsigned long sol_status)
+// GPS milliseconds into the week from the header of the log at buf
+unsigned long log_ms(const unsigned char *log)
 {
-    switch (sol_status)
-    {
-        case 0: return "SOL_COMPUTED";
-        case 1: return "INSUFFICIENT_OBS";
-        case 2: return "NO_CONVERGENCE";
-        case 3: return "SINGULARIY";
-        case 4: return "COV_TRACE";
-        case 5: return "TEST_DIST";
-        case 6: return "COLD_START";
-        case 7: return "V_H_LIMIT";
-        case 8: return "VARIANCE";
-        case 9: return "RESIDUALS";
-        case 13: return "INTEGRITY_WARNING";
-        case 18: return "PENDING";
-        case 19: return "INVALID_FIX";
-        case 20: return "UNAUTHORIZED";
-        case 22: return "INVALID_RATE";
-    }
-    return num2str(sol_status);
+    return log[16] | (log[17] << 8) | ((unsigned long) log[18] << 16) |
+           ((unsigned long) log[19] << 24);
 }
 
-// encoding for NovAtel OEM7 receiver position type
-// https://docs.novatel.com/OEM7/Content/Logs/BESTPOS.htm#Position_VelocityType
-char* postype_str(unsigned long pos_type)
+// counts the log at offset pos in buf, which passed its CRC check, for
+// --scan and --index: INSPVA logs are the timed frames, and every
+// other log is counted as one
+void scan_log(struct nconv_state *st, unsigned char *buf,
+    unsigned long long pos, unsigned short msg_ID, unsigned long msg_len,
+    unsigned long loglen)
 {
-    switch (pos_type)
+    struct inspva_t frame;
+    if (msg_ID == INSPVA_ID && msg_len == INSPVA_MSG_LEN &&
+        !payload2inspva(&frame, buf + pos))
     {
-        case 0: return "NONE";
-        case 1: return "FIXEDPOS";
-        case 2: return "FIXEDHEIGHT";
-        case 4: return "FLOATCONV";
-        case 5: return "WIDELANE";
-        case 6: return "NARROWLANE";
-        case 8: return "DOPPLER_VELOCITY";
-        case 16: return "SINGLE";
-        case 17: return "PSRDIFF";
-        case 18: return "WAAS";
-        case 19: return "PROPAGATED";
-        case 32: return "L1_FLOAT";
-        case 33: return "IONOFREE_FLOAT";
-        case 34: return "NARROW_FLOAT";
-        case 48: return "L1_INT";
-        case 49: return "WIDE_INT";
-        case 50: return "NARROW_INT";
-        case 51: return "RTK_DIRECT_INS";
-        case 52: return "INS_SBAS";
-        case 53: return "INS_PSRSP";
-        case 54: return "INS_PSRDIFF";
-        case 55: return "INS_RTKFLOAT";
-        case 56: return "INS_RTKFIXED";
-        case 68: return "PPP_CONVERGING";
-        case 69: return "PPP";
-        case 70: return "OPERATIONAL";
-        case 71: return "WARNING";
-        case 72: return "OUT_OF_BOUNDS";
-        case 73: return "INS_PPP_CONVERGING";
-        case 74: return "INS_PPP";
-        case 77: return "PPP_BASIC_CONVERGING";
-        case 78: return "PPP_BASIC";
-        case 79: return "INS_PPP_BASIC";
-        case 80: return "INS_PPP_BASIC_CONVERGING";
+        scan_frame(st->scan, frame.header.ms, loglen);
+        if (st->index) timeidx_add(st->index, frame.header.ms, pos);
     }
-    return num2str(pos_type);
+    else scan_other(st->scan, loglen);
 }
 
-// encoding for NovAtel OEM7 GPS reference time status
-// https://docs.novatel.com/OEM7/Content/Messages/GPS_Reference_Time_Statu.htm
-char* timestat_str(unsigned char time_status)
+// decodes every complete log that starts before stop in buf and
+// returns the offset where decoding stopped: at or past stop, unless
+// the buffer ran out first. each log is framed by the lengths in its
+// header (header_len + msg_len + 4 byte CRC) and, once its CRC checks
+// out, either handed to its registered converter or skipped whole, so
+// a log starting just before stop is read to its end past stop. a log
+// cut off by the end of the buffer is left unconsumed, so that the
+// caller can complete it with more data and call again from that point,
+// unless final is nonzero: at the end of the input, a header whose log
+// would run past it can only be a false sync hit or a truncated log.
+unsigned long long convert_block(struct nconv_state *st,
+    unsigned char *buf, unsigned long long len, unsigned long long stop,
+    int final)
 {
-    switch (time_status)
+    // a sync sequence starting just before stop is found whole
+    unsigned long long scan_len = stop + 2 < len ? stop + 2 : len;
+    unsigned long long rptr = 0;
+    while (rptr < stop && rptr + 10 <= len)
     {
-        case 20: return "UNKNOWN";
-        case 60: return "APPROXIMATE";
-        case 80: return "COARSEADJUSTING";
-        case 100: return "COARSE";
-        case 120: return "COARSESTEERING";
-        case 130: return "FREEWHEELING";
-        case 150: return "FINEADJUSTING";
-        case 160: return "FINE";
-        case 170: return "FINEBACKUPSTEERING";
-        case 180: return "FINESTEERING";
-        case 200: return "SATTIME";
-    }
-    return num2str(time_status);
-}
+        // skip straight to the next place a log could start
+        rptr += sync_scan(buf + rptr, scan_len - rptr, oem7_sync, 3);
+        if (rptr >= stop || rptr + 10 > len) break;
+
+        unsigned short msg_ID = buf[rptr+4] | (buf[rptr+5] << 8);
+        unsigned long msg_len = buf[rptr+8] | (buf[rptr+9] << 8);
+        unsigned long loglen = oem7_log_len(buf + rptr);
+        if (!loglen)
+        {
+            ++rptr; // not a real header
+            continue;
+        }
+        // only a log we convert is waited for, and only if its header
+        // gives the length it should have. a cut off log of any other
+        // kind is scanned through instead, so that a false sync hit
+        // claiming a long log can't hold up the logs after it.
+        const struct oem7_handler *handler = oem7_find_handler(msg_ID);
+        if (loglen > len - rptr)
+        {
+            if (!final && handler && msg_len == handler->msg_len) break;
+            ++rptr;
+            continue;
+        }
 
-// encoding for NovAtel OEM7 datum ID
-// https://docs.novatel.com/OEM7/Content/Commands/DATUM.htm
-char* datum_str(unsigned char datum_ID)
-{
-    switch (datum_ID)
-    {
-        case 60: return "WGS72";
-        case 61: return "WGS84";
+        // sync bytes turn up inside other logs' payloads, and damaged
+        // logs still carry their sync bytes; neither passes the CRC
+        if (!oem7_crc_ok(buf + rptr, loglen))
+        {
+            if (handler) ++st->rejected;
+            ++rptr;
+            continue;
+        }
+
+        if (st->scan) scan_log(st, buf, rptr, msg_ID, msg_len, loglen);
+        else if (handler && msg_len == handler->msg_len)
+        {
+            // logs outside the window or between the rows of
+            // --decimate are never formatted, and the first converted
+            // log past the window ends the conversion
+            unsigned long ms = log_ms(buf + rptr);
+            if (st->to_flag && timeidx_diff(ms, st->to_ms) > 0)
+            {
+                st->past_window = 1;
+                return rptr;
+            }
+            if ((!st->from_flag || timeidx_diff(ms, st->from_ms) >= 0) &&
+                (!st->grids || decim_keep_kind(st->grids, msg_ID, ms)))
+                handler->convert(&st->out, buf + rptr, msg_ID);
+        }
+        rptr += loglen;
     }
-    return num2str(datum_ID);
+    return rptr;
 }
 
-// NovAtel OEM7 header structure
-// https://docs.novatel.com/OEM7/Content/Messages/ASCII.htm
-struct oem7_header_t
+unsigned long long follow_decode(void *ctx,
+    unsigned char *buf, unsigned long long len)
 {
-    unsigned char sync_bytes[3], header_len;
-    unsigned short msg_ID;
-    unsigned char msg_type, port_addr;
-    unsigned short msg_len, sequence;
-    unsigned char idle_time;
-
-    // this is actually an enum:
-    unsigned char time_status;
-
-    unsigned short week;
-    unsigned long ms, rcvr_stat;
-    unsigned short reserved, version;
-};
-
-// NovAtel OEM7 INS Position, Velocity, and Attitude message
-// https://docs.novatel.com/OEM7/Content/SPAN_Logs/INSPVA.htm
-struct inspva_t
-{
-    struct oem7_header_t header;
-    unsigned long week;
-    double seconds;
-    double latitude, longitude, altitude,
-           v_north, v_east, v_up,
-           roll, pitch, azimuth;
-
-    // actually an enum
-    unsigned long status, checksum;
-};
+    return convert_block((struct nconv_state*) ctx, buf, len, len, 0);
+}
 
-// takes a pointer to a inspva_t struct, and a pointer to an unsigned
-// char array. the unsigned char pointer MUST point to the first
-// sync byte of any NovAtel message, i.e. 0xAA. the sync bytes defined
-// by NovAtel OEM7 are 0xAA, 0x44, 0x12. if the payload pointer does
-// not point at the sync bytes of an INSPVA binary message, the
-// function will return an error code and the resulting inspva_t is
-// invalid. upon success, the function will return 0.
-int payload2inspva(struct inspva_t *frame, unsigned char *payload)
+// the first log at or after pos that passes its CRC check; -j chunks
+// start only there
+unsigned long long align_log(void *ctx,
+    unsigned char *data, unsigned long long len, unsigned long long pos)
 {
-    if (!frame || !payload) return 1;
-
-    if ((payload[0] != 0xAA) || (payload[1] != 0x44) ||
-        (payload[2] != 0x12) ||
-        (payload[4] != 0xFB) || (payload[5] != 0x01))
+    (void) ctx;
+    while (pos + 10 <= len)
     {
-        // this isn't the start of a SPAN INSPVA packet
-        return 1;
-    }
+        pos += sync_scan(data + pos, len - pos, oem7_sync, 3);
+        if (pos + 10 > len) break;
 
-    memcpy(frame->header.sync_bytes, payload, 3);
-    unsigned short N = (frame->header.header_len = payload[3]);
-    frame->header.msg_ID = payload[4] | (payload[5] << 8);
-    frame->header.msg_type = payload[6];
-    frame->header.port_addr = payload[7];
-    frame->header.msg_len = payload[8] | (payload[9] << 8);
-    frame->header.sequence = payload[10] | (payload[11] << 8);
-    frame->header.idle_time = payload[12];
-    frame->header.time_status = payload[13]; // enum
-    frame->header.week = payload[14] | (payload[15] << 8);
-    frame->header.ms = payload[16] | (payload[17] << 8) |
-                       (payload[18] << 16) | (payload[19] << 24);
-    frame->header.rcvr_stat = payload[20] | (payload[21] << 8) |
-                              (payload[22] << 16) | (payload[23] << 24);
-    frame->header.reserved = payload[24] | (payload[25] << 8);
-    frame->header.version = payload[26] | (payload[27] << 8);
-
-    frame->week = payload[N] | (payload[N+1] << 8) |
-                  (payload[N+2] << 16) | (payload[N+3] << 24);
-    memcpy(&frame->seconds, payload+N+4, 8);
-
-    memcpy(&frame->latitude, payload+N+12, 8);
-    memcpy(&frame->longitude, payload+N+20, 8);
-    memcpy(&frame->altitude, payload+N+28, 8);
-
-    memcpy(&frame->v_north, payload+N+36, 8);
-    memcpy(&frame->v_east, payload+N+44, 8);
-    memcpy(&frame->v_up, payload+N+52, 8);
-
-    memcpy(&frame->roll, payload+N+60, 8);
-    memcpy(&frame->pitch, payload+N+68, 8);
-    memcpy(&frame->azimuth, payload+N+76, 8);
-
-    frame->status = payload[N+84] | (payload[N+85] << 8) |
-                    (payload[N+86] << 16) | (payload[N+87] << 24);
-    frame->checksum = payload[N+88] | (payload[N+89] << 8) |
-                      (payload[N+90] << 16) | (payload[N+91] << 24);
-    return 0;
+        unsigned long loglen = oem7_log_len(data + pos);
+        if (loglen && loglen <= len - pos && oem7_crc_ok(data + pos, loglen))
+        {
+            return pos;
+        }
+        ++pos;
+    }
+    return len;
 }
 
-// imitates (imperfectly) the ASCII output produced by NovAtel Convert;
-// prints a single line of INSPVAA onto the FILE* provided.
-void println_inspva(FILE *out, struct inspva_t *frame)
+// converts one -j chunk into its own pair of text outbufs
+unsigned long long decode_chunk(void *ctx, unsigned char *data,
+    unsigned long long len, unsigned long long start,
+    unsigned long long stop, struct outbuf *outs, unsigned long long *tally)
 {
-    if (!out || !frame) return;
-
-    fprintf(out, "#INSPVAA,"
-                 "%s," // port_addr - string
-                 // "%hhu," // msg_type - uchar
-                 // "%hu," // msg_len - ushort
-                 "%hu," // sequence - ushort
-                 "%.1f," // idle_time - float
-                 "%s," // time_status - string
-                 "%hu," // week - ushort
-                 "%.3f,%08lx,%hx,%hu",
-        port_str(frame->header.port_addr),
-        // frame->header.msg_type,
-        // frame->header.msg_len,
-        frame->header.sequence,
-        frame->header.idle_time/2.0,
-        timestat_str(frame->header.time_status),
-        frame->header.week,
-        frame->header.ms/1000.0,
-        frame->header.rcvr_stat,
-        frame->header.reserved,
-        frame->header.version);
-    fprintf(out, ";");
-    fprintf(out, "%lu,%.9f,%.11f,%.11f,%.4f,"
-                 "%.4f,%.4f,%.4f,%.9f,%.9f,%.9f,%s*%08lx\n",
-        frame->week, frame->seconds,
-        frame->latitude, frame->longitude, frame->altitude,
-        frame->v_north, frame->v_east, frame->v_up,
-        frame->roll, frame->pitch, frame->azimuth,
-        insstat_str(frame->status), frame->checksum);
+    struct nconv_state st = {{&outs[0], &outs[1], 0, 0}, 0, 0, 0, 0};
+    (void) ctx;
+    unsigned long long used =
+        convert_block(&st, data + start, len - start, stop - start, 1);
+    *tally = st.rejected;
+    return start + used;
 }
 
-// message structure for NovAtel OEM7 BESTPOS, BESTGNSSPOS,
-// and RTKPOS logs; these logs have the same fields, but ascribe
-// different semantic meaning to them
-// https://docs.novatel.com/OEM7/Content/Logs/BESTPOS.htm
-// https://docs.novatel.com/OEM7/Content/SPAN_Logs/BESTGNSSPOS.htm
-// https://docs.novatel.com/OEM7/Content/Logs/RTKPOS.htm
-struct pos_t
+// the first log at or after pos in the mapped log ctx, and the time in
+// its header; --from bisects a log that has no index with this
+unsigned long long probe_log(void *ctx, unsigned long long pos,
+    unsigned long *ms)
 {
-    struct oem7_header_t header;
-    unsigned long sol_status, pos_type;
-    double latitude, longitude, altitude;
-    float undulation;
-    unsigned long datum_ID;
-    float lat_STD, lon_STD, alt_STD;
-    unsigned char station_ID[5];
-    float diff_age, sol_age;
-    unsigned char SVs, solnSVs, ggL1, solnMultiSVs,
-        reserved, ext_sol_stat, GB_mask, GG_mask;
-
-    unsigned long checksum;
-};
+    struct mapped_file *log = (struct mapped_file*) ctx;
+    pos = align_log(0, log->data, log->len, pos);
+    if (pos < log->len) *ms = log_ms(log->data + pos);
+    return pos;
+}
 
-// flag indicating different position log IDs;
-// used in tandem with pos_t
-enum pos_flag_t
+// flushes both text files and records how far the conversion got,
+// so that a restarted conversion can pick up from here
+void follow_checkpoint(void *ctx, unsigned long long offset)
 {
-    BESTPOS = 42,
-    BESTGNSSPOS = 1429,
-    RTKPOS = 141
-};
+    struct nconv_state *st = (struct nconv_state*) ctx;
+    outbuf_flush(st->out.inspva_out);
+    outbuf_flush(st->out.pos_out);
+
+    struct checkpoint cp = {offset, {0, 0}, 0};
+    cp.out_offset[0] = outbuf_tell(st->out.inspva_out);
+    cp.out_offset[1] = outbuf_tell(st->out.pos_out);
+    checkpoint_save(st->ckpt_fn, &cp);
+}
 
-// takes a NovAtel position log pointer and a pointer to the beginning
-// of a binary message; behavior is principally identical to
-// that of the above function
-// int payload2inspva(struct inspva*, unsigned char*)
-// except that the message must be identified with pos_flag_t
-int payload2pos(struct pos_t *frame, unsigned char *payload,
-                enum pos_flag_t ID)
+// opens a text output file for writing, either from scratch or, when
+// resuming a conversion, at its end; returns the descriptor or -1
+int open_output(const char *filename, int resume)
 {
-    if (!frame || !payload) return 1;
-
-    if ((payload[0] != 0xAA) || (payload[1] != 0x44) ||
-        (payload[2] != 0x12))
-    {
-        return 1; // sync bytes not present
-    }
-    frame->header.msg_ID = payload[4] | (payload[5] << 8);
-    if (frame->header.msg_ID != ID)
-    {
-        return 1; // log ID doesn't match ID provided
-    }
+    if (!resume) return open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
 
-    memcpy(frame->header.sync_bytes, payload, 3);
-    unsigned short N = (frame->header.header_len = payload[3]);
-    frame->header.msg_type = payload[6];
-    frame->header.port_addr = payload[7];
-    frame->header.msg_len = payload[8] | (payload[9] << 8);
-    frame->header.sequence = payload[10] | (payload[11] << 8);
-    frame->header.idle_time = payload[12];
-    frame->header.time_status = payload[13]; // enum
-    frame->header.week = payload[14] | (payload[15] << 8);
-    frame->header.ms = payload[16] | (payload[17] << 8) |
-                       (payload[18] << 16) | (payload[19] << 24);
-    frame->header.rcvr_stat = payload[20] | (payload[21] << 8) |
-                              (payload[22] << 16) | (payload[23] << 24);
-    frame->header.reserved = payload[24] | (payload[25] << 8);
-    frame->header.version = payload[26] | (payload[27] << 8);
-
-    frame->sol_status = payload[N+0] | (payload[N+1] << 8) |
-        (payload[N+2] << 16) | (payload[N+3] << 24);
-    frame->pos_type = payload[N+4] | (payload[N+5] << 8) |
-        (payload[N+6] << 16) | (payload[N+7] << 24);
-    memcpy(&frame->latitude, payload+N+8, 8);
-    memcpy(&frame->longitude, payload+N+16, 8);
-    memcpy(&frame->altitude, payload+N+24, 8);
-    memcpy(&frame->undulation, payload+N+32, 4);
-    frame->datum_ID = payload[N+36] | (payload[N+37] << 8) |
-        (payload[N+38] << 16) | (payload[N+39] << 24);
-    memcpy(&frame->lat_STD, payload+N+40, 4);
-    memcpy(&frame->lon_STD, payload+N+44, 4);
-    memcpy(&frame->alt_STD, payload+N+48, 4);
-    memcpy(frame->station_ID, payload+N+52, 4);
-    frame->station_ID[4] = 0;
-    memcpy(&frame->diff_age, payload+N+56, 4);
-    memcpy(&frame->sol_age, payload+N+60, 4);
-    frame->SVs = payload[N+64];
-    frame->solnSVs = payload[N+65];
-    frame->ggL1 = payload[N+66];
-    frame->solnMultiSVs = payload[N+67];
-    frame->reserved = payload[N+68];
-    frame->ext_sol_stat = payload[N+69];
-    frame->GB_mask = payload[N+70];
-    frame->GG_mask = payload[N+71];
-
-    frame->checksum = payload[N+72] | (payload[N+73] << 8) |
-        (payload[N+74] << 16) | (payload[N+75] << 24);
-    return 0;
+    int fd = open(filename, O_WRONLY);
+    if (fd != -1) lseek(fd, 0, SEEK_END);
+    return fd;
 }
 
-// imitates (imperfectly) the ASCII output produced by NovAtel Convert;
-// prints a line of the specified POS log onto the FILE* provided
-void println_pos(FILE *out, struct pos_t *frame,
-                 enum pos_flag_t ID)
+// prepares a columnar file for fd, with a scratch file next to it
+// for rows that outgrow memory; returns 0 on success
+int open_columnar(struct colfile *col, int fd, const char *filename,
+                  const struct col_desc *cols, unsigned ncols)
 {
-    if (!out || !frame) return;
-
-    char* title = "UNKNOWN";
-    switch (ID)
-    {
-        case BESTPOS: title = "BESTPOSA"; break;
-        case BESTGNSSPOS: title = "BESTGNSSPOSA"; break;
-        case RTKPOS: title = "RTKPOSA"; break;
-    }
-
-    fprintf(out, "#%s,"
-                 "%s," // port_addr - uchar
-                 // "%hhu," // msg_type - uchar
-                 // "%hu," // msg_len - ushort
-                 "%hu," // sequence - ushort
-                 "%.1f," // idle_time - float
-                 "%s," // time_status - string
-                 "%hu," // week - ushort
-                 "%.3f,%08lx,%hx,%hu",
-        title,
-        port_str(frame->header.port_addr),
-        // frame->header.msg_type,
-        // frame->header.msg_len,
-        frame->header.sequence,
-        frame->header.idle_time/2.0,
-        timestat_str(frame->header.time_status),
-        frame->header.week,
-        frame->header.ms/1000.0,
-        frame->header.rcvr_stat,
-        frame->header.reserved,
-        frame->header.version);
-    fprintf(out, ";");
-    fprintf(out, "%s,%s,"
-        "%.11f,%.11f,%.4f,%.4f,"
-        "%s,"
-        "%.4f,%.4f,%.4f,"
-        "\"%s\",%.3f,%.3f,"
-        "%hhu,%hhu,%hhu,%hhu,"
-        "%02hhx,"
-        "%02hhx,%02hhx,%02hhx"
-        "*%08lx"
-        "\n",
-        solstat_str(frame->sol_status),
-        postype_str(frame->pos_type),
-        frame->latitude, frame->longitude,
-        frame->altitude, frame->undulation,
-        datum_str(frame->datum_ID),
-        frame->lat_STD, frame->lon_STD, frame->alt_STD,
-        frame->station_ID, frame->diff_age, frame->sol_age,
-        frame->SVs, frame->solnSVs, frame->ggL1, frame->solnMultiSVs,
-        frame->reserved,
-        frame->ext_sol_stat, frame->GB_mask, frame->GG_mask,
-        frame->checksum
-        );
+    if (fd == -1) return 1;
+
+    char *scratch_fn = (char*) malloc(strlen(filename) + 6);
+    if (!scratch_fn) return 1;
+    strcpy(scratch_fn, filename);
+    strcat(scratch_fn, ".part");
+    int error = colfile_open(col, fd, scratch_fn, cols, ncols);
+    free(scratch_fn);
+    return error;
 }
 
 const char* argument_error =
@@ -493,8 +240,34 @@ const char* argument_error =
     "type '%s --usage' for more info\n";
 
 const char* usage_help =
-    "usage: %s infile\n"
-    "  infile: file to be converted to text\n";
+    "usage: %s infile [--format f] [-j n] [--from s] [--to s]\n"
+    "         [--decimate hz]\n"
+    "       %s infile --follow [--idle s]\n"
+    "       %s infile [--scan [--rate hz]] [--index]\n"
+    "  infile: file to be converted to text\n"
+    "  [--format f]: text (the default), or columnar for one binary\n"
+    "    array per field in .ins.col and .pos.col files;\n"
+    "    see src/colfile.h\n"
+    "  [-j, --jobs n]: convert text on n threads, or one per\n"
+    "    processor for 0; the output is the same as with 1\n"
+    "  [--from s] [--to s]: only convert the logs from and to\n"
+    "    these GPS seconds into the week, inclusive; the start is\n"
+    "    found with infile.idx if there is one. times are taken\n"
+    "    the short way around a week rollover from the log's\n"
+    "  [--decimate hz]: only convert the first log of each kind in\n"
+    "    each 1/hz seconds of GPS time\n"
+    "  [--follow]: keep converting data appended to infile until\n"
+    "    the writer closes it, resuming from the .ins.ckpt file\n"
+    "    if present\n"
+    "  [--idle s]: with --follow, stop after s seconds without new\n"
+    "    data; 0 finishes a resumed conversion without waiting\n"
+    "  [--scan]: check every log without converting any, and\n"
+    "    print a JSON summary of the INSPVA logs' timing and the\n"
+    "    log's integrity\n"
+    "  [--rate hz]: with --scan, the rate INSPVA was logged at, for\n"
+    "    counting dropped logs; 20 by default\n"
+    "  [--index]: check every log, and write infile.idx, an index\n"
+    "    of the log by INSPVA time; see src/timeidx.h\n";
 
 int main(int argc, char** argv)
 {
@@ -508,43 +281,216 @@ int main(int argc, char** argv)
     // help string to stderr
     if (strcmp(argv[1], "--usage") == 0)
     {
-        printf(usage_help, argv[0]);
+        printf(usage_help, argv[0], argv[0], argv[0]);
         return 0;
     }
 
-    // open the SPAN bin file; if can't open, return error
-    FILE *infile = fopen(argv[1], "rb");
-    if (!infile)
+    unsigned char follow_flag = 0;
+    unsigned char columnar_flag = 0;
+    unsigned char scan_flag = 0;
+    unsigned char index_flag = 0;
+    unsigned char from_flag = 0, to_flag = 0;
+    unsigned long from_ms = 0, to_ms = 0;
+    long idle_ms = -1;
+    unsigned jobs = 1;
+    double rate_hz = 20;
+    double decimate_hz = 0;
+
+    for (int i = 2; i < argc; ++i)
     {
-        fprintf(stderr, "%s: failed to open '%s'\n", argv[0], argv[1]);
+        if (!strcmp(argv[i], "--follow"))
+        {
+            follow_flag = 1;
+        }
+        else if (!strcmp(argv[i], "--scan"))
+        {
+            scan_flag = 1;
+        }
+        else if (!strcmp(argv[i], "--from") | !strcmp(argv[i], "--to"))
+        {
+            if (argc < i + 2)
+            {
+                fprintf(stderr, usage_help, argv[0], argv[0], argv[0]);
+                return 1;
+            }
+            int from = !strcmp(argv[i], "--from");
+            double tow = atof(argv[++i]);
+            if (!(tow >= 0 && tow < 604800))
+            {
+                fprintf(stderr, argument_error, argv[0], argv[i], argv[0]);
+                return 1;
+            }
+            if (from) from_flag = 1, from_ms = 1000*tow + 0.5;
+            else to_flag = 1, to_ms = 1000*tow + 0.5;
+        }
+        else if (!strcmp(argv[i], "--decimate"))
+        {
+            if (argc < i + 2)
+            {
+                fprintf(stderr, usage_help, argv[0], argv[0], argv[0]);
+                return 1;
+            }
+            decimate_hz = atof(argv[++i]);
+            if (!(decimate_hz > 0))
+            {
+                fprintf(stderr, argument_error, argv[0], argv[i], argv[0]);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--index"))
+        {
+            index_flag = 1;
+        }
+        else if (!strcmp(argv[i], "--rate"))
+        {
+            if (argc < i + 2)
+            {
+                fprintf(stderr, usage_help, argv[0], argv[0], argv[0]);
+                return 1;
+            }
+            rate_hz = atof(argv[++i]);
+            if (!(rate_hz > 0))
+            {
+                fprintf(stderr, argument_error, argv[0], argv[i], argv[0]);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--format"))
+        {
+            if (argc < i + 2)
+            {
+                fprintf(stderr, usage_help, argv[0], argv[0], argv[0]);
+                return 1;
+            }
+            ++i;
+            if (!strcmp(argv[i], "columnar")) columnar_flag = 1;
+            else if (strcmp(argv[i], "text"))
+            {
+                fprintf(stderr, argument_error, argv[0], argv[i], argv[0]);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--idle"))
+        {
+            if (argc < i + 2)
+            {
+                fprintf(stderr, usage_help, argv[0], argv[0], argv[0]);
+                return 1;
+            }
+            idle_ms = 1000*atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-j") | !strcmp(argv[i], "--jobs"))
+        {
+            if (argc < i + 2)
+            {
+                fprintf(stderr, usage_help, argv[0], argv[0], argv[0]);
+                return 1;
+            }
+            int n = atoi(argv[++i]);
+            if (n < 0)
+            {
+                fprintf(stderr, argument_error, argv[0], argv[i], argv[0]);
+                return 1;
+            }
+            jobs = n ? n : parconv_cpus();
+        }
+        else // if any argument is unexpected, throw argument error
+        {
+            fprintf(stderr, argument_error, argv[0], argv[i], argv[0]);
+            return 1;
+        }
+    }
+
+    // a scan reads the whole log at once and writes nothing else
+    if ((scan_flag || index_flag) && follow_flag)
+    {
+        fprintf(stderr, "%s: --scan and --index need a whole file\n",
+            argv[0]);
         return 1;
     }
 
-    // get length of input binary file
-    unsigned long long filelen;
-    fseek(infile, 0, SEEK_END);
-    filelen = ftell(infile);
-    fseek(infile, 0, SEEK_SET);
+    // a window is found by seeking in a whole file, and cuts off the
+    // rows of whatever chunk it ends in
+    if ((from_flag || to_flag) && (follow_flag || jobs > 1))
+    {
+        fprintf(stderr, "%s: --from and --to only convert a whole file "
+            "on one thread\n", argv[0]);
+        return 1;
+    }
 
-    // expecting at least one INSPVA/bestpos log, but this is arbitrary
-    if (filelen < 100)
+    // which log of a cell comes first depends on every log before it,
+    // which neither a chunk nor a resumed conversion has seen
+    if (decimate_hz && (follow_flag || jobs > 1))
     {
-        fprintf(stderr, "%s: %s is too short\n", argv[0], argv[1]);
+        fprintf(stderr, "%s: --decimate doesn't work with --follow or -j\n",
+            argv[0]);
         return 1;
     }
 
-    // read the binary file into unsigned char array
-    unsigned char *file_buffer = (unsigned char*) malloc(filelen);
-    if (!file_buffer)
+    // a columnar file can only be laid out once every row is known
+    if (follow_flag && columnar_flag)
     {
-        fprintf(stderr, "%s: memory allocation error\n", argv[0]);
+        fprintf(stderr, "%s: --follow only writes text\n", argv[0]);
+        return 1;
+    }
+
+    // chunks are converted out of order, and can only be split from a
+    // file that's all there; rows of columns are laid out in order
+    if (jobs > 1 && (follow_flag || columnar_flag))
+    {
+        fprintf(stderr, "%s: -j only converts a whole file to text\n",
+            argv[0]);
         return 1;
     }
-    fread(file_buffer, 1, filelen, infile);
-    fclose(infile);
+
+    // map the SPAN bin file; if can't open, return error. a followed
+    // file is still being written, so it's read as it grows instead
+    struct mapped_file infile = {0, 0, -1};
+    unsigned long long filelen = 0;
+    if (!follow_flag)
+    {
+        if (map_file(&infile, argv[1]))
+        {
+            fprintf(stderr, "%s: failed to open '%s'\n", argv[0], argv[1]);
+            return 1;
+        }
+
+        // get length of input binary file
+        filelen = infile.len;
+
+        // expecting at least one INSPVA/bestpos log, but this is arbitrary
+        if (filelen < 100)
+        {
+            fprintf(stderr, "%s: %s is too short\n", argv[0], argv[1]);
+            return 1;
+        }
+    }
+
+    // frames are decoded straight out of the mapping
+    unsigned char *file_buffer = infile.data;
+
+    if (scan_flag || index_flag)
+    {
+        struct scan_stats stats;
+        struct timeidx index;
+        struct nconv_state st =
+            {{0, 0, 0, 0}, 0, 0, &stats, index_flag ? &index : 0};
+        scan_init(&stats, filelen, rate_hz);
+        timeidx_init(&index, INSPVA_ID);
+        convert_block(&st, file_buffer, filelen, filelen, 1);
+        stats.bad_checksums = st.rejected;
+        if (scan_flag) scan_print(stdout, &stats, argv[1], "INSPVA");
+        unmap_file(&infile);
+        return index_flag && save_index(argv[0], &index, argv[1], filelen,
+            "logs");
+    }
+
+    const char *inspva_ext = columnar_flag ? ".ins.col" : ".ins";
+    const char *pos_ext = columnar_flag ? ".pos.col" : ".pos";
 
     // allocate and name INSPVA text file
-    char *inspva_fn = (char*) malloc(strlen(argv[1]) + 1);
+    char *inspva_fn =
+        (char*) malloc(strlen(argv[1]) + strlen(inspva_ext) + 1);
     if (!inspva_fn)
     {
         fprintf(stderr, "%s: memory allocation error\n", argv[0]);
@@ -555,30 +501,25 @@ int main(int argc, char** argv)
     if (!ext_ptr) // tack ".ins" on the end
     {
         free(inspva_fn);
-        inspva_fn = (char*) malloc(strlen(argv[1]) + 5);
+        inspva_fn =
+            (char*) malloc(strlen(argv[1]) + strlen(inspva_ext) + 1);
         if (!inspva_fn)
         {
             fprintf(stderr, "%s: memory allocation error\n", argv[0]);
             return 1;
         }
         strcpy(inspva_fn, argv[1]);
-        strcpy(inspva_fn + strlen(inspva_fn), ".ins");
+        strcpy(inspva_fn + strlen(inspva_fn), inspva_ext);
     }
     else // replace ".bin" with ".ins"
     {
-        strcpy(ext_ptr, ".ins");
+        strcpy(ext_ptr, inspva_ext);
     }
 
-    FILE *inspva_outfile = fopen(inspva_fn, "wb");
-    if (!inspva_outfile)
-    {
-        fprintf(stderr, "%s: failed to open '%s'\n",
-            argv[0], inspva_fn);
-        return 1;
-    }
 
     // allocate and name bestpos text file
-    char *bestpos_fn = (char*) malloc(strlen(argv[1]) + 1);
+    char *bestpos_fn =
+        (char*) malloc(strlen(argv[1]) + strlen(pos_ext) + 1);
     if (!bestpos_fn)
     {
         fprintf(stderr, "%s: memory allocation error\n", argv[0]);
@@ -589,91 +530,175 @@ int main(int argc, char** argv)
     if (!ext_ptr) // tack ".pos" on the end
     {
         free(bestpos_fn);
-        bestpos_fn = (char*) malloc(strlen(argv[1]) + 5);
+        bestpos_fn =
+            (char*) malloc(strlen(argv[1]) + strlen(pos_ext) + 1);
         if (!bestpos_fn)
         {
             fprintf(stderr, "%s: memory allocation error\n", argv[0]);
             return 1;
         }
         strcpy(bestpos_fn, argv[1]);
-        strcpy(bestpos_fn + strlen(bestpos_fn), ".pos");
+        strcpy(bestpos_fn + strlen(bestpos_fn), pos_ext);
     }
     else // replace ".bin" with ".pos"
     {
-        strcpy(ext_ptr, ".pos");
+        strcpy(ext_ptr, pos_ext);
     }
 
-    FILE *pos_outfile = fopen(bestpos_fn, "wb");
-    if (!pos_outfile)
+    char *ckpt_fn = (char*) malloc(strlen(inspva_fn) + 6);
+    if (!ckpt_fn)
+    {
+        fprintf(stderr, "%s: memory allocation error\n", argv[0]);
+        return 1;
+    }
+    strcpy(ckpt_fn, inspva_fn);
+    strcat(ckpt_fn, ".ckpt");
+
+    // a followed conversion resumes only if both text files still hold
+    // everything the checkpoint says was written; anything written
+    // after the checkpoint is discarded and converted again
+    struct checkpoint cp;
+    struct stat inspva_stat, pos_stat;
+    unsigned long long offset = 0;
+    int resume = 0;
+    if (follow_flag && checkpoint_load(ckpt_fn, &cp) == 0 &&
+        stat(inspva_fn, &inspva_stat) == 0 &&
+        stat(bestpos_fn, &pos_stat) == 0 &&
+        (unsigned long long) inspva_stat.st_size >= cp.out_offset[0] &&
+        (unsigned long long) pos_stat.st_size >= cp.out_offset[1] &&
+        truncate(inspva_fn, cp.out_offset[0]) == 0 &&
+        truncate(bestpos_fn, cp.out_offset[1]) == 0)
+    {
+        offset = cp.in_offset;
+        resume = 1;
+        fprintf(stderr, "%s: resuming '%s' at 0x%02llx\n",
+            argv[0], argv[1], offset);
+    }
+
+    // text files go through double-buffered writer threads; columnar
+    // files are assembled when they're closed
+    struct outbuf inspva_out, pos_out;
+    struct colfile inspva_col, pos_col;
+    struct nconv_state st = {{0, 0, 0, 0}, ckpt_fn, 0, 0, 0};
+    int inspva_fd = open_output(inspva_fn, resume);
+    if (columnar_flag ? open_columnar(&inspva_col, inspva_fd, inspva_fn,
+                            inspva_cols, inspva_ncols) :
+        (inspva_fd == -1 ||
+         outbuf_open(&inspva_out, inspva_fd, OUTBUF_DEFAULT_CAP)))
+    {
+        fprintf(stderr, "%s: failed to open '%s'\n",
+            argv[0], inspva_fn);
+        return 1;
+    }
+
+    int pos_fd = open_output(bestpos_fn, resume);
+    if (columnar_flag ? open_columnar(&pos_col, pos_fd, bestpos_fn,
+                            pos_cols, pos_ncols) :
+        (pos_fd == -1 || outbuf_open(&pos_out, pos_fd, OUTBUF_DEFAULT_CAP)))
     {
         fprintf(stderr, "%s: failed to open '%s'\n",
             argv[0], bestpos_fn);
         return 1;
     }
 
-    // find first aa 44 12 sequence
-    unsigned long long rptr = 0;
-    for (int i = 0; rptr == 0 && i < filelen - 4; ++i)
+    if (columnar_flag)
     {
-        if ((file_buffer[i]) == 0xAA && (file_buffer[i+1]) == 0x44 &&
-            (file_buffer[i+2] == 0x12))
+        st.out.inspva_col = &inspva_col;
+        st.out.pos_col = &pos_col;
+    }
+    else
+    {
+        st.out.inspva_out = &inspva_out;
+        st.out.pos_out = &pos_out;
+    }
+
+    if (follow_flag)
+    {
+        if (follow_file(argv[1], offset, idle_ms,
+            follow_decode, follow_checkpoint, &st))
         {
-            rptr = i;
+            fprintf(stderr, "%s: failed to follow '%s'\n",
+                argv[0], argv[1]);
+            return 1;
         }
+        fprintf(stderr, "%s: Writing... Done.\n", argv[0]);
+        fprintf(stderr, "%s: rejected %llu logs failing the CRC check\n",
+            argv[0], st.rejected);
+        free(ckpt_fn);
+        return close_output(argv[0], &inspva_out, inspva_fd) |
+               close_output(argv[0], &pos_out, pos_fd);
     }
-    if (rptr == 0)
+
+    // find the first aa 44 12 sequence, which may be at the very start
+    unsigned long long rptr = sync_scan(file_buffer, filelen, oem7_sync, 3);
+    if (rptr + 3 > filelen)
     {
         fprintf(stderr, "%s: '%s' does not contain any "
             "NovAtel OEM7 packets\n", argv[0], argv[1]);
         return 1;
     }
 
-    // iterate through the file, looking for sync bytes
-    while (rptr < filelen)
+    st.from_flag = from_flag;
+    st.from_ms = from_ms;
+    st.to_flag = to_flag;
+    st.to_ms = to_ms;
+    struct decim_grids grids;
+    decim_grids_init(&grids, decimate_hz);
+    if (decimate_hz) st.grids = &grids;
+    if (from_flag)
     {
-        // taking advantage of the fact that payload2____ functions
-        // return 1 when passed a pointer that does not point to
-        // NovAtel sync bytes, just pass rptr to payload2____
-        // and increment until it returns 0
-
-        struct inspva_t INSPVA;
-        struct pos_t POS;
-        if (payload2inspva(&INSPVA, file_buffer + rptr) == 0)
-        {
-            println_inspva(inspva_outfile, &INSPVA);
-            rptr += 120; // skip length of INSPVA
-        }
-        else if (payload2pos(&POS, file_buffer + rptr,
-            BESTPOS) == 0)
-        {
-            println_pos(pos_outfile, &POS, BESTPOS);
-            rptr += 104; // skip length of POS log
-        }
-        else if (payload2pos(&POS, file_buffer + rptr,
-            BESTGNSSPOS) == 0)
-        {
-            println_pos(pos_outfile, &POS, BESTGNSSPOS);
-            rptr += 104; // skip length of POS log
-        }
-        else if (payload2pos(&POS, file_buffer + rptr,
-            RTKPOS) == 0)
-        {
-            println_pos(pos_outfile, &POS, RTKPOS);
-            rptr += 104; // skip length of POS log
-        }
-        else ++rptr; // not on a sync byte, check the next address
+        // skip straight to the window, with the log's index if it has a
+        // usable one and by bisecting the log if not
+        struct timeidx index;
+        char *idx_fn = timeidx_filename(argv[1]);
+        int indexed = idx_fn &&
+            !timeidx_load(&index, idx_fn, INSPVA_ID, filelen);
+        rptr = timeidx_seek(indexed ? &index : 0, probe_log, &infile,
+            rptr, filelen, from_ms);
+        if (indexed) timeidx_free(&index);
+        free(idx_fn);
+    }
 
-        static unsigned char progress, old_progress = 255;
-        progress = 100*rptr/filelen;
-        if (progress != old_progress)
+    // iterate through the file, looking for sync bytes; the file is
+    // handed to convert_block a slice at a time to report progress, or
+    // with -j, split between threads
+    const unsigned long long slice_len = 1024*1024;
+    struct progress progress;
+    progress_init(&progress, argv[0], 0, filelen);
+    if (jobs > 1)
+    {
+        struct outbuf *outs[2] = {&inspva_out, &pos_out};
+        if (parconv_run(file_buffer, filelen, rptr, jobs, align_log,
+            decode_chunk, &progress, 0, outs, 2, &st.rejected))
         {
-            old_progress = progress;
-            fprintf(stderr, "\r%s: Writing... %2hhu%%",
-                argv[0], progress);
+            fprintf(stderr, "\n%s: memory allocation error\n", argv[0]);
+            return 1;
         }
+        rptr = filelen;
+    }
+    while (rptr < filelen)
+    {
+        unsigned long long len = filelen - rptr;
+        unsigned long long stop = len > slice_len ? slice_len : len;
+        unsigned long long used =
+            convert_block(&st, file_buffer + rptr, len, stop, 1);
+        if (st.past_window) break;
+
+        // only the last few bytes of the file, too short to hold a
+        // log, end a slice early
+        if (used < stop) used = len;
+        rptr += used;
+        progress_update(&progress, rptr);
+    }
+    progress_done(&progress);
+    fprintf(stderr, "%s: rejected %llu logs failing the CRC check\n",
+        argv[0], st.rejected);
+    unmap_file(&infile);
+    if (columnar_flag)
+    {
+        return close_columnar(argv[0], &inspva_col, inspva_fd) |
+               close_columnar(argv[0], &pos_col, pos_fd);
     }
-    fprintf(stderr, "\r%s: Writing... Done.\n", argv[0]);
-    fclose(inspva_outfile);
-    fclose(pos_outfile);
-    return 0;
+    return close_output(argv[0], &inspva_out, inspva_fd) |
+           close_output(argv[0], &pos_out, pos_fd);
 }
@@ -0,0 +1,705 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "oem7msg.h"
+#include "fmtnum.h"
+#include "crc32.h"
+
+// the *_str functions below name a field's value, falling back to its
+// decimal digits, written into a caller's buffer of NUMSTR_LEN bytes,
+// for a value they don't know. that's large enough for any unsigned
+// long; a corrupted enum field that was sign-extended from 32 bits
+// prints as 20 digits.
+#define NUMSTR_LEN 21
+
+static char* num2str(unsigned long num, char *numstr)
+{
+    sprintf(numstr, "%lu", num);
+    return numstr;
+}
+
+// encoding for the NovAtel OEM7 COM port ID table;
+// does not contain all COM port mappings
+// https://docs.novatel.com/OEM7/Content/Messages/Binary.htm
+static const char* port_str(unsigned long port_id, char *numstr)
+{
+    // there are literally 11,456 cases
+    // for this enumeration, so I'm not going
+    // to try to include all of them; just
+    // the most common ones
+
+    switch (port_id)
+    {
+        case 0: return "NO_PORTS";
+        case 1: return "COM1_ALL";
+        case 2: return "COM2_ALL";
+        case 3: return "COM3_ALL";
+        case 6: return "THISPORT_ALL";
+        case 7: return "FILE_ALL";
+        case 8: return "ALL_PORTS";
+        case 9: return "XCOM1_ALL";
+        case 10: return "XCOM2_ALL";
+        case 13: return "USB1_ALL";
+        case 14: return "USB2_ALL";
+        case 15: return "USB3_ALL";
+        case 16: return "AUX_ALL";
+        case 17: return "XCOM3_ALL";
+        case 19: return "COM4_ALL";
+        case 20: return "ETH1_ALL";
+        case 21: return "IMU_ALL";
+        case 23: return "ICOM1_ALL";
+        case 24: return "ICOM2_ALL";
+        case 25: return "ICOM3_ALL";
+        case 26: return "NCOM1_ALL";
+        case 27: return "NCOM2_ALL";
+        case 28: return "NCOM3_ALL";
+        case 29: return "ICOM4_ALL";
+        case 30: return "WCOM4_ALL";
+        case 32: return "COM1";
+        case 33: return "COM1_1";
+        // ...
+        case 63: return "COM1_31";
+        case 64: return "COM2";
+        case 65: return "COM2_1";
+        // ...
+        case 95: return "COM2_31";
+        case 96: return "COM3";
+        case 97: return "COM3_1";
+        // ...
+        case 127: return "COM3_31";
+        case 160: return "SPECIAL";
+        case 161: return "SPECIAL_1";
+        // ...
+        case 191: return "SPECIAL_31";
+        case 192: return "THISPORT";
+        case 193: return "THISPORT_1";
+        // ...
+        case 223: return "THISPORT_31";
+        case 225: return "FILE";
+        case 226: return "FILE_1";
+        case 255: return "FILE_31";
+    }
+    return num2str(port_id, numstr);
+}
+
+// encoding for NovAtel OEM7 INS solution status
+// https://docs.novatel.com/OEM7/Content/SPAN_Logs/INSATT.htm#InertialSolutionStatus
+static const char* insstat_str(unsigned long ins_status, char *numstr)
+{
+    switch (ins_status)
+    {
+        case 0: return "INS_INACTIVE";
+        case 1: return "INS_ALIGNING";
+        case 2: return "INS_HIGH_VARIANCE";
+        case 3: return "INS_SOLUTION_GOOD";
+        case 6: return "INS_SOLUTION_FREE";
+        case 7: return "INS_ALIGNMENT_COMPLETE";
+        case 8: return "DETERMINING_ORIENTATION";
+        case 9: return "WAITING_INITIALPOS";
+        case 10: return "WAITING_AZIMUTH";
+        case 11: return "INITIALIZING_BIASES";
+        case 12: return "MOTION_DETECT";
+    }
+    return num2str(ins_status, numstr);
+}
+
+
+// encoding for NovAtel OEM7 receiver fix status
+// https://docs.novatel.com/OEM7/Content/Logs/BESTPOS.htm#SolutionStatus
+static const char* solstat_str(unsigned long sol_status, char *numstr)
+{
+    switch (sol_status)
+    {
+        case 0: return "SOL_COMPUTED";
+        case 1: return "INSUFFICIENT_OBS";
+        case 2: return "NO_CONVERGENCE";
+        case 3: return "SINGULARIY";
+        case 4: return "COV_TRACE";
+        case 5: return "TEST_DIST";
+        case 6: return "COLD_START";
+        case 7: return "V_H_LIMIT";
+        case 8: return "VARIANCE";
+        case 9: return "RESIDUALS";
+        case 13: return "INTEGRITY_WARNING";
+        case 18: return "PENDING";
+        case 19: return "INVALID_FIX";
+        case 20: return "UNAUTHORIZED";
+        case 22: return "INVALID_RATE";
+    }
+    return num2str(sol_status, numstr);
+}
+
+// encoding for NovAtel OEM7 receiver position type
+// https://docs.novatel.com/OEM7/Content/Logs/BESTPOS.htm#Position_VelocityType
+static const char* postype_str(unsigned long pos_type, char *numstr)
+{
+    switch (pos_type)
+    {
+        case 0: return "NONE";
+        case 1: return "FIXEDPOS";
+        case 2: return "FIXEDHEIGHT";
+        case 4: return "FLOATCONV";
+        case 5: return "WIDELANE";
+        case 6: return "NARROWLANE";
+        case 8: return "DOPPLER_VELOCITY";
+        case 16: return "SINGLE";
+        case 17: return "PSRDIFF";
+        case 18: return "WAAS";
+        case 19: return "PROPAGATED";
+        case 32: return "L1_FLOAT";
+        case 33: return "IONOFREE_FLOAT";
+        case 34: return "NARROW_FLOAT";
+        case 48: return "L1_INT";
+        case 49: return "WIDE_INT";
+        case 50: return "NARROW_INT";
+        case 51: return "RTK_DIRECT_INS";
+        case 52: return "INS_SBAS";
+        case 53: return "INS_PSRSP";
+        case 54: return "INS_PSRDIFF";
+        case 55: return "INS_RTKFLOAT";
+        case 56: return "INS_RTKFIXED";
+        case 68: return "PPP_CONVERGING";
+        case 69: return "PPP";
+        case 70: return "OPERATIONAL";
+        case 71: return "WARNING";
+        case 72: return "OUT_OF_BOUNDS";
+        case 73: return "INS_PPP_CONVERGING";
+        case 74: return "INS_PPP";
+        case 77: return "PPP_BASIC_CONVERGING";
+        case 78: return "PPP_BASIC";
+        case 79: return "INS_PPP_BASIC";
+        case 80: return "INS_PPP_BASIC_CONVERGING";
+    }
+    return num2str(pos_type, numstr);
+}
+
+// encoding for NovAtel OEM7 GPS reference time status
+// https://docs.novatel.com/OEM7/Content/Messages/GPS_Reference_Time_Statu.htm
+static const char* timestat_str(unsigned char time_status, char *numstr)
+{
+    switch (time_status)
+    {
+        case 20: return "UNKNOWN";
+        case 60: return "APPROXIMATE";
+        case 80: return "COARSEADJUSTING";
+        case 100: return "COARSE";
+        case 120: return "COARSESTEERING";
+        case 130: return "FREEWHEELING";
+        case 150: return "FINEADJUSTING";
+        case 160: return "FINE";
+        case 170: return "FINEBACKUPSTEERING";
+        case 180: return "FINESTEERING";
+        case 200: return "SATTIME";
+    }
+    return num2str(time_status, numstr);
+}
+
+// encoding for NovAtel OEM7 datum ID
+// https://docs.novatel.com/OEM7/Content/Commands/DATUM.htm
+static const char* datum_str(unsigned char datum_ID, char *numstr)
+{
+    switch (datum_ID)
+    {
+        case 60: return "WGS72";
+        case 61: return "WGS84";
+    }
+    return num2str(datum_ID, numstr);
+}
+
+// takes a pointer to a inspva_t struct, and a pointer to an unsigned
+// char array. the unsigned char pointer MUST point to the first
+// sync byte of any NovAtel message, i.e. 0xAA. the sync bytes defined
+// by NovAtel OEM7 are 0xAA, 0x44, 0x12. if the payload pointer does
+// not point at the sync bytes of an INSPVA binary message, the
+// function will return an error code and the resulting inspva_t is
+// invalid. upon success, the function will return 0.
+int payload2inspva(struct inspva_t *frame, unsigned char *payload)
+{
+    if (!frame || !payload) return 1;
+
+    if ((payload[0] != 0xAA) || (payload[1] != 0x44) ||
+        (payload[2] != 0x12) ||
+        (payload[4] != 0xFB) || (payload[5] != 0x01))
+    {
+        // this isn't the start of a SPAN INSPVA packet
+        return 1;
+    }
+
+    memcpy(frame->header.sync_bytes, payload, 3);
+    unsigned short N = (frame->header.header_len = payload[3]);
+    frame->header.msg_ID = payload[4] | (payload[5] << 8);
+    frame->header.msg_type = payload[6];
+    frame->header.port_addr = payload[7];
+    frame->header.msg_len = payload[8] | (payload[9] << 8);
+    frame->header.sequence = payload[10] | (payload[11] << 8);
+    frame->header.idle_time = payload[12];
+    frame->header.time_status = payload[13]; // enum
+    frame->header.week = payload[14] | (payload[15] << 8);
+    frame->header.ms = payload[16] | (payload[17] << 8) |
+                       (payload[18] << 16) | (payload[19] << 24);
+    frame->header.rcvr_stat = payload[20] | (payload[21] << 8) |
+                              (payload[22] << 16) | (payload[23] << 24);
+    frame->header.reserved = payload[24] | (payload[25] << 8);
+    frame->header.version = payload[26] | (payload[27] << 8);
+
+    frame->week = payload[N] | (payload[N+1] << 8) |
+                  (payload[N+2] << 16) | (payload[N+3] << 24);
+    memcpy(&frame->seconds, payload+N+4, 8);
+
+    memcpy(&frame->latitude, payload+N+12, 8);
+    memcpy(&frame->longitude, payload+N+20, 8);
+    memcpy(&frame->altitude, payload+N+28, 8);
+
+    memcpy(&frame->v_north, payload+N+36, 8);
+    memcpy(&frame->v_east, payload+N+44, 8);
+    memcpy(&frame->v_up, payload+N+52, 8);
+
+    memcpy(&frame->roll, payload+N+60, 8);
+    memcpy(&frame->pitch, payload+N+68, 8);
+    memcpy(&frame->azimuth, payload+N+76, 8);
+
+    frame->status = payload[N+84] | (payload[N+85] << 8) |
+                    (payload[N+86] << 16) | (payload[N+87] << 24);
+    frame->checksum = payload[N+88] | (payload[N+89] << 8) |
+                      (payload[N+90] << 16) | (payload[N+91] << 24);
+    return 0;
+}
+
+// prints the ASCII header of a log named title, up to and including
+// the ';' separating it from the log's fields. the header fields are
+// all scaled integers, so their text is produced directly rather than
+// through printf; see fmtnum.h. the "%08lx" receiver status, "%hx"
+// reserved and "%hu" version fields are reproduced as they were.
+static void print_oem7_header(struct outbuf *out, const char *title,
+                              struct oem7_header_t *header)
+{
+    // name strings are short; a decimal fallback is at most 10 digits
+    char numstr[NUMSTR_LEN];
+    char *line = outbuf_reserve(out, 256);
+    if (!line) return;
+    char *p = line;
+    *p++ = '#';
+    p = fmt_str(p, title);
+    *p++ = ',';
+    p = fmt_str(p, port_str(header->port_addr, numstr));
+    *p++ = ',';
+    p = fmt_uint(p, 0, header->sequence);
+    *p++ = ',';
+    p = fmt_fixed(p, 0, header->idle_time*5LL, 1); // idle_time/2.0
+    *p++ = ',';
+    p = fmt_str(p, timestat_str(header->time_status, numstr));
+    *p++ = ',';
+    p = fmt_uint(p, 0, header->week);
+    *p++ = ',';
+    p = fmt_fixed(p, 0, header->ms, 3);
+    *p++ = ',';
+    p = fmt_hex(p, 8, header->rcvr_stat);
+    *p++ = ',';
+    p = fmt_hex(p, 0, header->reserved);
+    *p++ = ',';
+    p = fmt_uint(p, 0, header->version);
+    *p++ = ';';
+    outbuf_commit(out, p - line);
+}
+
+// imitates (imperfectly) the ASCII output produced by NovAtel Convert;
+// prints a single line of INSPVAA onto the outbuf provided.
+void println_inspva(struct outbuf *out, struct inspva_t *frame)
+{
+    if (!out || !frame) return;
+
+    char numstr[NUMSTR_LEN];
+    print_oem7_header(out, "INSPVAA", &frame->header);
+    outbuf_printf(out, "%lu,%.9f,%.11f,%.11f,%.4f,"
+                 "%.4f,%.4f,%.4f,%.9f,%.9f,%.9f,%s*%08lx\n",
+        frame->week, frame->seconds,
+        frame->latitude, frame->longitude, frame->altitude,
+        frame->v_north, frame->v_east, frame->v_up,
+        frame->roll, frame->pitch, frame->azimuth,
+        insstat_str(frame->status, numstr), frame->checksum);
+}
+
+// takes a NovAtel position log pointer and a pointer to the beginning
+// of a binary message; behavior is principally identical to
+// that of the above function
+// int payload2inspva(struct inspva*, unsigned char*)
+// except that the message must be identified with pos_flag_t
+int payload2pos(struct pos_t *frame, unsigned char *payload,
+                enum pos_flag_t ID)
+{
+    if (!frame || !payload) return 1;
+
+    if ((payload[0] != 0xAA) || (payload[1] != 0x44) ||
+        (payload[2] != 0x12))
+    {
+        return 1; // sync bytes not present
+    }
+    frame->header.msg_ID = payload[4] | (payload[5] << 8);
+    if (frame->header.msg_ID != ID)
+    {
+        return 1; // log ID doesn't match ID provided
+    }
+
+    memcpy(frame->header.sync_bytes, payload, 3);
+    unsigned short N = (frame->header.header_len = payload[3]);
+    frame->header.msg_type = payload[6];
+    frame->header.port_addr = payload[7];
+    frame->header.msg_len = payload[8] | (payload[9] << 8);
+    frame->header.sequence = payload[10] | (payload[11] << 8);
+    frame->header.idle_time = payload[12];
+    frame->header.time_status = payload[13]; // enum
+    frame->header.week = payload[14] | (payload[15] << 8);
+    frame->header.ms = payload[16] | (payload[17] << 8) |
+                       (payload[18] << 16) | (payload[19] << 24);
+    frame->header.rcvr_stat = payload[20] | (payload[21] << 8) |
+                              (payload[22] << 16) | (payload[23] << 24);
+    frame->header.reserved = payload[24] | (payload[25] << 8);
+    frame->header.version = payload[26] | (payload[27] << 8);
+
+    frame->sol_status = payload[N+0] | (payload[N+1] << 8) |
+        (payload[N+2] << 16) | (payload[N+3] << 24);
+    frame->pos_type = payload[N+4] | (payload[N+5] << 8) |
+        (payload[N+6] << 16) | (payload[N+7] << 24);
+    memcpy(&frame->latitude, payload+N+8, 8);
+    memcpy(&frame->longitude, payload+N+16, 8);
+    memcpy(&frame->altitude, payload+N+24, 8);
+    memcpy(&frame->undulation, payload+N+32, 4);
+    frame->datum_ID = payload[N+36] | (payload[N+37] << 8) |
+        (payload[N+38] << 16) | (payload[N+39] << 24);
+    memcpy(&frame->lat_STD, payload+N+40, 4);
+    memcpy(&frame->lon_STD, payload+N+44, 4);
+    memcpy(&frame->alt_STD, payload+N+48, 4);
+    memcpy(frame->station_ID, payload+N+52, 4);
+    frame->station_ID[4] = 0;
+    memcpy(&frame->diff_age, payload+N+56, 4);
+    memcpy(&frame->sol_age, payload+N+60, 4);
+    frame->SVs = payload[N+64];
+    frame->solnSVs = payload[N+65];
+    frame->ggL1 = payload[N+66];
+    frame->solnMultiSVs = payload[N+67];
+    frame->reserved = payload[N+68];
+    frame->ext_sol_stat = payload[N+69];
+    frame->GB_mask = payload[N+70];
+    frame->GG_mask = payload[N+71];
+
+    frame->checksum = payload[N+72] | (payload[N+73] << 8) |
+        (payload[N+74] << 16) | (payload[N+75] << 24);
+    return 0;
+}
+
+// imitates (imperfectly) the ASCII output produced by NovAtel Convert;
+// prints a line of the specified POS log onto the outbuf provided
+void println_pos(struct outbuf *out, struct pos_t *frame,
+                 enum pos_flag_t ID)
+{
+    if (!out || !frame) return;
+
+    const char* title = "UNKNOWN";
+    switch (ID)
+    {
+        case BESTPOS: title = "BESTPOSA"; break;
+        case BESTGNSSPOS: title = "BESTGNSSPOSA"; break;
+        case RTKPOS: title = "RTKPOSA"; break;
+    }
+
+    // each name that falls back to digits needs a buffer of its own
+    char numstr[3][NUMSTR_LEN];
+    print_oem7_header(out, title, &frame->header);
+    outbuf_printf(out, "%s,%s,"
+        "%.11f,%.11f,%.4f,%.4f,"
+        "%s,"
+        "%.4f,%.4f,%.4f,"
+        "\"%s\",%.3f,%.3f,"
+        "%hhu,%hhu,%hhu,%hhu,"
+        "%02hhx,"
+        "%02hhx,%02hhx,%02hhx"
+        "*%08lx"
+        "\n",
+        solstat_str(frame->sol_status, numstr[0]),
+        postype_str(frame->pos_type, numstr[1]),
+        frame->latitude, frame->longitude,
+        frame->altitude, frame->undulation,
+        datum_str(frame->datum_ID, numstr[2]),
+        frame->lat_STD, frame->lon_STD, frame->alt_STD,
+        frame->station_ID, frame->diff_age, frame->sol_age,
+        frame->SVs, frame->solnSVs, frame->ggL1, frame->solnMultiSVs,
+        frame->reserved,
+        frame->ext_sol_stat, frame->GB_mask, frame->GG_mask,
+        frame->checksum
+        );
+}
+
+// columns written by --format columnar. the OEM7 header fields are
+// stored as integers with the scale the text output applies to them;
+// the log fields are the doubles and floats of the binary log
+const struct col_desc inspva_cols[] =
+{
+    {"port", COL_U8, 1}, {"sequence", COL_U16, 1},
+    {"idle_time", COL_U8, 0.5}, {"time_status", COL_U8, 1},
+    {"week", COL_U16, 1}, {"seconds", COL_U32, 1E-3},
+    {"receiver_status", COL_U32, 1},
+    {"ins_week", COL_U32, 1}, {"ins_seconds", COL_F64, 1},
+    {"latitude", COL_F64, 1}, {"longitude", COL_F64, 1},
+    {"height", COL_F64, 1},
+    {"north_velocity", COL_F64, 1}, {"east_velocity", COL_F64, 1},
+    {"up_velocity", COL_F64, 1},
+    {"roll", COL_F64, 1}, {"pitch", COL_F64, 1},
+    {"azimuth", COL_F64, 1},
+    {"status", COL_U32, 1}
+};
+const unsigned inspva_ncols = sizeof(inspva_cols)/sizeof(inspva_cols[0]);
+
+// BESTPOS, BESTGNSSPOS and RTKPOS share a file, so each row records
+// which log it came from; the station ID string is left out
+const struct col_desc pos_cols[] =
+{
+    {"port", COL_U8, 1}, {"sequence", COL_U16, 1},
+    {"idle_time", COL_U8, 0.5}, {"time_status", COL_U8, 1},
+    {"week", COL_U16, 1}, {"seconds", COL_U32, 1E-3},
+    {"receiver_status", COL_U32, 1},
+    {"log_id", COL_U16, 1},
+    {"sol_status", COL_U32, 1}, {"pos_type", COL_U32, 1},
+    {"latitude", COL_F64, 1}, {"longitude", COL_F64, 1},
+    {"height", COL_F64, 1}, {"undulation", COL_F32, 1},
+    {"datum_id", COL_U32, 1},
+    {"latitude_std", COL_F32, 1}, {"longitude_std", COL_F32, 1},
+    {"height_std", COL_F32, 1},
+    {"diff_age", COL_F32, 1}, {"sol_age", COL_F32, 1},
+    {"svs", COL_U8, 1}, {"soln_svs", COL_U8, 1},
+    {"soln_l1_svs", COL_U8, 1}, {"soln_multi_svs", COL_U8, 1},
+    {"ext_sol_stat", COL_U8, 1}, {"galileo_beidou_mask", COL_U8, 1},
+    {"gps_glonass_mask", COL_U8, 1}
+};
+const unsigned pos_ncols = sizeof(pos_cols)/sizeof(pos_cols[0]);
+
+// appends the header columns shared by inspva_cols and pos_cols
+static void colrow_oem7_header(struct colfile *col,
+                               struct oem7_header_t *header)
+{
+    colfile_put_int(col, header->port_addr);
+    colfile_put_int(col, header->sequence);
+    colfile_put_int(col, header->idle_time);
+    colfile_put_int(col, header->time_status);
+    colfile_put_int(col, header->week);
+    colfile_put_int(col, header->ms);
+    colfile_put_int(col, header->rcvr_stat);
+}
+
+// appends one INSPVA log as a row of inspva_cols
+void colrow_inspva(struct colfile *col, struct inspva_t *frame)
+{
+    colrow_oem7_header(col, &frame->header);
+    colfile_put_int(col, frame->week);
+    colfile_put_real(col, frame->seconds);
+    colfile_put_real(col, frame->latitude);
+    colfile_put_real(col, frame->longitude);
+    colfile_put_real(col, frame->altitude);
+    colfile_put_real(col, frame->v_north);
+    colfile_put_real(col, frame->v_east);
+    colfile_put_real(col, frame->v_up);
+    colfile_put_real(col, frame->roll);
+    colfile_put_real(col, frame->pitch);
+    colfile_put_real(col, frame->azimuth);
+    colfile_put_int(col, frame->status);
+    colfile_end_row(col);
+}
+
+// appends one position log as a row of pos_cols
+void colrow_pos(struct colfile *col, struct pos_t *frame, enum pos_flag_t ID)
+{
+    colrow_oem7_header(col, &frame->header);
+    colfile_put_int(col, ID);
+    colfile_put_int(col, frame->sol_status);
+    colfile_put_int(col, frame->pos_type);
+    colfile_put_real(col, frame->latitude);
+    colfile_put_real(col, frame->longitude);
+    colfile_put_real(col, frame->altitude);
+    colfile_put_real(col, frame->undulation);
+    colfile_put_int(col, frame->datum_ID);
+    colfile_put_real(col, frame->lat_STD);
+    colfile_put_real(col, frame->lon_STD);
+    colfile_put_real(col, frame->alt_STD);
+    colfile_put_real(col, frame->diff_age);
+    colfile_put_real(col, frame->sol_age);
+    colfile_put_int(col, frame->SVs);
+    colfile_put_int(col, frame->solnSVs);
+    colfile_put_int(col, frame->ggL1);
+    colfile_put_int(col, frame->solnMultiSVs);
+    colfile_put_int(col, frame->ext_sol_stat);
+    colfile_put_int(col, frame->GB_mask);
+    colfile_put_int(col, frame->GG_mask);
+    colfile_end_row(col);
+}
+
+unsigned long oem7_log_len(const unsigned char *buf)
+{
+    unsigned long header_len = buf[3];
+    unsigned long msg_len = buf[8] | (buf[9] << 8);
+    unsigned long loglen = header_len + msg_len + 4;
+    if (header_len < OEM7_MIN_HEADER_LEN || loglen > OEM7_MAX_LOG_LEN)
+        return 0;
+    return loglen;
+}
+
+int oem7_crc_ok(const unsigned char *log, unsigned long len)
+{
+    uint32_t crc = log[len-4] | (log[len-3] << 8) |
+        (log[len-2] << 16) | ((uint32_t) log[len-1] << 24);
+    return crc32_update(0, log, len - 4) == crc;
+}
+
+// little-endian stores for the encoders
+static void put_u16(unsigned char *p, unsigned long value)
+{
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+}
+
+static void put_u32(unsigned char *p, unsigned long value)
+{
+    put_u16(p, value & 0xFFFF);
+    put_u16(p + 2, value >> 16);
+}
+
+// writes header as the 28 byte binary header of a log with the given
+// ID and message length
+static void put_oem7_header(const struct oem7_header_t *header,
+    unsigned char *payload, unsigned short msg_ID, unsigned short msg_len)
+{
+    payload[0] = 0xAA;
+    payload[1] = 0x44;
+    payload[2] = 0x12;
+    payload[3] = OEM7_MIN_HEADER_LEN;
+    put_u16(payload + 4, msg_ID);
+    payload[6] = header->msg_type;
+    payload[7] = header->port_addr;
+    put_u16(payload + 8, msg_len);
+    put_u16(payload + 10, header->sequence);
+    payload[12] = header->idle_time;
+    payload[13] = header->time_status;
+    put_u16(payload + 14, header->week);
+    put_u32(payload + 16, header->ms);
+    put_u32(payload + 20, header->rcvr_stat);
+    put_u16(payload + 24, header->reserved);
+    put_u16(payload + 26, header->version);
+}
+
+// appends the CRC of the len bytes of header and message at payload,
+// and returns the length of the whole log
+static unsigned long seal_oem7(unsigned char *payload, unsigned long len)
+{
+    put_u32(payload + len, crc32_update(0, payload, len));
+    return len + 4;
+}
+
+unsigned long inspva2payload(const struct inspva_t *frame,
+                             unsigned char *payload)
+{
+    const unsigned short N = OEM7_MIN_HEADER_LEN;
+    put_oem7_header(&frame->header, payload, INSPVA_ID, INSPVA_MSG_LEN);
+    put_u32(payload+N, frame->week);
+    memcpy(payload+N+4, &frame->seconds, 8);
+    memcpy(payload+N+12, &frame->latitude, 8);
+    memcpy(payload+N+20, &frame->longitude, 8);
+    memcpy(payload+N+28, &frame->altitude, 8);
+    memcpy(payload+N+36, &frame->v_north, 8);
+    memcpy(payload+N+44, &frame->v_east, 8);
+    memcpy(payload+N+52, &frame->v_up, 8);
+    memcpy(payload+N+60, &frame->roll, 8);
+    memcpy(payload+N+68, &frame->pitch, 8);
+    memcpy(payload+N+76, &frame->azimuth, 8);
+    put_u32(payload+N+84, frame->status);
+    return seal_oem7(payload, N + INSPVA_MSG_LEN);
+}
+
+unsigned long pos2payload(const struct pos_t *frame, unsigned char *payload,
+                          enum pos_flag_t ID)
+{
+    const unsigned short N = OEM7_MIN_HEADER_LEN;
+    put_oem7_header(&frame->header, payload, ID, POS_MSG_LEN);
+    put_u32(payload+N+0, frame->sol_status);
+    put_u32(payload+N+4, frame->pos_type);
+    memcpy(payload+N+8, &frame->latitude, 8);
+    memcpy(payload+N+16, &frame->longitude, 8);
+    memcpy(payload+N+24, &frame->altitude, 8);
+    memcpy(payload+N+32, &frame->undulation, 4);
+    put_u32(payload+N+36, frame->datum_ID);
+    memcpy(payload+N+40, &frame->lat_STD, 4);
+    memcpy(payload+N+44, &frame->lon_STD, 4);
+    memcpy(payload+N+48, &frame->alt_STD, 4);
+    memcpy(payload+N+52, frame->station_ID, 4);
+    memcpy(payload+N+56, &frame->diff_age, 4);
+    memcpy(payload+N+60, &frame->sol_age, 4);
+    payload[N+64] = frame->SVs;
+    payload[N+65] = frame->solnSVs;
+    payload[N+66] = frame->ggL1;
+    payload[N+67] = frame->solnMultiSVs;
+    payload[N+68] = frame->reserved;
+    payload[N+69] = frame->ext_sol_stat;
+    payload[N+70] = frame->GB_mask;
+    payload[N+71] = frame->GG_mask;
+    return seal_oem7(payload, N + POS_MSG_LEN);
+}
+
+static void convert_inspva(struct oem7_outputs *outs, unsigned char *log,
+                           unsigned short msg_ID)
+{
+    struct inspva_t INSPVA;
+    (void) msg_ID;
+    if (payload2inspva(&INSPVA, log)) return;
+    if (outs->inspva_col) colrow_inspva(outs->inspva_col, &INSPVA);
+    else println_inspva(outs->inspva_out, &INSPVA);
+}
+
+static void convert_pos(struct oem7_outputs *outs, unsigned char *log,
+                        unsigned short msg_ID)
+{
+    struct pos_t POS;
+    enum pos_flag_t ID = (enum pos_flag_t) msg_ID;
+    if (payload2pos(&POS, log, ID)) return;
+    if (outs->pos_col) colrow_pos(outs->pos_col, &POS, ID);
+    else println_pos(outs->pos_out, &POS, ID);
+}
+
+static const struct oem7_handler oem7_handlers[] =
+{
+    {INSPVA_ID, INSPVA_MSG_LEN, convert_inspva},
+    {BESTPOS, POS_MSG_LEN, convert_pos},
+    {BESTGNSSPOS, POS_MSG_LEN, convert_pos},
+    {RTKPOS, POS_MSG_LEN, convert_pos}
+};
+
+// oem7_handlers hashed by message ID, with linear probing; built on
+// first use, which may be on any of the -j threads. the table is kept
+// at most half full.
+#define HANDLER_SLOTS 64
+static const struct oem7_handler *handler_table[HANDLER_SLOTS] = {0};
+static pthread_once_t handler_table_once = PTHREAD_ONCE_INIT;
+
+static void build_handler_table(void)
+{
+    unsigned n = sizeof(oem7_handlers)/sizeof(oem7_handlers[0]);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        unsigned slot = oem7_handlers[i].msg_ID % HANDLER_SLOTS;
+        while (handler_table[slot]) slot = (slot + 1) % HANDLER_SLOTS;
+        handler_table[slot] = &oem7_handlers[i];
+    }
+}
+
+const struct oem7_handler* oem7_find_handler(unsigned short msg_ID)
+{
+    pthread_once(&handler_table_once, build_handler_table);
+
+    unsigned slot = msg_ID % HANDLER_SLOTS;
+    while (handler_table[slot])
+    {
+        if (handler_table[slot]->msg_ID == msg_ID) return handler_table[slot];
+        slot = (slot + 1) % HANDLER_SLOTS;
+    }
+    return 0;
+}
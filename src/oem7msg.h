@@ -0,0 +1,161 @@
+#ifndef OEM7MSG_H
+#define OEM7MSG_H
+
+#include "outbuf.h"
+#include "colfile.h"
+
+// NovAtel OEM7 binary logs: framing and CRC checking, decoders for the
+// INSPVA and position logs, their ASCII and columnar rows, and the
+// table that routes each log to its converter by message ID. shared by
+// nconv and qtconv.
+//
+// every log starts with the sync bytes 0xAA 0x44 0x12 and a header
+// giving its own length and the message's, and ends with a CRC-32 of
+// everything before it; see crc32.h.
+
+// OEM7 binary headers are 28 bytes; anything claiming to be shorter,
+// or to be longer than OEM7_MAX_LOG_LEN, is taken to be a false sync
+// hit rather than checked
+#define OEM7_MIN_HEADER_LEN 28
+#define OEM7_MAX_LOG_LEN (32*1024)
+
+// NovAtel OEM7 header structure
+// https://docs.novatel.com/OEM7/Content/Messages/ASCII.htm
+struct oem7_header_t
+{
+    unsigned char sync_bytes[3], header_len;
+    unsigned short msg_ID;
+    unsigned char msg_type, port_addr;
+    unsigned short msg_len, sequence;
+    unsigned char idle_time;
+
+    // this is actually an enum:
+    unsigned char time_status;
+
+    unsigned short week;
+    unsigned long ms, rcvr_stat;
+    unsigned short reserved, version;
+};
+
+// NovAtel OEM7 INS Position, Velocity, and Attitude message
+// https://docs.novatel.com/OEM7/Content/SPAN_Logs/INSPVA.htm
+struct inspva_t
+{
+    struct oem7_header_t header;
+    unsigned long week;
+    double seconds;
+    double latitude, longitude, altitude,
+           v_north, v_east, v_up,
+           roll, pitch, azimuth;
+
+    // actually an enum
+    unsigned long status, checksum;
+};
+
+// message structure for NovAtel OEM7 BESTPOS, BESTGNSSPOS,
+// and RTKPOS logs; these logs have the same fields, but ascribe
+// different semantic meaning to them
+// https://docs.novatel.com/OEM7/Content/Logs/BESTPOS.htm
+// https://docs.novatel.com/OEM7/Content/SPAN_Logs/BESTGNSSPOS.htm
+// https://docs.novatel.com/OEM7/Content/Logs/RTKPOS.htm
+struct pos_t
+{
+    struct oem7_header_t header;
+    unsigned long sol_status, pos_type;
+    double latitude, longitude, altitude;
+    float undulation;
+    unsigned long datum_ID;
+    float lat_STD, lon_STD, alt_STD;
+    unsigned char station_ID[5];
+    float diff_age, sol_age;
+    unsigned char SVs, solnSVs, ggL1, solnMultiSVs,
+        reserved, ext_sol_stat, GB_mask, GG_mask;
+
+    unsigned long checksum;
+};
+
+// flag indicating different position log IDs;
+// used in tandem with pos_t
+enum pos_flag_t
+{
+    BESTPOS = 42,
+    BESTGNSSPOS = 1429,
+    RTKPOS = 141
+};
+
+// message ID of INSPVA; see payload2inspva
+enum { INSPVA_ID = 507 };
+
+// lengths of the messages of INSPVA and of the position logs, between
+// the header and the CRC
+enum { INSPVA_MSG_LEN = 88, POS_MSG_LEN = 72 };
+
+// takes a pointer to the first sync byte of a whole log, fills in
+// frame and returns 0, or returns nonzero if the log isn't of the kind
+// asked for. the CRC is not checked here; see oem7_crc_ok.
+int payload2inspva(struct inspva_t *frame, unsigned char *payload);
+int payload2pos(struct pos_t *frame, unsigned char *payload,
+                enum pos_flag_t ID);
+
+// the reverse of the decoders: each writes frame as a whole binary log
+// with a 28 byte header and a CRC to payload, and returns its length.
+// the sync bytes and the lengths and ID in the header are filled in
+// whatever frame->header says.
+unsigned long inspva2payload(const struct inspva_t *frame,
+                             unsigned char *payload);
+unsigned long pos2payload(const struct pos_t *frame, unsigned char *payload,
+                          enum pos_flag_t ID);
+
+// imitate (imperfectly) the ASCII output produced by NovAtel Convert,
+// one line per log
+void println_inspva(struct outbuf *out, struct inspva_t *frame);
+void println_pos(struct outbuf *out, struct pos_t *frame,
+                 enum pos_flag_t ID);
+
+// columns written by --format columnar, and the functions appending
+// one log as a row of them
+extern const struct col_desc inspva_cols[];
+extern const unsigned inspva_ncols;
+extern const struct col_desc pos_cols[];
+extern const unsigned pos_ncols;
+
+void colrow_inspva(struct colfile *col, struct inspva_t *frame);
+void colrow_pos(struct colfile *col, struct pos_t *frame, enum pos_flag_t ID);
+
+// length of the log at buf (header, message and CRC) as its header
+// gives it, or 0 if the header can't be a real one. the first 10 bytes
+// of the log must be readable.
+unsigned long oem7_log_len(const unsigned char *buf);
+
+// nonzero if the CRC-32 in the last 4 bytes of a len byte log matches
+// the header and message before it
+int oem7_crc_ok(const unsigned char *log, unsigned long len);
+
+// where converted logs are written: either the text or the columnar
+// pair is set, depending on --format
+struct oem7_outputs
+{
+    struct outbuf *inspva_out, *pos_out;
+    struct colfile *inspva_col, *pos_col;
+};
+
+// converts one log that has passed its CRC check; msg_ID is the ID the
+// handler was registered for
+typedef void (*oem7_converter)(struct oem7_outputs *outs,
+                               unsigned char *log, unsigned short msg_ID);
+
+// the logs that are converted. to support another log, write a
+// converter for it and register it in oem7msg.c with its ID and
+// message length (without header or CRC); every other log is skipped
+// whole
+struct oem7_handler
+{
+    unsigned short msg_ID, msg_len;
+    oem7_converter convert;
+};
+
+// the handler registered for msg_ID, or null if there is none; safe to
+// call from any thread
+const struct oem7_handler* oem7_find_handler(unsigned short msg_ID);
+
+#endif // OEM7MSG_H
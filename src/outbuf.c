@@ -0,0 +1,268 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "outbuf.h"
+
+// body of the writer thread: waits for a buffer to be handed over,
+// writes all of it, and signals that it's free again
+static void* outbuf_writer(void *arg)
+{
+    struct outbuf *ob = (struct outbuf*) arg;
+
+    pthread_mutex_lock(&ob->lock);
+    while (1)
+    {
+        while (!ob->pending && !ob->done)
+            pthread_cond_wait(&ob->cond, &ob->lock);
+        if (!ob->pending) break; // done, and nothing left to write
+
+        const char *data = ob->buf[ob->fill ^ 1];
+        unsigned long len = ob->pending_len;
+        pthread_mutex_unlock(&ob->lock);
+
+        unsigned long written = 0;
+        unsigned long long calls = 0;
+        int error = 0;
+        while (written < len)
+        {
+            ssize_t n = write(ob->fd, data + written, len - written);
+            ++calls;
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0)
+            {
+                error = 1;
+                break;
+            }
+            written += n;
+        }
+
+        pthread_mutex_lock(&ob->lock);
+        ob->bytes += written;
+        ob->syscalls += calls;
+        ob->error |= error;
+        ob->pending = 0;
+        pthread_cond_broadcast(&ob->cond);
+    }
+    pthread_mutex_unlock(&ob->lock);
+    return 0;
+}
+
+// hands the fill buffer to the writer, first waiting for the writer to
+// finish with the other one; the caller then fills the other buffer
+static void outbuf_swap(struct outbuf *ob)
+{
+    pthread_mutex_lock(&ob->lock);
+    while (ob->pending) pthread_cond_wait(&ob->cond, &ob->lock);
+    if (ob->len)
+    {
+        ob->pending = 1;
+        ob->pending_len = ob->len;
+        ob->handed += ob->len;
+        ob->fill ^= 1;
+        ob->len = 0;
+        pthread_cond_broadcast(&ob->cond);
+    }
+    pthread_mutex_unlock(&ob->lock);
+}
+
+// a memory outbuf has no writer to hand its buffer to, so instead of
+// swapping, the buffer grows until at least n more bytes fit after
+// what it holds; returns nonzero if it couldn't
+static int outbuf_grow(struct outbuf *ob, unsigned long n)
+{
+    unsigned long cap = ob->cap;
+    while (cap - ob->len < n) cap *= 2;
+    if (cap == ob->cap) return 0;
+
+    char *buf = (char*) realloc(ob->buf[0], cap);
+    if (!buf)
+    {
+        ob->error = 1;
+        return 1;
+    }
+    ob->buf[0] = buf;
+    ob->cap = cap;
+    return 0;
+}
+
+int outbuf_open(struct outbuf *ob, int fd, unsigned long cap)
+{
+    if (!ob || fd < 0 || cap == 0) return 1;
+
+    memset(ob, 0, sizeof(*ob));
+    ob->fd = fd;
+    ob->cap = cap;
+    ob->buf[0] = (char*) malloc(cap);
+    ob->buf[1] = (char*) malloc(cap);
+
+    off_t pos = lseek(fd, 0, SEEK_CUR);
+    ob->base = pos < 0 ? 0 : pos;
+
+    if (!ob->buf[0] || !ob->buf[1])
+    {
+        free(ob->buf[0]);
+        free(ob->buf[1]);
+        return 1;
+    }
+
+    pthread_mutex_init(&ob->lock, 0);
+    pthread_cond_init(&ob->cond, 0);
+    if (pthread_create(&ob->writer, 0, outbuf_writer, ob))
+    {
+        pthread_mutex_destroy(&ob->lock);
+        pthread_cond_destroy(&ob->cond);
+        free(ob->buf[0]);
+        free(ob->buf[1]);
+        return 1;
+    }
+    return 0;
+}
+
+int outbuf_open_mem(struct outbuf *ob, unsigned long cap)
+{
+    if (!ob || cap == 0) return 1;
+
+    memset(ob, 0, sizeof(*ob));
+    ob->fd = -1;
+    ob->cap = cap;
+    ob->buf[0] = (char*) malloc(cap);
+    return ob->buf[0] == 0;
+}
+
+char* outbuf_reserve(struct outbuf *ob, unsigned long n)
+{
+    if (ob->fd < 0) return outbuf_grow(ob, n) ? 0 : ob->buf[0] + ob->len;
+    if (n > ob->cap)
+    {
+        // the writer thread sets error too
+        pthread_mutex_lock(&ob->lock);
+        ob->error = 1;
+        pthread_mutex_unlock(&ob->lock);
+        return 0;
+    }
+    if (ob->cap - ob->len < n) outbuf_swap(ob);
+    return ob->buf[ob->fill] + ob->len;
+}
+
+void outbuf_commit(struct outbuf *ob, unsigned long n)
+{
+    ob->len += n;
+}
+
+int outbuf_write(struct outbuf *ob, const void *data, unsigned long n)
+{
+    const char *src = (const char*) data;
+    if (ob->fd < 0)
+    {
+        if (outbuf_grow(ob, n)) return 1;
+        memcpy(ob->buf[0] + ob->len, src, n);
+        ob->len += n;
+        return 0;
+    }
+    while (n > 0)
+    {
+        if (ob->len == ob->cap) outbuf_swap(ob);
+        unsigned long chunk = ob->cap - ob->len;
+        if (chunk > n) chunk = n;
+        memcpy(ob->buf[ob->fill] + ob->len, src, chunk);
+        ob->len += chunk;
+        src += chunk;
+        n -= chunk;
+    }
+    return 0;
+}
+
+int outbuf_printf(struct outbuf *ob, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(ob->buf[ob->fill] + ob->len,
+        ob->cap - ob->len, fmt, args);
+    va_end(args);
+    if (n < 0) return n;
+
+    if ((unsigned long) n < ob->cap - ob->len) // fit in the fill buffer
+    {
+        ob->len += n;
+        return n;
+    }
+
+    // didn't fit; start a fresh buffer (or grow a memory outbuf) and
+    // format again, or for text longer than a whole buffer, format on
+    // the heap
+    if (ob->fd < 0)
+    {
+        if (outbuf_grow(ob, n + 1)) return -1;
+    }
+    else outbuf_swap(ob);
+    va_start(args, fmt);
+    if (ob->fd < 0)
+    {
+        vsnprintf(ob->buf[0] + ob->len, ob->cap - ob->len, fmt, args);
+        ob->len += n;
+    }
+    else if ((unsigned long) n < ob->cap)
+    {
+        vsnprintf(ob->buf[ob->fill], ob->cap, fmt, args);
+        ob->len = n;
+    }
+    else
+    {
+        char *tmp = (char*) malloc(n + 1);
+        if (tmp)
+        {
+            vsnprintf(tmp, n + 1, fmt, args);
+            outbuf_write(ob, tmp, n);
+            free(tmp);
+        }
+        else n = -1;
+    }
+    va_end(args);
+    return n;
+}
+
+int outbuf_flush(struct outbuf *ob)
+{
+    if (ob->fd < 0) return ob->error;
+    outbuf_swap(ob);
+    pthread_mutex_lock(&ob->lock);
+    while (ob->pending) pthread_cond_wait(&ob->cond, &ob->lock);
+    int error = ob->error;
+    pthread_mutex_unlock(&ob->lock);
+    return error;
+}
+
+unsigned long long outbuf_tell(const struct outbuf *ob)
+{
+    return ob->base + ob->handed + ob->len;
+}
+
+int outbuf_close(struct outbuf *ob)
+{
+    int error = outbuf_flush(ob);
+    if (ob->fd < 0)
+    {
+        free(ob->buf[0]);
+        ob->buf[0] = 0;
+        return error;
+    }
+
+    pthread_mutex_lock(&ob->lock);
+    ob->done = 1;
+    pthread_cond_broadcast(&ob->cond);
+    pthread_mutex_unlock(&ob->lock);
+    pthread_join(ob->writer, 0);
+
+    pthread_mutex_destroy(&ob->lock);
+    pthread_cond_destroy(&ob->cond);
+    free(ob->buf[0]);
+    free(ob->buf[1]);
+    ob->buf[0] = ob->buf[1] = 0;
+    return error;
+}
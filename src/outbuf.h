@@ -0,0 +1,80 @@
+#ifndef OUTBUF_H
+#define OUTBUF_H
+
+#include <pthread.h>
+
+// double-buffered output stage shared by the converters. rows are
+// formatted into one large buffer while a writer thread hands the
+// other one to the kernel, so decoding never waits on disk and each
+// write() call moves a whole buffer instead of a few bytes.
+struct outbuf
+{
+    int fd; // -1 for a memory outbuf; see outbuf_open_mem
+    char *buf[2];
+    unsigned long cap;
+
+    // buffer currently being filled by the decoder, and its length
+    int fill;
+    unsigned long len;
+
+    // buffer handed to the writer thread, if any
+    int pending;
+    unsigned long pending_len;
+
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int done, error;
+
+    // file offset at which this outbuf started writing, bytes handed
+    // to the writer so far, and totals reported by the writer thread
+    unsigned long long base, handed, bytes, syscalls;
+};
+
+// default size of each of the two buffers
+#define OUTBUF_DEFAULT_CAP (1024*1024)
+
+// starts a writer thread for the given file descriptor, using two
+// buffers of cap bytes each. returns 0 on success.
+int outbuf_open(struct outbuf *ob, int fd, unsigned long cap);
+
+// appends n bytes of data to the output
+int outbuf_write(struct outbuf *ob, const void *data, unsigned long n);
+
+// appends printf-formatted text to the output; a drop-in replacement
+// for fprintf in the row emitters
+int outbuf_printf(struct outbuf *ob, const char *fmt, ...)
+#ifdef __GNUC__
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+
+// makes sure a contiguous region of at least n bytes is available at
+// the end of the fill buffer and returns a pointer to it; after
+// writing into it, the caller commits what it used with outbuf_commit.
+// returns null if n is more than a buffer holds, or if a memory outbuf
+// couldn't grow; the outbuf is then failed, so that outbuf_flush and
+// outbuf_close report it, and the caller must write nothing.
+char* outbuf_reserve(struct outbuf *ob, unsigned long n);
+void outbuf_commit(struct outbuf *ob, unsigned long n);
+
+// hands everything buffered so far to the writer and waits until it
+// has all been written; returns nonzero if any write has failed
+int outbuf_flush(struct outbuf *ob);
+
+// offset in the output file just past the last byte appended so far
+unsigned long long outbuf_tell(const struct outbuf *ob);
+
+// opens an outbuf with no file behind it: everything appended stays
+// in one buffer, starting at cap bytes and growing as needed, until
+// it's closed. used to format a piece of the output on one thread
+// while another writes the pieces to the file in order; the text is
+// buf[0][0..len). returns 0 on success.
+int outbuf_open_mem(struct outbuf *ob, unsigned long cap);
+
+// flushes, stops the writer thread and frees the buffers; the file
+// descriptor is left open. returns nonzero if any write has failed,
+// or for a memory outbuf, if it couldn't grow.
+int outbuf_close(struct outbuf *ob);
+
+#endif // OUTBUF_H
@@ -0,0 +1,217 @@
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "parconv.h"
+
+// starting size of each chunk's memory outbufs; they grow as needed
+#define PARCONV_OUT_CAP (256*1024)
+
+struct parconv_chunk
+{
+    // input range whose frames this chunk holds, and where its decoder
+    // stopped
+    unsigned long long start, stop, next, tally;
+    struct outbuf outs[PARCONV_MAX_OUTS];
+    int done, error;
+};
+
+// everything the workers share; taken, written and the chunks' done
+// flags are guarded by lock
+struct parconv_job
+{
+    unsigned char *data;
+    unsigned long long len;
+    parconv_decode decode;
+    void *ctx;
+    unsigned nouts;
+
+    struct parconv_chunk *chunks;
+    unsigned long long nchunks;
+
+    // next chunk to be decoded, next chunk to be written, and how far
+    // ahead of the writing the decoding may get
+    unsigned long long taken, written, window;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+// decodes a chunk's frames, from the given offset, into fresh outbufs
+static void parconv_decode_chunk(struct parconv_job *job,
+    struct parconv_chunk *c, unsigned long long from)
+{
+    unsigned opened = 0;
+    while (opened < job->nouts &&
+           outbuf_open_mem(&c->outs[opened], PARCONV_OUT_CAP) == 0)
+    {
+        ++opened;
+    }
+    if (opened < job->nouts)
+    {
+        while (opened) outbuf_close(&c->outs[--opened]);
+        c->error = 1;
+        c->next = c->stop;
+        return;
+    }
+
+    // a frame may have run over this whole chunk
+    c->tally = 0;
+    if (from >= c->stop) c->next = from;
+    else c->next = job->decode(job->ctx, job->data, job->len,
+        from, c->stop, c->outs, &c->tally);
+}
+
+static void parconv_release_chunk(struct parconv_job *job,
+    struct parconv_chunk *c)
+{
+    if (c->error) return;
+    for (unsigned k = 0; k < job->nouts; ++k)
+    {
+        if (outbuf_close(&c->outs[k])) c->error = 1;
+    }
+}
+
+// body of a worker thread: decodes chunks in order until there are
+// none left, never getting more than window chunks ahead of the writer
+static void* parconv_worker(void *arg)
+{
+    struct parconv_job *job = (struct parconv_job*) arg;
+
+    pthread_mutex_lock(&job->lock);
+    while (1)
+    {
+        while (job->taken < job->nchunks &&
+               job->taken >= job->written + job->window)
+        {
+            pthread_cond_wait(&job->cond, &job->lock);
+        }
+        if (job->taken >= job->nchunks) break;
+
+        struct parconv_chunk *c = &job->chunks[job->taken++];
+        pthread_mutex_unlock(&job->lock);
+
+        parconv_decode_chunk(job, c, c->start);
+
+        pthread_mutex_lock(&job->lock);
+        c->done = 1;
+        pthread_cond_broadcast(&job->cond);
+    }
+    pthread_mutex_unlock(&job->lock);
+    return 0;
+}
+
+int parconv_run(unsigned char *data, unsigned long long len,
+    unsigned long long start, unsigned nthreads,
+    parconv_align align, parconv_decode decode, struct progress *progress,
+    void *ctx, struct outbuf **outs, unsigned nouts,
+    unsigned long long *tally)
+{
+    if (!data || !align || !decode || nouts == 0 ||
+        nouts > PARCONV_MAX_OUTS)
+    {
+        return 1;
+    }
+    if (start >= len) return 0;
+    if (nthreads == 0) nthreads = 1;
+
+    // place the chunk boundaries: each one is the first frame at or
+    // after its nominal offset. a boundary found past the next nominal
+    // offset is searched on from, so no stretch of input is searched
+    // twice, however little of it decodes.
+    unsigned long long max_chunks = (len - start)/PARCONV_CHUNK_LEN + 1;
+    struct parconv_chunk *chunks = (struct parconv_chunk*)
+        calloc(max_chunks, sizeof(struct parconv_chunk));
+    if (!chunks) return 1;
+
+    unsigned long long nchunks = 1;
+    chunks[0].start = start;
+    for (unsigned long long i = 1; i < max_chunks; ++i)
+    {
+        unsigned long long pos = start + i*PARCONV_CHUNK_LEN;
+        if (pos < chunks[nchunks-1].start) pos = chunks[nchunks-1].start;
+        unsigned long long boundary = align(ctx, data, len, pos);
+        if (boundary >= len) break;
+        if (boundary <= chunks[nchunks-1].start) continue;
+        chunks[nchunks-1].stop = boundary;
+        chunks[nchunks++].start = boundary;
+    }
+    chunks[nchunks-1].stop = len;
+
+    struct parconv_job job;
+    memset(&job, 0, sizeof(job));
+    job.data = data;
+    job.len = len;
+    job.decode = decode;
+    job.ctx = ctx;
+    job.nouts = nouts;
+    job.chunks = chunks;
+    job.nchunks = nchunks;
+    job.window = 2*nthreads;
+    pthread_mutex_init(&job.lock, 0);
+    pthread_cond_init(&job.cond, 0);
+
+    pthread_t *workers = (pthread_t*) malloc(nthreads*sizeof(pthread_t));
+    unsigned nworkers = 0;
+    while (workers && nworkers < nthreads &&
+           pthread_create(&workers[nworkers], 0, parconv_worker, &job) == 0)
+    {
+        ++nworkers;
+    }
+
+    // write the chunks in order. a chunk no worker has taken yet (there
+    // may be no workers at all) is decoded here instead of waited for
+    int error = 0;
+    unsigned long long sum = 0;
+    for (unsigned long long i = 0; i < nchunks; ++i)
+    {
+        struct parconv_chunk *c = &chunks[i];
+
+        pthread_mutex_lock(&job.lock);
+        int mine = job.taken == i;
+        if (mine) ++job.taken;
+        while (!mine && !c->done) pthread_cond_wait(&job.cond, &job.lock);
+        pthread_mutex_unlock(&job.lock);
+        if (mine) parconv_decode_chunk(&job, c, c->start);
+
+        // the previous chunk's last frame ran past this chunk's first
+        // one, so a single pass would have resumed somewhere else
+        if (i > 0 && chunks[i-1].next != c->start)
+        {
+            parconv_release_chunk(&job, c);
+            if (!c->error) parconv_decode_chunk(&job, c, chunks[i-1].next);
+        }
+
+        if (!c->error)
+        {
+            for (unsigned k = 0; k < nouts; ++k)
+                outbuf_write(outs[k], c->outs[k].buf[0], c->outs[k].len);
+        }
+        parconv_release_chunk(&job, c);
+        error |= c->error;
+        sum += c->tally;
+        if (progress) progress_update(progress, c->stop);
+
+        pthread_mutex_lock(&job.lock);
+        ++job.written;
+        pthread_cond_broadcast(&job.cond);
+        pthread_mutex_unlock(&job.lock);
+    }
+
+    for (unsigned t = 0; t < nworkers; ++t) pthread_join(workers[t], 0);
+    free(workers);
+    pthread_mutex_destroy(&job.lock);
+    pthread_cond_destroy(&job.cond);
+    free(chunks);
+
+    if (tally) *tally += sum;
+    return error;
+}
+
+unsigned parconv_cpus(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n < 1 ? 1 : (unsigned) n;
+}
@@ -0,0 +1,57 @@
+#ifndef PARCONV_H
+#define PARCONV_H
+
+#include "outbuf.h"
+#include "report.h"
+
+// parallel conversion of a mapped input file, behind the converters'
+// -j option. the input is cut into chunks of about chunk_len bytes,
+// each starting at a frame the converter accepts (so at a real sync
+// sequence rather than a sync pattern inside some payload); each chunk
+// is decoded and formatted on a worker thread into memory outbufs of
+// its own, and the main thread writes the chunks' text to the real
+// outputs in input order. only a few chunks per thread are in flight at
+// once, so memory use doesn't grow with the file.
+//
+// the text is the same as a single threaded conversion's: a decoder
+// reports where its last frame ended, and in the rare case that a frame
+// runs over the start of the next chunk, that chunk is decoded again on
+// the main thread from where a single pass would have picked up.
+
+// most output files one conversion writes (nconv writes two)
+#define PARCONV_MAX_OUTS 2
+
+// returns the offset of the first frame at or after pos that the
+// converter would decode, or len if there is none
+typedef unsigned long long (*parconv_align)(void *ctx,
+    unsigned char *data, unsigned long long len, unsigned long long pos);
+
+// decodes every frame that starts in [start, stop) of the len byte
+// input (start < stop), appending its text to outs[0..nouts), and
+// returns the offset just past where decoding stopped: the end of the
+// last frame or resync, at or after stop. called from worker threads at once, so it
+// must only read ctx. *tally starts at 0 and may count whatever the
+// converter wants summed over the file, e.g. rejected frames.
+typedef unsigned long long (*parconv_decode)(void *ctx,
+    unsigned char *data, unsigned long long len,
+    unsigned long long start, unsigned long long stop,
+    struct outbuf *outs, unsigned long long *tally);
+
+// nominal chunk size; big enough that splitting and handing over
+// chunks costs nothing next to decoding them
+#define PARCONV_CHUNK_LEN (1024*1024)
+
+// converts [start, len) of data on nthreads threads, writing to the
+// nouts outbufs pointed to by outs and updating progress, if it isn't
+// null, as each chunk is written. returns 0 on success, and adds the
+// decoders' tallies to *tally if it isn't null.
+int parconv_run(unsigned char *data, unsigned long long len,
+    unsigned long long start, unsigned nthreads,
+    parconv_align align, parconv_decode decode, struct progress *progress,
+    void *ctx, struct outbuf **outs, unsigned nouts,
+    unsigned long long *tally);
+
+// number of threads to use for -j 0: one per online processor
+unsigned parconv_cpus(void);
+
+#endif // PARCONV_H
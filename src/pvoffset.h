@@ -0,0 +1,139 @@
+#ifndef PVOFFSET_H
+#define PVOFFSET_H
+
+#include <math.h>
+
+#include <Eigen/Geometry>
+
+// the post-test position-velocity offset ilconv applies with --pvoff:
+// moves the position and velocity of each frame from the INS to a
+// point fixed pvoff_input metres away from it in the body frame. kept
+// in a header of its own so that decbench can time it.
+
+// frames the PV offset is applied to at once
+#define PV_BLOCK_LEN 256
+
+// scratch columns for apply_PV_offset, one array per quantity over a
+// block of frames; m holds each frame's rotation matrix by entry
+struct pv_columns
+{
+    double sh[PV_BLOCK_LEN], ch[PV_BLOCK_LEN],
+           sp[PV_BLOCK_LEN], cp[PV_BLOCK_LEN],
+           sr[PV_BLOCK_LEN], cr[PV_BLOCK_LEN];
+    double m[3][3][PV_BLOCK_LEN];
+    double turn_rate[3][PV_BLOCK_LEN];
+    double p_offset[3][PV_BLOCK_LEN], v_offset[3][PV_BLOCK_LEN];
+};
+
+// applies the position-velocity offset to n frames at once. every
+// frame's rotation matrix is built straight from the sines and cosines
+// of its angles, a whole column of frames at a time, and the offset and
+// turn rate are rotated the same way; only the fixed point update at
+// the end goes frame by frame. no memory is allocated.
+template <typename T>
+void apply_PV_offset(T *frames, unsigned n, const double pvoff_input[3])
+{
+    typedef Eigen::Map<Eigen::ArrayXd> column;
+    struct pv_columns c;
+
+    // rotations to radians; heading sign convention
+    // is inverted to follow the right-hand rule
+    for (unsigned i = 0; i < n; ++i)
+    {
+        double heading = (M_PI/180)*(360 - frames[i].heading/100.0),
+               pitch = (M_PI/180)*(frames[i].pitch/100.0),
+               roll = (M_PI/180)*(frames[i].roll/100.0);
+        c.sh[i] = sin(heading);
+        c.ch[i] = cos(heading);
+        c.sp[i] = sin(pitch);
+        c.cp[i] = cos(pitch);
+        c.sr[i] = sin(roll);
+        c.cr[i] = cos(roll);
+
+        // turn rate in radians per second
+        c.turn_rate[0][i] = M_PI/180.0 * (frames[i].gyro_x/1.0E5);
+        c.turn_rate[1][i] = M_PI/180.0 * (frames[i].gyro_y/1.0E5);
+        c.turn_rate[2][i] = M_PI/180.0 * (frames[i].gyro_z/1.0E5);
+    }
+
+    column sh(c.sh, n), ch(c.ch, n), sp(c.sp, n),
+           cp(c.cp, n), sr(c.sr, n), cr(c.cr, n);
+    column m[3][3] = {
+        {column(c.m[0][0], n), column(c.m[0][1], n), column(c.m[0][2], n)},
+        {column(c.m[1][0], n), column(c.m[1][1], n), column(c.m[1][2], n)},
+        {column(c.m[2][0], n), column(c.m[2][1], n), column(c.m[2][2], n)}};
+
+    // rotation convention is Z-X'-Y'', composed as it always has been:
+    // the pitch and roll turns are about the rotated axes X' = Z*X and
+    // Y'' = (Z*X')*Y' and are then applied on top of the heading turn,
+    // which comes to Rz(2h) Rx(2p) Ry(r) Rx(-p) Rz(-h). that's
+    // B Ry(r) C' with B = Rz(2h) Rx(2p) and C = Rz(h) Rx(p), and
+    // Rz(a) Rx(b) = [ca -sa*cb sa*sb; sa ca*cb -ca*sb; 0 sb cb]
+    {
+        // B Ry(r) goes in m first, then gets multiplied by C'
+        column s2h(c.p_offset[0], n), c2h(c.p_offset[1], n),
+               s2p(c.p_offset[2], n), c2p(c.v_offset[0], n);
+        s2h = 2*sh*ch;
+        c2h = ch*ch - sh*sh;
+        s2p = 2*sp*cp;
+        c2p = cp*cp - sp*sp;
+        m[0][0] = c2h*cr - s2h*s2p*sr;
+        m[0][1] = -s2h*c2p;
+        m[0][2] = c2h*sr + s2h*s2p*cr;
+        m[1][0] = s2h*cr + c2h*s2p*sr;
+        m[1][1] = c2h*c2p;
+        m[1][2] = s2h*sr - c2h*s2p*cr;
+        m[2][0] = -c2p*sr;
+        m[2][1] = s2p;
+        m[2][2] = c2p*cr;
+    }
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        // entry j of row i is row i of B Ry(r) dotted with row j of
+        // C, whose last row starts with a zero
+        column b0(c.v_offset[0], n), b1(c.v_offset[1], n),
+               b2(c.v_offset[2], n);
+        b0 = m[i][0];
+        b1 = m[i][1];
+        b2 = m[i][2];
+        m[i][0] = b0*ch - b1*sh*cp + b2*sh*sp;
+        m[i][1] = b0*sh + b1*ch*cp - b2*ch*sp;
+        m[i][2] = b1*sp + b2*cp;
+    }
+
+    column w[3] = {column(c.turn_rate[0], n), column(c.turn_rate[1], n),
+        column(c.turn_rate[2], n)};
+    column p[3] = {column(c.p_offset[0], n), column(c.p_offset[1], n),
+        column(c.p_offset[2], n)};
+    column v[3] = {column(c.v_offset[0], n), column(c.v_offset[1], n),
+        column(c.v_offset[2], n)};
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        p[i] = m[i][0]*pvoff_input[0] + m[i][1]*pvoff_input[1] +
+            m[i][2]*pvoff_input[2];
+        // the rotated turn rate is only needed for the cross product,
+        // so it goes where the matrix's first column was
+        m[i][0] = m[i][0]*w[0] + m[i][1]*w[1] + m[i][2]*w[2];
+    }
+    v[0] = m[1][0]*p[2] - m[2][0]*p[1];
+    v[1] = m[2][0]*p[0] - m[0][0]*p[2];
+    v[2] = m[0][0]*p[1] - m[1][0]*p[0];
+
+    // add offset to opvt2ahr data frames before printing
+    const unsigned long long R_EARTH = 6371000;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        T &frame = frames[i];
+        frame.latitude += (180E9*c.p_offset[1][i])/(R_EARTH*M_PI);
+        double lat_rad = (M_PI/180)*(frame.latitude/1.0E9);
+        frame.longitude +=
+            (180E9*c.p_offset[0][i])/(R_EARTH*M_PI*cos(lat_rad));
+        frame.altitude += 1E3*c.p_offset[2][i];
+
+        frame.v_east += c.v_offset[0][i];
+        frame.v_north += c.v_offset[1][i];
+        frame.v_up += c.v_offset[2][i];
+    }
+}
+
+#endif // PVOFFSET_H
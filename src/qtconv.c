@@ -0,0 +1,299 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "mapfile.h"
+#include "outbuf.h"
+#include "syncscan.h"
+#include "ilmsg.h"
+#include "oem7msg.h"
+
+// the kinds of output a log can produce, each written to a file named
+// after the log with the extension below; the same names ilconv, opvt
+// and nconv give their outputs, save that OPVT text gets an extension
+// of its own so that it can sit next to OPVT2AHR text
+enum { OUT_OPVT2AHR, OUT_OPVT, OUT_INSPVA, OUT_POS, NUM_OUTS };
+
+const char *out_ext[NUM_OUTS] = {".txt", ".opvt.txt", ".ins", ".pos"};
+const char *out_what[NUM_OUTS] =
+    {"OPVT2AHR frames", "OPVT frames", "INSPVA logs", "position logs"};
+
+// one output file, opened when the first frame of its kind turns up
+struct qt_output
+{
+    char *filename;
+    int fd;
+    struct outbuf out;
+    unsigned char open;
+    unsigned long long frames;
+};
+
+// state of the conversion of one log
+struct qt_state
+{
+    const char *progname, *infile;
+    struct qt_output outs[NUM_OUTS];
+
+    // the last alignment block seen, if any; it heads the text of each
+    // Inertial Labs output, as it would with ilconv or opvt
+    unsigned char *align;
+
+    // known OEM7 logs dropped because their CRC didn't match, and the
+    // pair of outbufs their converters write to
+    unsigned long long rejected;
+    struct oem7_outputs oem7;
+};
+
+// names an output after infile the way the other converters do: the
+// first ".bin" and everything after it is replaced by ext, or ext is
+// appended if there is no ".bin"
+char* output_name(const char *infile, const char *ext)
+{
+    char *fn = (char*) malloc(strlen(infile) + strlen(ext) + 1);
+    if (!fn) return 0;
+    strcpy(fn, infile);
+    char *ext_ptr = strstr(fn, ".bin");
+    strcpy(ext_ptr ? ext_ptr : fn + strlen(fn), ext);
+    return fn;
+}
+
+// prints an alignment block and the column titles that follow it into
+// one of the Inertial Labs outputs
+void print_il_header(struct qt_state *st, unsigned kind)
+{
+    struct outbuf *out = &st->outs[kind].out;
+    if (st->align)
+    {
+        unsigned short msg_len = st->align[4] | (st->align[5] << 8);
+        if (msg_len == 0x38)
+        {
+            struct short_align_block header;
+            payload2header(&header, st->align);
+            print_header(out, &header);
+        }
+        else
+        {
+            struct ext_align_block header;
+            payload2extheader(&header, st->align);
+            print_extheader(out, &header);
+        }
+    }
+    outbuf_printf(out, "\n");
+    if (kind == OUT_OPVT2AHR) println_opvt2ahr(out, 0);
+    else println_opvt(out, 0);
+}
+
+// the outbuf for the given kind of output, opening its file first if
+// this is the first frame of that kind; null if it can't be opened
+struct outbuf* output(struct qt_state *st, unsigned kind)
+{
+    struct qt_output *o = &st->outs[kind];
+    if (o->open) return &o->out;
+
+    o->filename = output_name(st->infile, out_ext[kind]);
+    if (!o->filename)
+    {
+        fprintf(stderr, "\n%s: memory allocation error\n", st->progname);
+        return 0;
+    }
+    o->fd = open(o->filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (o->fd == -1 || outbuf_open(&o->out, o->fd, OUTBUF_DEFAULT_CAP))
+    {
+        fprintf(stderr, "\n%s: failed to open '%s'\n",
+            st->progname, o->filename);
+        if (o->fd != -1) close(o->fd);
+        free(o->filename);
+        return 0;
+    }
+    o->open = 1;
+
+    // the same preamble as ilconv's, which qtconv never offsets
+    if (kind == OUT_OPVT2AHR)
+    {
+        outbuf_printf(&o->out,
+            "post-test applied PV offset: %.2f %.2f %.2f\n", 0.0, 0.0, 0.0);
+    }
+    if (kind == OUT_OPVT2AHR || kind == OUT_OPVT) print_il_header(st, kind);
+    return &o->out;
+}
+
+// decodes the Inertial Labs message at buf, if there is a whole valid
+// one in the len bytes there, and returns its length, or 0
+unsigned long convert_il(struct qt_state *st,
+    unsigned char *buf, unsigned long long len, int *error)
+{
+    unsigned char type = buf[3];
+    unsigned short msg_len = buf[4] | (buf[5] << 8);
+    if (msg_len + 2ULL > len) return 0;
+
+    if (msg_len == IL_ACK_LEN - 2) return IL_ACK_LEN;
+    if (msg_len == IL_ALIGN_LEN - 2 || msg_len == IL_EXT_ALIGN_LEN - 2)
+    {
+        struct short_align_block header;
+        struct ext_align_block extheader;
+        if (msg_len == IL_ALIGN_LEN - 2 ?
+            payload2header(&header, buf) : payload2extheader(&extheader, buf))
+        {
+            return 0;
+        }
+        // a new alignment block starts the text of the outputs afresh,
+        // as it does when ilconv converts a stream
+        st->align = buf;
+        for (unsigned kind = OUT_OPVT2AHR; kind <= OUT_OPVT; ++kind)
+        {
+            if (st->outs[kind].open) print_il_header(st, kind);
+        }
+        return msg_len + 2;
+    }
+    if (type == IL_OPVT2AHR_TYPE && msg_len == IL_OPVT2AHR_LEN - 2)
+    {
+        struct opvt2ahr_t frame;
+        if (payload2opvt2ahr(&frame, buf)) return 0;
+        struct outbuf *out = output(st, OUT_OPVT2AHR);
+        if (!out) *error = 1;
+        println_opvt2ahr(out, &frame);
+        ++st->outs[OUT_OPVT2AHR].frames;
+        return IL_OPVT2AHR_LEN;
+    }
+    if (type == IL_OPVT_TYPE && msg_len == IL_OPVT_LEN - 2)
+    {
+        struct opvt_t frame;
+        if (payload2opvt(&frame, buf)) return 0;
+        struct outbuf *out = output(st, OUT_OPVT);
+        if (!out) *error = 1;
+        println_opvt(out, &frame);
+        ++st->outs[OUT_OPVT].frames;
+        return IL_OPVT_LEN;
+    }
+    return 0;
+}
+
+// decodes the OEM7 log at buf, if there is a whole one in the len
+// bytes there that passes its CRC check, and returns its length, or 0.
+// logs nconv doesn't convert are skipped whole.
+unsigned long convert_oem7(struct qt_state *st,
+    unsigned char *buf, unsigned long long len, int *error)
+{
+    unsigned short msg_ID = buf[4] | (buf[5] << 8);
+    unsigned long msg_len = buf[8] | (buf[9] << 8);
+    unsigned long loglen = oem7_log_len(buf);
+    if (!loglen || loglen > len) return 0;
+
+    const struct oem7_handler *handler = oem7_find_handler(msg_ID);
+    if (!oem7_crc_ok(buf, loglen))
+    {
+        if (handler) ++st->rejected;
+        return 0;
+    }
+    if (handler && msg_len == handler->msg_len)
+    {
+        unsigned kind = msg_ID == INSPVA_ID ? OUT_INSPVA : OUT_POS;
+        struct outbuf *out = output(st, kind);
+        if (!out) *error = 1;
+        if (kind == OUT_INSPVA) st->oem7.inspva_out = out;
+        else st->oem7.pos_out = out;
+        handler->convert(&st->oem7, buf, msg_ID);
+        ++st->outs[kind].frames;
+    }
+    return loglen;
+}
+
+// converts one log in a single pass, sending every frame to the output
+// of its kind; returns nonzero on failure
+int convert_file(const char *progname, const char *infile)
+{
+    struct mapped_file mf;
+    if (map_file(&mf, infile))
+    {
+        fprintf(stderr, "%s: failed to open '%s'\n", progname, infile);
+        return 1;
+    }
+
+    struct qt_state st;
+    memset(&st, 0, sizeof(st));
+    st.progname = progname;
+    st.infile = infile;
+
+    // every message either kind of unit sends starts with 0xAA; what
+    // follows it says whose it is
+    static const unsigned char sync = 0xAA;
+    unsigned char *buf = mf.data;
+    unsigned long long len = mf.len, rptr = 0;
+    unsigned char progress, old_progress = 255;
+    int error = 0;
+    while (!error && rptr + 10 <= len)
+    {
+        rptr += sync_scan(buf + rptr, len - rptr, &sync, 1);
+        if (rptr + 10 > len) break;
+
+        unsigned long used = 0;
+        if (buf[rptr+1] == il_sync[1] && buf[rptr+2] == il_sync[2])
+            used = convert_il(&st, buf + rptr, len - rptr, &error);
+        else if (buf[rptr+1] == oem7_sync[1] && buf[rptr+2] == oem7_sync[2])
+            used = convert_oem7(&st, buf + rptr, len - rptr, &error);
+        rptr += used ? used : 1;
+
+        progress = 100*rptr/len;
+        if (progress != old_progress)
+        {
+            old_progress = progress;
+            fprintf(stderr, "\r%s: %s: %2hhu%%", progname, infile, progress);
+        }
+    }
+    fprintf(stderr, "\r%s: %s: Done.\n", progname, infile);
+    unmap_file(&mf);
+
+    for (unsigned kind = 0; kind < NUM_OUTS; ++kind)
+    {
+        struct qt_output *o = &st.outs[kind];
+        if (!o->open) continue;
+        if (outbuf_close(&o->out) | close(o->fd))
+        {
+            fprintf(stderr, "%s: error writing '%s'\n",
+                progname, o->filename);
+            error = 1;
+        }
+        fprintf(stderr, "%s: wrote %llu %s to '%s'\n",
+            progname, o->frames, out_what[kind], o->filename);
+        free(o->filename);
+    }
+    if (st.rejected)
+    {
+        fprintf(stderr, "%s: rejected %llu logs failing the CRC check\n",
+            progname, st.rejected);
+    }
+    return error;
+}
+
+const char* usage_help =
+    "usage: %s infile...\n"
+    "  infile: INS or SPAN log, or a capture holding both; each is read\n"
+    "    once, and every OPVT2AHR, OPVT, INSPVA, BESTPOS, BESTGNSSPOS\n"
+    "    and RTKPOS frame in it is converted to text in a file named\n"
+    "    after it: .txt, .opvt.txt, .ins or .pos respectively\n";
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) // first argument must be infile
+    {
+        fprintf(stderr, "%s: must provide a filename first\n", argv[0]);
+        return 1;
+    }
+
+    // special case: if first argument is "--usage", print the usage
+    // help string to stderr
+    if (strcmp(argv[1], "--usage") == 0)
+    {
+        printf(usage_help, argv[0]);
+        return 0;
+    }
+
+    // a log that fails to convert doesn't stop the rest of a directory
+    int error = 0;
+    for (int i = 1; i < argc; ++i) error |= convert_file(argv[0], argv[i]);
+    return error;
+}
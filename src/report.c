@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "report.h"
+
+void progress_init(struct progress *p, const char *progname,
+                   const char *outfn, unsigned long long total)
+{
+    p->progname = progname;
+    p->outfn = outfn;
+    p->total = total;
+    p->shown = 255;
+}
+
+void progress_update(struct progress *p, unsigned long long done)
+{
+    unsigned char percent = p->total ? 100*done/p->total : 100;
+    if (percent == p->shown) return;
+    p->shown = percent;
+    if (p->outfn) fprintf(stderr, "\r%s: Writing to %s: %2hhu%%",
+        p->progname, p->outfn, percent);
+    else fprintf(stderr, "\r%s: Writing... %2hhu%%", p->progname, percent);
+}
+
+void progress_done(const struct progress *p)
+{
+    if (p->outfn) fprintf(stderr, "\r%s: Writing to %s: Done.\n",
+        p->progname, p->outfn);
+    else fprintf(stderr, "\r%s: Writing... Done.\n", p->progname);
+}
+
+int save_index(const char *progname, struct timeidx *index,
+    const char *infn, unsigned long long filelen, const char *kind)
+{
+    char *idx_fn = timeidx_filename(infn);
+    int error = !idx_fn || timeidx_save(index, idx_fn, filelen);
+    if (error) fprintf(stderr, "%s: failed to write '%s.idx'\n",
+        progname, infn);
+    else fprintf(stderr, "%s: indexed %llu %s in %llu entries\n",
+        progname, index->frames, kind, index->n);
+    free(idx_fn);
+    timeidx_free(index);
+    return error;
+}
+
+int close_output(const char *progname, struct outbuf *out, int fd)
+{
+    int error = outbuf_close(out);
+    if (fd != 1 && close(fd)) error = 1;
+    fprintf(stderr, "%s: wrote %llu bytes in %llu write calls\n",
+        progname, out->bytes, out->syscalls);
+    if (error) fprintf(stderr, "%s: error writing output\n", progname);
+    return error;
+}
+
+int close_columnar(const char *progname, struct colfile *col, int fd)
+{
+    unsigned long long rows = col->nrows;
+    unsigned ncols = col->ncols;
+    int error = colfile_close(col);
+    if (fd != 1 && close(fd)) error = 1;
+    fprintf(stderr, "%s: wrote %llu rows of %u columns\n",
+        progname, rows, ncols);
+    if (error) fprintf(stderr, "%s: error writing output\n", progname);
+    return error;
+}
@@ -0,0 +1,49 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include "outbuf.h"
+#include "colfile.h"
+#include "timeidx.h"
+
+// what the converters tell the user about a conversion on stderr: the
+// "Writing... 42%" line kept up to date while the input is converted,
+// redrawn only when the percentage changes, and what was written once
+// it's done.
+
+struct progress
+{
+    // the program, the output named in the line (or null to name
+    // none), the length of the input, and the percentage last drawn
+    const char *progname, *outfn;
+    unsigned long long total;
+    unsigned char shown;
+};
+
+// prepares p for converting an input of total bytes; nothing is drawn
+// until the first progress_update
+void progress_init(struct progress *p, const char *progname,
+                   const char *outfn, unsigned long long total);
+
+// redraws the line if converting up to offset done changes the
+// percentage
+void progress_update(struct progress *p, unsigned long long done);
+
+// finishes the line with "Done."
+void progress_done(const struct progress *p);
+
+// writes the index built by --index next to the log infn it indexes,
+// reports its size, calling the timed messages kind ("frames" or
+// "logs"), and frees it; returns nonzero if writing failed
+int save_index(const char *progname, struct timeidx *index,
+    const char *infn, unsigned long long filelen, const char *kind);
+
+// drains and stops the output writer, closes the output file unless
+// it's stdout and reports how much was written; returns nonzero if
+// writing failed
+int close_output(const char *progname, struct outbuf *out, int fd);
+
+// writes out and releases a columnar file, closes it unless it's
+// stdout and reports its size; returns nonzero if writing failed
+int close_columnar(const char *progname, struct colfile *col, int fd);
+
+#endif // REPORT_H
@@ -0,0 +1,114 @@
+#include <string.h>
+
+#include "scanstat.h"
+
+#define MS_PER_WEEK 604800000LL
+
+void scan_init(struct scan_stats *stats, unsigned long long bytes,
+               double rate_hz)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->period_ms = 1000/rate_hz;
+    stats->bytes = bytes;
+}
+
+void scan_frame(struct scan_stats *stats, unsigned long ms,
+                unsigned long len)
+{
+    stats->framed += len;
+    if (stats->frames++ == 0)
+    {
+        stats->first_ms = stats->last_ms = ms;
+        return;
+    }
+
+    // times are milliseconds into the week, so a step of more than
+    // half a week either way is taken to cross a rollover
+    long long delta = (long long) ms - (long long) stats->last_ms;
+    if (delta < -MS_PER_WEEK/2) delta += MS_PER_WEEK;
+    else if (delta > MS_PER_WEEK/2) delta -= MS_PER_WEEK;
+    stats->last_ms = ms;
+    stats->elapsed_ms += delta;
+
+    if (delta < 0) ++stats->backwards;
+    else if (delta < SCAN_MAX_DELTA) ++stats->delta_hist[delta];
+    else ++stats->long_gaps;
+
+    // a gap of n periods is missing n - 1 frames
+    if (delta > 1.5*stats->period_ms)
+    {
+        stats->dropped +=
+            (unsigned long long) (delta/stats->period_ms + 0.5) - 1;
+    }
+}
+
+void scan_other(struct scan_stats *stats, unsigned long len)
+{
+    stats->framed += len;
+    ++stats->others;
+}
+
+// writes s as a JSON string
+static void scan_print_string(FILE *out, const char *s)
+{
+    fputc('"', out);
+    for (; *s; ++s)
+    {
+        if (*s == '"' || *s == '\\') fprintf(out, "\\%c", *s);
+        else if ((unsigned char) *s < 0x20) fprintf(out, "\\u%04x", *s);
+        else fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+void scan_print(FILE *out, const struct scan_stats *stats,
+                const char *input, const char *kind)
+{
+    fprintf(out, "{\n  \"input\": ");
+    scan_print_string(out, input);
+    fprintf(out, ",\n  \"kind\": \"%s\",\n", kind);
+    fprintf(out, "  \"bytes\": %llu,\n", stats->bytes);
+    fprintf(out, "  \"frames\": %llu,\n", stats->frames);
+    fprintf(out, "  \"other_messages\": %llu,\n", stats->others);
+    fprintf(out, "  \"checksum_failures\": %llu,\n", stats->bad_checksums);
+    fprintf(out, "  \"bytes_skipped\": %llu,\n",
+        stats->bytes - stats->framed);
+    if (stats->frames)
+    {
+        fprintf(out, "  \"first_ms_gps\": %lu,\n", stats->first_ms);
+        fprintf(out, "  \"last_ms_gps\": %lu,\n", stats->last_ms);
+    }
+    else
+    {
+        fprintf(out, "  \"first_ms_gps\": null,\n");
+        fprintf(out, "  \"last_ms_gps\": null,\n");
+    }
+    fprintf(out, "  \"duration_s\": %.3f,\n", stats->elapsed_ms/1000.0);
+    fprintf(out, "  \"rate_hz\": %g,\n", 1000/stats->period_ms);
+
+    // a log that runs backwards can't be expected to hold anything
+    unsigned long long expected = 0;
+    if (stats->frames && stats->elapsed_ms >= 0)
+    {
+        expected = (unsigned long long)
+            (stats->elapsed_ms/stats->period_ms + 0.5) + 1;
+    }
+    fprintf(out, "  \"expected_frames\": %llu,\n", expected);
+    fprintf(out, "  \"dropped_frames\": %llu,\n", stats->dropped);
+    fprintf(out, "  \"backward_steps\": %llu,\n", stats->backwards);
+
+    fprintf(out, "  \"delta_ms_histogram\": {");
+    const char *sep = "";
+    for (unsigned d = 0; d < SCAN_MAX_DELTA; ++d)
+    {
+        if (!stats->delta_hist[d]) continue;
+        fprintf(out, "%s\"%u\": %llu", sep, d, stats->delta_hist[d]);
+        sep = ", ";
+    }
+    if (stats->long_gaps)
+    {
+        fprintf(out, "%s\">=%u\": %llu", sep, SCAN_MAX_DELTA,
+            stats->long_gaps);
+    }
+    fprintf(out, "}\n}\n");
+}
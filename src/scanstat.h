@@ -0,0 +1,59 @@
+#ifndef SCANSTAT_H
+#define SCANSTAT_H
+
+#include <stdio.h>
+
+// the statistics behind the converters' --scan mode, which decodes and
+// checks every message of a log without formatting any of it and
+// prints a JSON summary of its timing and integrity instead. the
+// converter finds the messages; this only counts them.
+
+// deltas between consecutive frames' times are counted exactly up to
+// this many milliseconds, and together beyond it
+#define SCAN_MAX_DELTA 1000
+
+struct scan_stats
+{
+    // expected time between frames at the configured data rate
+    double period_ms;
+
+    // length of the input, and the bytes of it in messages that
+    // decoded; everything else was skipped while resyncing
+    unsigned long long bytes, framed;
+
+    // frames of the timed kind (OPVT2AHR, OPVT, INSPVA), other
+    // messages that decoded (ACKs, alignment blocks, other OEM7 logs),
+    // and messages of the timed kind failing their checksum or CRC
+    unsigned long long frames, others, bad_checksums;
+
+    // GPS milliseconds into the week of the first and last frames, and
+    // the time between them, across any week rollovers
+    unsigned long first_ms, last_ms;
+    long long elapsed_ms;
+
+    // how often each delta turned up, frames missing from gaps longer
+    // than period_ms, times that went backwards, and deltas of
+    // SCAN_MAX_DELTA or more
+    unsigned long long delta_hist[SCAN_MAX_DELTA];
+    unsigned long long dropped, backwards, long_gaps;
+};
+
+// prepares stats for a log of bytes bytes written at rate_hz frames a
+// second
+void scan_init(struct scan_stats *stats, unsigned long long bytes,
+               double rate_hz);
+
+// counts a frame of the timed kind, len bytes long, stamped ms GPS
+// milliseconds into the week
+void scan_frame(struct scan_stats *stats, unsigned long ms,
+                unsigned long len);
+
+// counts any other message that decoded, len bytes long
+void scan_other(struct scan_stats *stats, unsigned long len);
+
+// writes the summary of a scan of input, whose timed frames are of the
+// given kind, to out as one JSON object
+void scan_print(FILE *out, const struct scan_stats *stats,
+                const char *input, const char *kind);
+
+#endif // SCANSTAT_H
@@ -0,0 +1,250 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "syncscan.h"
+
+// benchmark for the sync scanners in syncscan.c. a log is corrupted on
+// purpose -- random bytes overwritten, and bursts of garbage rich in
+// sync bytes spliced in, as seen in damaged or mixed captures -- and
+// then every candidate sync position in it is found with each scanner,
+// as well as with the byte-at-a-time comparison the decoders used to
+// do. the corrupted log can be saved to time the converters on it.
+
+typedef unsigned long long (*scan_fn)(const unsigned char*,
+    unsigned long long, const unsigned char*, unsigned);
+
+// the old way of resynchronising: compare the pattern at every byte
+static unsigned long long scan_bytewise(const unsigned char *buf,
+    unsigned long long len, const unsigned char *pattern, unsigned patlen)
+{
+    for (unsigned long long pos = 0; pos < len; ++pos)
+    {
+        unsigned long long n = len - pos < patlen ? len - pos : patlen;
+        if (memcmp(buf + pos, pattern, n) == 0) return pos;
+    }
+    return len;
+}
+
+// xorshift64, so that a corruption can be reproduced from its seed
+static unsigned long long rng_state = 88172645463325252ULL;
+static unsigned long long rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// returns a corrupted copy of the len bytes at data in a new buffer,
+// and its length through out_len
+static unsigned char* corrupt(const unsigned char *data,
+    unsigned long long len, double rate, unsigned long long *out_len)
+{
+    static const unsigned char sync_bytes[] =
+        {0xAA, 0x55, 0x01, 0x58, 0x52, 0x44, 0x12};
+
+    // every burst is at most 300 bytes, and one starts at most every
+    // 500 bytes of the original
+    unsigned char *out = (unsigned char*) malloc(len + (len/500 + 1)*300);
+    if (!out) return 0;
+
+    unsigned long long rptr = 0, wptr = 0;
+    unsigned long long threshold = (unsigned long long) (rate*(double) ~0ULL);
+    while (rptr < len)
+    {
+        unsigned long long run = 500 + rng() % 4500;
+        if (run > len - rptr) run = len - rptr;
+        for (unsigned long long i = 0; i < run; ++i)
+        {
+            unsigned char byte = data[rptr + i];
+            if (rate > 0 && rng() <= threshold) byte = rng() & 0xFF;
+            out[wptr++] = byte;
+        }
+        rptr += run;
+
+        if (rate == 0) continue;
+        unsigned long long burst = 10 + rng() % 290;
+        for (unsigned long long i = 0; i < burst; ++i)
+        {
+            unsigned long long r = rng();
+            out[wptr++] = r % 2 ? sync_bytes[(r >> 8) % sizeof(sync_bytes)]
+                                : (r >> 16) & 0xFF;
+        }
+    }
+    *out_len = wptr;
+    return out;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec/1.0E9;
+}
+
+// counts every position in buf at which pattern starts, and the time
+// it takes to find them all, best of repeats runs
+static unsigned long long count_syncs(scan_fn scan, const unsigned char *buf,
+    unsigned long long len, const unsigned char *pattern, unsigned patlen,
+    int repeats, double *seconds)
+{
+    unsigned long long count = 0;
+    *seconds = 0;
+    for (int r = 0; r < repeats; ++r)
+    {
+        double start = now();
+        count = 0;
+        unsigned long long pos = 0;
+        while (pos < len)
+        {
+            pos += scan(buf + pos, len - pos, pattern, patlen);
+            if (pos < len)
+            {
+                ++count;
+                ++pos;
+            }
+        }
+        double elapsed = now() - start;
+        if (r == 0 || elapsed < *seconds) *seconds = elapsed;
+    }
+    return count;
+}
+
+const char* argument_error =
+    "%s: invalid option -- '%s'\n"
+    "type '%s --usage' for more info\n";
+
+const char* usage_help =
+    "usage: %s infile [-c rate] [-r repeats] [-o outfile]\n"
+    "  infile: binary log to corrupt and scan\n"
+    "  rate: fraction of bytes overwritten at random, 0.01 by\n"
+    "    default; garbage bursts are spliced in unless it is 0\n"
+    "  repeats: scans per scanner, the fastest is reported; 5\n"
+    "  outfile: where to save the corrupted log\n";
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "%s: must provide a filename first\n", argv[0]);
+        return 1;
+    }
+    if (strcmp(argv[1], "--usage") == 0)
+    {
+        printf(usage_help, argv[0]);
+        return 0;
+    }
+
+    double rate = 0.01;
+    int repeats = 5;
+    const char *outfn = 0;
+    for (int i = 2; i < argc; ++i)
+    {
+        if (i + 1 >= argc)
+        {
+            fprintf(stderr, usage_help, argv[0]);
+            return 1;
+        }
+        if (!strcmp(argv[i], "-c")) rate = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-r")) repeats = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-o")) outfn = argv[++i];
+        else
+        {
+            fprintf(stderr, argument_error, argv[0], argv[i], argv[0]);
+            return 1;
+        }
+    }
+    if (repeats < 1) repeats = 1;
+
+    FILE *infile = fopen(argv[1], "rb");
+    if (!infile)
+    {
+        fprintf(stderr, "%s: failed to open '%s'\n", argv[0], argv[1]);
+        return 1;
+    }
+    fseek(infile, 0, SEEK_END);
+    unsigned long long filelen = ftell(infile);
+    rewind(infile);
+    unsigned char *data = (unsigned char*) malloc(filelen + 1);
+    if (!data || fread(data, 1, filelen, infile) != filelen)
+    {
+        fprintf(stderr, "%s: failed to read '%s'\n", argv[0], argv[1]);
+        return 1;
+    }
+    fclose(infile);
+
+    unsigned long long len;
+    unsigned char *buf = corrupt(data, filelen, rate, &len);
+    free(data);
+    if (!buf)
+    {
+        fprintf(stderr, "%s: memory allocation error\n", argv[0]);
+        return 1;
+    }
+
+    if (outfn)
+    {
+        FILE *outfile = fopen(outfn, "wb");
+        if (!outfile || fwrite(buf, 1, len, outfile) != len)
+        {
+            fprintf(stderr, "%s: failed to write '%s'\n", argv[0], outfn);
+            return 1;
+        }
+        fclose(outfile);
+    }
+
+    struct { const char *name; scan_fn scan; } scanners[] =
+    {
+        {"bytewise", scan_bytewise},
+        {"scalar", sync_scan_scalar},
+        {"sse2", sync_scan_sse2},
+        {"avx2", sync_scan_avx2}
+    };
+    struct { const char *name; const unsigned char *sync; unsigned len; }
+    patterns[] =
+    {
+        {"opvt2ahr", opvt2ahr_sync, 4},
+        {"oem7", oem7_sync, 3}
+    };
+
+    // one line per scanner and pattern: name, pattern, candidates found,
+    // throughput, and speedup over the byte-at-a-time scan
+    printf("# %s: %llu bytes, corruption rate %g, sync_scan uses %s\n",
+        argv[1], len, rate, sync_scan_impl());
+    printf("%-10s %-10s %12s %12s %8s\n",
+        "scanner", "pattern", "candidates", "MB/s", "speedup");
+    int mismatch = 0;
+    for (unsigned p = 0; p < sizeof(patterns)/sizeof(patterns[0]); ++p)
+    {
+        double base_time = 0;
+        unsigned long long base_count = 0;
+        for (unsigned s = 0; s < sizeof(scanners)/sizeof(scanners[0]); ++s)
+        {
+            double seconds;
+            unsigned long long count = count_syncs(scanners[s].scan, buf,
+                len, patterns[p].sync, patterns[p].len, repeats, &seconds);
+            if (s == 0)
+            {
+                base_time = seconds;
+                base_count = count;
+            }
+            else if (count != base_count) mismatch = 1;
+            printf("%-10s %-10s %12llu %12.1f %8.2f\n",
+                scanners[s].name, patterns[p].name, count,
+                len/seconds/1.0E6, base_time/seconds);
+        }
+    }
+
+    free(buf);
+    if (mismatch)
+    {
+        fprintf(stderr, "%s: scanners disagree on candidate count\n",
+            argv[0]);
+        return 1;
+    }
+    return 0;
+}
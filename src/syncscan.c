@@ -0,0 +1,151 @@
+#include <pthread.h>
+#include <string.h>
+
+#include "syncscan.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SYNCSCAN_X86 1
+#include <immintrin.h>
+#endif
+
+const unsigned char il_sync[3] = {0xAA, 0x55, 0x01};
+const unsigned char opvt2ahr_sync[4] = {0xAA, 0x55, 0x01, 0x58};
+const unsigned char opvt_sync[4] = {0xAA, 0x55, 0x01, 0x52};
+const unsigned char oem7_sync[3] = {0xAA, 0x44, 0x12};
+
+// nonzero if as much of pattern as fits before len matches at pos
+static int match_at(const unsigned char *buf, unsigned long long len,
+    unsigned long long pos, const unsigned char *pattern, unsigned patlen)
+{
+    unsigned long long n = len - pos < patlen ? len - pos : patlen;
+    return memcmp(buf + pos, pattern, n) == 0;
+}
+
+unsigned long long sync_scan_scalar(const unsigned char *buf,
+    unsigned long long len, const unsigned char *pattern, unsigned patlen)
+{
+    unsigned long long pos = 0;
+    while (pos < len)
+    {
+        const unsigned char *hit = (const unsigned char*)
+            memchr(buf + pos, pattern[0], len - pos);
+        if (!hit) return len;
+        pos = hit - buf;
+        if (match_at(buf, len, pos, pattern, patlen)) return pos;
+        ++pos;
+    }
+    return len;
+}
+
+#ifdef SYNCSCAN_X86
+
+// both SIMD scans compare each position's first and second bytes
+// against the pattern at once, by loading the block twice, one byte
+// apart; only positions where both match are checked in full
+
+unsigned long long sync_scan_sse2(const unsigned char *buf,
+    unsigned long long len, const unsigned char *pattern, unsigned patlen)
+{
+    if (patlen < 2) return sync_scan_scalar(buf, len, pattern, patlen);
+
+    const __m128i first = _mm_set1_epi8((char) pattern[0]);
+    const __m128i second = _mm_set1_epi8((char) pattern[1]);
+    unsigned long long pos = 0;
+    while (pos + 17 <= len)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*) (buf + pos));
+        __m128i b = _mm_loadu_si128((const __m128i*) (buf + pos + 1));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(
+            _mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, second)));
+        while (mask)
+        {
+            unsigned long long hit = pos + __builtin_ctz(mask);
+            if (match_at(buf, len, hit, pattern, patlen)) return hit;
+            mask &= mask - 1;
+        }
+        pos += 16;
+    }
+    return pos + sync_scan_scalar(buf + pos, len - pos, pattern, patlen);
+}
+
+__attribute__((target("avx2")))
+unsigned long long sync_scan_avx2(const unsigned char *buf,
+    unsigned long long len, const unsigned char *pattern, unsigned patlen)
+{
+    if (patlen < 2) return sync_scan_scalar(buf, len, pattern, patlen);
+    if (!__builtin_cpu_supports("avx2"))
+        return sync_scan_sse2(buf, len, pattern, patlen);
+
+    const __m256i first = _mm256_set1_epi8((char) pattern[0]);
+    const __m256i second = _mm256_set1_epi8((char) pattern[1]);
+    unsigned long long pos = 0;
+    while (pos + 33 <= len)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*) (buf + pos));
+        __m256i b = _mm256_loadu_si256((const __m256i*) (buf + pos + 1));
+        unsigned mask = (unsigned) _mm256_movemask_epi8(_mm256_and_si256(
+            _mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, second)));
+        while (mask)
+        {
+            unsigned long long hit = pos + __builtin_ctz(mask);
+            if (match_at(buf, len, hit, pattern, patlen)) return hit;
+            mask &= mask - 1;
+        }
+        pos += 32;
+    }
+    return pos + sync_scan_sse2(buf + pos, len - pos, pattern, patlen);
+}
+
+#else // no SIMD scan on this target
+
+unsigned long long sync_scan_sse2(const unsigned char *buf,
+    unsigned long long len, const unsigned char *pattern, unsigned patlen)
+{
+    return sync_scan_scalar(buf, len, pattern, patlen);
+}
+
+unsigned long long sync_scan_avx2(const unsigned char *buf,
+    unsigned long long len, const unsigned char *pattern, unsigned patlen)
+{
+    return sync_scan_scalar(buf, len, pattern, patlen);
+}
+
+#endif // SYNCSCAN_X86
+
+typedef unsigned long long (*sync_scan_fn)(const unsigned char*,
+    unsigned long long, const unsigned char*, unsigned);
+
+// picked once, on first use, whichever thread gets there first
+static pthread_once_t sync_scan_once = PTHREAD_ONCE_INIT;
+static sync_scan_fn sync_scan_best = 0;
+static const char *sync_scan_name = 0;
+
+static void sync_scan_pick(void)
+{
+#ifdef SYNCSCAN_X86
+    if (__builtin_cpu_supports("avx2"))
+    {
+        sync_scan_name = "avx2";
+        sync_scan_best = sync_scan_avx2;
+        return;
+    }
+    sync_scan_name = "sse2";
+    sync_scan_best = sync_scan_sse2;
+#else
+    sync_scan_name = "scalar";
+    sync_scan_best = sync_scan_scalar;
+#endif
+}
+
+unsigned long long sync_scan(const unsigned char *buf, unsigned long long len,
+                             const unsigned char *pattern, unsigned patlen)
+{
+    pthread_once(&sync_scan_once, sync_scan_pick);
+    return sync_scan_best(buf, len, pattern, patlen);
+}
+
+const char* sync_scan_impl(void)
+{
+    pthread_once(&sync_scan_once, sync_scan_pick);
+    return sync_scan_name;
+}
@@ -0,0 +1,39 @@
+#ifndef SYNCSCAN_H
+#define SYNCSCAN_H
+
+// resynchronisation for the decoders. rather than attempting a full
+// parse at every byte of a damaged or mixed capture, a decoder asks
+// for the next place its sync sequence could start and skips straight
+// there. on x86-64 the scan compares 16 (SSE2) or 32 (AVX2) positions
+// at a time; elsewhere it falls back to memchr.
+
+// returns the offset of the first position in buf at which pattern
+// starts, or len if there is none. a pattern cut off by the end of the
+// buffer counts: if the last bytes of buf are a prefix of pattern,
+// the offset of that prefix is returned, so that a decoder waiting for
+// more data keeps it. patlen must be at least 1.
+unsigned long long sync_scan(const unsigned char *buf, unsigned long long len,
+                             const unsigned char *pattern, unsigned patlen);
+
+// the individual implementations sync_scan chooses between at run
+// time, for benchmarking; all of them return the same result. the
+// SIMD versions fall back to sync_scan_scalar where not supported.
+unsigned long long sync_scan_scalar(const unsigned char *buf,
+    unsigned long long len, const unsigned char *pattern, unsigned patlen);
+unsigned long long sync_scan_sse2(const unsigned char *buf,
+    unsigned long long len, const unsigned char *pattern, unsigned patlen);
+unsigned long long sync_scan_avx2(const unsigned char *buf,
+    unsigned long long len, const unsigned char *pattern, unsigned patlen);
+
+// name of the implementation sync_scan uses on this machine
+const char* sync_scan_impl(void);
+
+// sync sequences of the messages the converters decode: an Inertial
+// Labs message of any type, an OPVT2AHR or OPVT frame, and any NovAtel
+// OEM7 binary log
+extern const unsigned char il_sync[3];
+extern const unsigned char opvt2ahr_sync[4];
+extern const unsigned char opvt_sync[4];
+extern const unsigned char oem7_sync[3];
+
+#endif // SYNCSCAN_H
@@ -0,0 +1,239 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "timeidx.h"
+
+static const char timeidx_magic[8] = "INSIDX1";
+
+// stores the low size bytes of value at dst, least significant first
+static void put_le(unsigned char *dst, unsigned long long value, int size)
+{
+    for (int i = 0; i < size; ++i)
+    {
+        dst[i] = value & 0xFF;
+        value >>= 8;
+    }
+}
+
+static unsigned long long get_le(const unsigned char *src, int size)
+{
+    unsigned long long value = 0;
+    for (int i = size - 1; i >= 0; --i)
+    {
+        value = (value << 8) | src[i];
+    }
+    return value;
+}
+
+void timeidx_init(struct timeidx *idx, unsigned long kind)
+{
+    memset(idx, 0, sizeof(*idx));
+    idx->kind = kind;
+    idx->stride = TIMEIDX_STRIDE;
+}
+
+void timeidx_add(struct timeidx *idx, unsigned long ms,
+                 unsigned long long offset)
+{
+    unsigned long long t = ms + idx->week_base;
+    if (idx->frames && t + TIMEIDX_MS_PER_WEEK/2 < idx->last)
+    {
+        idx->week_base += TIMEIDX_MS_PER_WEEK;
+        t += TIMEIDX_MS_PER_WEEK;
+    }
+    if (idx->frames && t < idx->last) return;
+    idx->last = t;
+    if (idx->frames++ % idx->stride || idx->error) return;
+
+    if (idx->n == idx->cap)
+    {
+        unsigned long long cap = idx->cap ? 2*idx->cap : 1024;
+        unsigned long long *times = (unsigned long long*)
+            realloc(idx->times, cap*sizeof(*times));
+        if (!times)
+        {
+            idx->error = 1;
+            return;
+        }
+        idx->times = times;
+        unsigned long long *offsets = (unsigned long long*)
+            realloc(idx->offsets, cap*sizeof(*offsets));
+        if (!offsets)
+        {
+            idx->error = 1;
+            return;
+        }
+        idx->offsets = offsets;
+        idx->cap = cap;
+    }
+    idx->times[idx->n] = t;
+    idx->offsets[idx->n] = offset;
+    ++idx->n;
+}
+
+int timeidx_save(const struct timeidx *idx, const char *filename,
+                 unsigned long long loglen)
+{
+    if (idx->error) return 1;
+
+    // written to a temporary file and renamed over the old index, so
+    // that a reader never sees half of one
+    char *tmp_fn = (char*) malloc(strlen(filename) + 5);
+    if (!tmp_fn) return 1;
+    strcpy(tmp_fn, filename);
+    strcat(tmp_fn, ".tmp");
+    FILE *f = fopen(tmp_fn, "wb");
+    if (!f)
+    {
+        free(tmp_fn);
+        return 1;
+    }
+
+    unsigned char header[32], entry[16];
+    memcpy(header, timeidx_magic, 8);
+    put_le(header + 8, idx->kind, 4);
+    put_le(header + 12, idx->stride, 4);
+    put_le(header + 16, loglen, 8);
+    put_le(header + 24, idx->n, 8);
+    int error = fwrite(header, sizeof(header), 1, f) != 1;
+    for (unsigned long long i = 0; i < idx->n && !error; ++i)
+    {
+        put_le(entry, idx->times[i], 8);
+        put_le(entry + 8, idx->offsets[i], 8);
+        error = fwrite(entry, sizeof(entry), 1, f) != 1;
+    }
+    if (fclose(f)) error = 1;
+    if (!error) error = rename(tmp_fn, filename) != 0;
+    if (error) remove(tmp_fn);
+    free(tmp_fn);
+    return error;
+}
+
+int timeidx_load(struct timeidx *idx, const char *filename,
+                 unsigned long kind, unsigned long long loglen)
+{
+    timeidx_init(idx, kind);
+    FILE *f = fopen(filename, "rb");
+    if (!f) return 1;
+
+    unsigned char header[32], entry[16];
+    if (fread(header, sizeof(header), 1, f) != 1 ||
+        memcmp(header, timeidx_magic, 8) ||
+        get_le(header + 8, 4) != kind ||
+        get_le(header + 16, 8) > loglen)
+    {
+        fclose(f);
+        return 1;
+    }
+    idx->stride = get_le(header + 12, 4);
+    idx->loglen = get_le(header + 16, 8);
+    unsigned long long n = get_le(header + 24, 8);
+
+    // every entry is at least one frame into the log
+    if (n > idx->loglen)
+    {
+        fclose(f);
+        return 1;
+    }
+    idx->times =
+        (unsigned long long*) malloc((n ? n : 1)*sizeof(*idx->times));
+    idx->offsets =
+        (unsigned long long*) malloc((n ? n : 1)*sizeof(*idx->offsets));
+    if (!idx->times || !idx->offsets)
+    {
+        timeidx_free(idx);
+        fclose(f);
+        return 1;
+    }
+    for (idx->n = 0; idx->n < n; ++idx->n)
+    {
+        if (fread(entry, sizeof(entry), 1, f) != 1) break;
+        idx->times[idx->n] = get_le(entry, 8);
+        idx->offsets[idx->n] = get_le(entry + 8, 8);
+    }
+    fclose(f);
+    if (idx->n < n)
+    {
+        timeidx_free(idx);
+        return 1;
+    }
+    idx->cap = n;
+    return 0;
+}
+
+unsigned long long timeidx_find(const struct timeidx *idx, unsigned long ms)
+{
+    if (idx->n == 0) return 0;
+
+    // a time before the first entry's is taken to be in the next week
+    // if the log runs into it
+    unsigned long long t = ms;
+    if (t < idx->times[0] && idx->times[idx->n - 1] >= TIMEIDX_MS_PER_WEEK)
+        t += TIMEIDX_MS_PER_WEEK;
+    if (t < idx->times[0]) return 0;
+
+    // the last entry at or before t
+    unsigned long long lo = 0, hi = idx->n;
+    while (hi - lo > 1)
+    {
+        unsigned long long mid = lo + (hi - lo)/2;
+        if (idx->times[mid] <= t) lo = mid;
+        else hi = mid;
+    }
+    return idx->offsets[lo];
+}
+
+long long timeidx_diff(unsigned long a, unsigned long b)
+{
+    long long diff = (long long) a - (long long) b;
+    if (diff < -(long long) TIMEIDX_MS_PER_WEEK/2)
+        diff += TIMEIDX_MS_PER_WEEK;
+    else if (diff > (long long) TIMEIDX_MS_PER_WEEK/2)
+        diff -= TIMEIDX_MS_PER_WEEK;
+    return diff;
+}
+
+unsigned long long timeidx_seek(const struct timeidx *idx,
+    timeidx_probe probe, void *ctx, unsigned long long start,
+    unsigned long long end, unsigned long ms)
+{
+    if (idx)
+    {
+        unsigned long long pos = timeidx_find(idx, ms);
+        return pos > start ? pos : start;
+    }
+
+    // every frame before lo is stamped before ms. once the range is
+    // down to a few frames, the decoder's own skipping is cheaper than
+    // probing further
+    unsigned long long lo = start, hi = end;
+    while (lo + 4096 < hi)
+    {
+        unsigned long long mid = lo + (hi - lo)/2;
+        unsigned long t;
+        unsigned long long pos = probe(ctx, mid, &t);
+        if (pos < end && timeidx_diff(t, ms) < 0) lo = pos;
+        else hi = mid;
+    }
+    return lo;
+}
+
+char* timeidx_filename(const char *filename)
+{
+    char *idx_fn = (char*) malloc(strlen(filename) + 5);
+    if (!idx_fn) return 0;
+    strcpy(idx_fn, filename);
+    strcat(idx_fn, ".idx");
+    return idx_fn;
+}
+
+void timeidx_free(struct timeidx *idx)
+{
+    free(idx->times);
+    free(idx->offsets);
+    idx->times = idx->offsets = 0;
+    idx->n = idx->cap = 0;
+}
@@ -0,0 +1,96 @@
+#ifndef TIMEIDX_H
+#define TIMEIDX_H
+
+// time index sidecars, written next to a log as <log>.idx by the
+// converters' --index option. an index maps the GPS time of every
+// TIMEIDX_STRIDE'th timed frame (OPVT2AHR, OPVT or INSPVA) to the byte
+// offset of that frame in the log, so that a tool can find any instant
+// of a long log with a binary search instead of reading it all:
+//
+//   offset  size  field (all integers little-endian)
+//        0     8  magic, "INSIDX1\0"
+//        8     4  kind of the timed frames: the Inertial Labs message
+//                 type (0x58 OPVT2AHR, 0x52 OPVT) or OEM7 message ID
+//                 (507 INSPVA)
+//       12     4  frames between entries
+//       16     8  length of the log when it was indexed
+//       24     8  number of entries
+//       32  16*n  one entry per indexed frame:
+//                    8  time, milliseconds
+//                    8  byte offset of the frame in the log
+//
+// times are GPS milliseconds into the week of the first frame. they
+// keep counting past the end of that week rather than wrapping, so the
+// entries stay in order across a week rollover. a frame whose time
+// goes backwards is left out, for the same reason.
+
+#define TIMEIDX_STRIDE 100
+
+#define TIMEIDX_MS_PER_WEEK 604800000ULL
+
+struct timeidx
+{
+    unsigned long kind, stride;
+    unsigned long long loglen;
+    unsigned long long n, cap;
+    unsigned long long *times, *offsets;
+
+    // frames seen while building, the last time seen, and what's been
+    // added to times to count past week rollovers
+    unsigned long long frames, last, week_base;
+    int error;
+};
+
+// starts building an empty index of frames of the given kind
+void timeidx_init(struct timeidx *idx, unsigned long kind);
+
+// counts a timed frame stamped ms GPS milliseconds into the week and
+// starting offset bytes into the log, adding an entry for every
+// TIMEIDX_STRIDE'th one
+void timeidx_add(struct timeidx *idx, unsigned long ms,
+                 unsigned long long offset);
+
+// writes the index of a log of loglen bytes to filename; returns 0 on
+// success, or nonzero if writing failed or memory ran out while
+// building the index
+int timeidx_save(const struct timeidx *idx, const char *filename,
+                 unsigned long long loglen);
+
+// reads the index at filename, which must be of frames of the given
+// kind and must not cover more of the log than loglen bytes; an index
+// of a log that has since grown is still good for the part it covers.
+// returns 0 on success, 1 if there is no usable index.
+int timeidx_load(struct timeidx *idx, const char *filename,
+                 unsigned long kind, unsigned long long loglen);
+
+// the offset of the last indexed frame stamped at or before ms GPS
+// milliseconds into the week, from which a decoder reaches the frame
+// at ms within TIMEIDX_STRIDE frames; 0 if ms is before the first
+// entry
+unsigned long long timeidx_find(const struct timeidx *idx, unsigned long ms);
+
+// the difference a - b between two times in GPS milliseconds into the
+// week, the short way around a week rollover
+long long timeidx_diff(unsigned long a, unsigned long b);
+
+// gives the offset of the first timed frame at or after pos in a log
+// and sets *ms to its time, or returns the end of the log if there is
+// none
+typedef unsigned long long (*timeidx_probe)(void *ctx,
+    unsigned long long pos, unsigned long *ms);
+
+// where to start decoding a log between start and end to reach the
+// first timed frame stamped at or after ms: every frame between the
+// offset returned and that frame is stamped before ms. uses idx if it
+// isn't null, and otherwise bisects the log with probe, which takes a
+// few dozen frame decodes; both rely on the frames being in order.
+unsigned long long timeidx_seek(const struct timeidx *idx,
+    timeidx_probe probe, void *ctx, unsigned long long start,
+    unsigned long long end, unsigned long ms);
+
+// name of the index of the log at filename, as malloc'd memory
+char* timeidx_filename(const char *filename);
+
+void timeidx_free(struct timeidx *idx);
+
+#endif // TIMEIDX_H